@@ -7,10 +7,124 @@
 
 #include <netaddress.h>
 #include <ui_interface.h>
+#include <util/memory.h>
 #include <util/system.h>
 #include <util/time.h>
 #include <util/translation.h>
 
+#include <algorithm>
+#include <array>
+
+/** The 128 address bits of a network address, most significant first */
+typedef std::array<uint8_t, 16> AddrBits;
+
+static AddrBits GetAddrBits(const CNetAddr& addr)
+{
+    AddrBits bits;
+    for (int i = 0; i < 16; ++i) {
+        bits[i] = addr.GetByte(15 - i);
+    }
+    return bits;
+}
+
+static int GetBit(const AddrBits& bits, int n)
+{
+    return (bits[n >> 3] >> (7 - (n & 7))) & 1;
+}
+
+/** Number of leading bits, up to max_len, two addresses have in common */
+static int CommonPrefixLength(const AddrBits& a, const AddrBits& b, int max_len)
+{
+    int n = 0;
+    while (n + 8 <= max_len && a[n >> 3] == b[n >> 3]) {
+        n += 8;
+    }
+    while (n < max_len && GetBit(a, n) == GetBit(b, n)) {
+        ++n;
+    }
+    return n;
+}
+
+/** Clear the bits after the first len */
+static AddrBits MaskBits(AddrBits bits, int len)
+{
+    for (int n = len; n < 128; ++n) {
+        bits[n >> 3] &= ~(1 << (7 - (n & 7)));
+    }
+    return bits;
+}
+
+/** A node of the radix tree, for the addresses starting with the first len bits of prefix */
+struct BanIndex::Node {
+    AddrBits prefix;
+    int len;
+    const Ban* ban{nullptr};
+    std::unique_ptr<Node> children[2];
+
+    Node(const AddrBits& prefix_in, int len_in) : prefix(MaskBits(prefix_in, len_in)), len(len_in) {}
+};
+
+BanIndex::BanIndex() : m_root(MakeUnique<Node>(AddrBits{}, 0)) {}
+
+BanIndex::~BanIndex() {}
+
+void BanIndex::Insert(const Ban& ban)
+{
+    const CSubNet& sub_net = ban.first;
+    if (!sub_net.IsValid()) return; // Invalid subnets never match
+    const int len = sub_net.GetPrefixLength();
+    if (len < 0) {
+        if (std::find(m_non_prefix.begin(), m_non_prefix.end(), &ban) == m_non_prefix.end()) {
+            m_non_prefix.push_back(&ban);
+        }
+        return;
+    }
+
+    const AddrBits key = GetAddrBits(sub_net.GetNetwork());
+    Node* node = m_root.get();
+    while (node->len < len) {
+        std::unique_ptr<Node>& child = node->children[GetBit(key, node->len)];
+        if (!child) {
+            child = MakeUnique<Node>(key, len);
+            node = child.get();
+            break;
+        }
+        const int common = CommonPrefixLength(child->prefix, key, std::min(child->len, len));
+        if (common < child->len) {
+            // Split the edge to the child at the first bit the prefixes differ in.
+            std::unique_ptr<Node> split = MakeUnique<Node>(key, common);
+            const int bit = GetBit(child->prefix, common);
+            split->children[bit] = std::move(child);
+            child = std::move(split);
+        }
+        node = child.get();
+    }
+    node->ban = &ban;
+}
+
+void BanIndex::Clear()
+{
+    m_root = MakeUnique<Node>(AddrBits{}, 0);
+    m_non_prefix.clear();
+}
+
+std::vector<const BanIndex::Ban*> BanIndex::Match(const CNetAddr& addr) const
+{
+    std::vector<const Ban*> bans;
+    if (!addr.IsValid()) return bans;
+
+    const AddrBits key = GetAddrBits(addr);
+    const Node* node = m_root.get();
+    while (node && CommonPrefixLength(node->prefix, key, node->len) == node->len) {
+        if (node->ban) bans.push_back(node->ban);
+        if (node->len == 128) break;
+        node = node->children[GetBit(key, node->len)].get();
+    }
+    for (const Ban* ban : m_non_prefix) {
+        if (ban->first.Match(addr)) bans.push_back(ban);
+    }
+    return bans;
+}
 
 BanMan::BanMan(fs::path ban_file, CClientUIInterface* client_interface, int64_t default_ban_time)
     : m_client_interface(client_interface), m_ban_db(std::move(ban_file)), m_default_ban_time(default_ban_time)
@@ -62,6 +176,8 @@ void BanMan::ClearBanned()
     {
         LOCK(m_cs_banned);
         m_banned.clear();
+        m_ban_index.Clear();
+        m_ban_index_stale = false;
         m_is_dirty = true;
     }
     DumpBanlist(); //store banlist to disk
@@ -77,11 +193,11 @@ int BanMan::IsBannedLevel(CNetAddr net_addr)
     int level = 0;
     auto current_time = GetTime();
     LOCK(m_cs_banned);
-    for (const auto& it : m_banned) {
-        CSubNet sub_net = it.first;
-        CBanEntry ban_entry = it.second;
+    UpdateBanIndex();
+    for (const BanIndex::Ban* ban : m_ban_index.Match(net_addr)) {
+        const CBanEntry& ban_entry = ban->second;
 
-        if (current_time < ban_entry.nBanUntil && sub_net.Match(net_addr)) {
+        if (current_time < ban_entry.nBanUntil) {
             if (ban_entry.banReason != BanReasonNodeMisbehaving) return 2;
             level = 1;
         }
@@ -93,11 +209,9 @@ bool BanMan::IsBanned(CNetAddr net_addr)
 {
     auto current_time = GetTime();
     LOCK(m_cs_banned);
-    for (const auto& it : m_banned) {
-        CSubNet sub_net = it.first;
-        CBanEntry ban_entry = it.second;
-
-        if (current_time < ban_entry.nBanUntil && sub_net.Match(net_addr)) {
+    UpdateBanIndex();
+    for (const BanIndex::Ban* ban : m_ban_index.Match(net_addr)) {
+        if (current_time < ban->second.nBanUntil) {
             return true;
         }
     }
@@ -140,6 +254,7 @@ void BanMan::Ban(const CSubNet& sub_net, const BanReason& ban_reason, int64_t ba
         LOCK(m_cs_banned);
         if (m_banned[sub_net].nBanUntil < ban_entry.nBanUntil) {
             m_banned[sub_net] = ban_entry;
+            m_ban_index.Insert(*m_banned.find(sub_net));
             m_is_dirty = true;
         } else
             return;
@@ -161,6 +276,7 @@ bool BanMan::Unban(const CSubNet& sub_net)
     {
         LOCK(m_cs_banned);
         if (m_banned.erase(sub_net) == 0) return false;
+        m_ban_index_stale = true;
         m_is_dirty = true;
     }
     if (m_client_interface) m_client_interface->BannedListChanged();
@@ -180,6 +296,7 @@ void BanMan::SetBanned(const banmap_t& banmap)
 {
     LOCK(m_cs_banned);
     m_banned = banmap;
+    m_ban_index_stale = true;
     m_is_dirty = true;
 }
 
@@ -195,6 +312,7 @@ void BanMan::SweepBanned()
             CBanEntry ban_entry = (*it).second;
             if (now > ban_entry.nBanUntil) {
                 m_banned.erase(it++);
+                m_ban_index_stale = true;
                 m_is_dirty = true;
                 notify_ui = true;
                 LogPrint(BCLog::NET, "%s: Removed banned node ip/subnet from banlist.dat: %s\n", __func__, sub_net.ToString());
@@ -208,6 +326,16 @@ void BanMan::SweepBanned()
     }
 }
 
+void BanMan::UpdateBanIndex()
+{
+    if (!m_ban_index_stale) return;
+    m_ban_index.Clear();
+    for (const auto& ban : m_banned) {
+        m_ban_index.Insert(ban);
+    }
+    m_ban_index_stale = false;
+}
+
 bool BanMan::BannedSetIsDirty()
 {
     LOCK(m_cs_banned);
@@ -7,6 +7,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include <addrdb.h>
 #include <fs.h>
@@ -35,6 +36,32 @@ class CSubNet;
 // between nodes running old code and nodes running
 // new code.
 
+/**
+ * Index of banned subnets by network prefix. The bans matching an address are
+ * found in a walk down a radix tree over the 128 address bits, instead of by
+ * matching the address against every ban. Subnets with a netmask that is not a
+ * prefix are rare, and are matched one by one.
+ */
+class BanIndex
+{
+public:
+    typedef banmap_t::value_type Ban;
+
+    BanIndex();
+    ~BanIndex();
+
+    /** Index a ban, which must stay in the banmap until the index is cleared. */
+    void Insert(const Ban& ban);
+    void Clear();
+    /** Get the bans whose subnet matches the address. */
+    std::vector<const Ban*> Match(const CNetAddr& addr) const;
+
+private:
+    struct Node;
+    std::unique_ptr<Node> m_root;
+    std::vector<const Ban*> m_non_prefix;
+};
+
 class BanMan
 {
 public:
@@ -58,9 +85,14 @@ private:
     void SetBannedSetDirty(bool dirty = true);
     //!clean unused entries (if bantime has expired)
     void SweepBanned();
+    //!rebuild m_ban_index if bans were removed since it was built
+    void UpdateBanIndex() EXCLUSIVE_LOCKS_REQUIRED(m_cs_banned);
 
     CCriticalSection m_cs_banned;
     banmap_t m_banned GUARDED_BY(m_cs_banned);
+    BanIndex m_ban_index GUARDED_BY(m_cs_banned);
+    //!whether bans were removed from m_banned, and remain in m_ban_index
+    bool m_ban_index_stale GUARDED_BY(m_cs_banned){false};
     bool m_is_dirty GUARDED_BY(m_cs_banned);
     CClientUIInterface* m_client_interface = nullptr;
     CBanDB m_ban_db;
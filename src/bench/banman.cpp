@@ -0,0 +1,50 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <banman.h>
+#include <bench/bench.h>
+#include <netaddress.h>
+#include <random.h>
+#include <util/system.h>
+
+static CNetAddr RandomIPv4(FastRandomContext& rng)
+{
+    struct in_addr ipv4;
+    ipv4.s_addr = rng.rand32();
+    return CNetAddr(ipv4);
+}
+
+static CNetAddr RandomIPv6(FastRandomContext& rng)
+{
+    struct in6_addr ipv6;
+    std::vector<unsigned char> bytes = rng.randbytes(16);
+    bytes[0] = 0x20; // 2000::/8, global unicast
+    memcpy(ipv6.s6_addr, bytes.data(), 16);
+    return CNetAddr(ipv6);
+}
+
+/** Check addresses, mostly not banned, against a large imported ban list. */
+static void BanManIsBanned(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    BanMan banman(GetDataDir() / "banlist.dat", nullptr, DEFAULT_MISBEHAVING_BANTIME);
+    for (int i = 0; i < 10000; ++i) {
+        banman.Ban(CNetAddr(RandomIPv4(rng)), BanReasonNodeMisbehaving);
+        banman.Ban(CSubNet(RandomIPv4(rng), 24), BanReasonNodeMisbehaving);
+        banman.Ban(CNetAddr(RandomIPv6(rng)), BanReasonNodeMisbehaving);
+        banman.Ban(CSubNet(RandomIPv6(rng), 48), BanReasonNodeMisbehaving);
+    }
+
+    std::vector<CNetAddr> addrs;
+    for (int i = 0; i < 1000; ++i) {
+        addrs.push_back(RandomIPv4(rng));
+        addrs.push_back(RandomIPv6(rng));
+    }
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        banman.IsBanned(addrs[i++ % addrs.size()]);
+    }
+}
+
+BENCHMARK(BanManIsBanned, 100 * 1000);
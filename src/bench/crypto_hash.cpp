@@ -7,6 +7,7 @@
 #include <hash.h>
 #include <random.h>
 #include <uint256.h>
+#include <crypto/muhash.h>
 #include <crypto/ripemd160.h>
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
@@ -91,6 +92,65 @@ static void FastRandom_1bit(benchmark::State& state)
     }
 }
 
+static void MuHash(benchmark::State& state)
+{
+    MuHash3072 acc;
+    unsigned char key[32] = {0};
+    int i = 0;
+    while (state.KeepRunning()) {
+        key[0] = ++i;
+        acc *= MuHash3072(key, sizeof(key));
+    }
+}
+
+static void MuHashMul(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    MuHash3072 acc;
+    std::vector<unsigned char> key{rng.randbytes(32)};
+    MuHash3072 muhash{key.data(), key.size()};
+
+    while (state.KeepRunning()) {
+        acc *= muhash;
+    }
+}
+
+static void MuHashDiv(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    MuHash3072 acc;
+    std::vector<unsigned char> key{rng.randbytes(32)};
+    MuHash3072 muhash{key.data(), key.size()};
+
+    while (state.KeepRunning()) {
+        acc /= muhash;
+    }
+}
+
+static void MuHashPrecompute(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    std::vector<unsigned char> key{rng.randbytes(32)};
+
+    while (state.KeepRunning()) {
+        MuHash3072{key.data(), key.size()};
+    }
+}
+
+static void MuHashFinalize(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    std::vector<unsigned char> key{rng.randbytes(32)};
+    MuHash3072 acc{key.data(), key.size()};
+    key = rng.randbytes(32);
+    acc /= MuHash3072{key.data(), key.size()};
+    uint256 out;
+
+    while (state.KeepRunning()) {
+        acc.Finalize(out);
+    }
+}
+
 BENCHMARK(RIPEMD160, 440);
 BENCHMARK(SHA1, 570);
 BENCHMARK(SHA256, 340);
@@ -101,3 +161,9 @@ BENCHMARK(SipHash_32b, 40 * 1000 * 1000);
 BENCHMARK(SHA256D64_1024, 7400);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
+
+BENCHMARK(MuHash, 5000);
+BENCHMARK(MuHashMul, 5000);
+BENCHMARK(MuHashDiv, 5000);
+BENCHMARK(MuHashPrecompute, 5000);
+BENCHMARK(MuHashFinalize, 50);
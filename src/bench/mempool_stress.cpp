@@ -84,4 +84,57 @@ static void ComplexMemPool(benchmark::State& state)
     }
 }
 
+/** Build a chain of transactions, each spending the single output of the previous one. */
+static std::vector<CTransactionRef> CreateChain(size_t length)
+{
+    std::vector<CTransactionRef> chain;
+    chain.reserve(length);
+    for (size_t i = 0; i < length; ++i) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        if (chain.empty()) {
+            tx.vin[0].scriptSig = CScript() << OP_1;
+        } else {
+            tx.vin[0].prevout = COutPoint(chain.back()->GetHash(), 0);
+        }
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+        tx.vout[0].nValue = COIN;
+        chain.emplace_back(MakeTransactionRef(tx));
+    }
+    return chain;
+}
+
+static void MempoolDeepChain(benchmark::State& state)
+{
+    // Every transaction added walks all of its ancestors.
+    const std::vector<CTransactionRef> chain = CreateChain(1000);
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    while (state.KeepRunning()) {
+        for (const auto& tx : chain) {
+            AddTx(tx, pool);
+        }
+        pool.clear();
+    }
+}
+
+static void MempoolDeepChainDescendants(benchmark::State& state)
+{
+    const std::vector<CTransactionRef> chain = CreateChain(1000);
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    for (const auto& tx : chain) {
+        AddTx(tx, pool);
+    }
+    const auto root = pool.mapTx.find(chain.front()->GetHash());
+    while (state.KeepRunning()) {
+        CTxMemPool::setEntries descendants;
+        pool.CalculateDescendants(root, descendants);
+        assert(descendants.size() == chain.size());
+    }
+}
+
 BENCHMARK(ComplexMemPool, 1);
+BENCHMARK(MempoolDeepChain, 1);
+BENCHMARK(MempoolDeepChainDescendants, 100);
@@ -0,0 +1,95 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <hash.h>
+#include <net.h>
+#include <netmessagemaker.h>
+#include <protocol.h>
+
+#include <cassert>
+#include <vector>
+
+/** Append a message, with its header, to the bytes received from a peer. */
+static void AppendMessage(std::vector<char>& wire, CSerializedNetMsg&& msg)
+{
+    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), msg.data.size());
+    const uint256 hash = Hash(msg.data.data(), msg.data.data() + msg.data.size());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CDataStream header(SER_NETWORK, INIT_PROTO_VERSION);
+    header << hdr;
+    wire.insert(wire.end(), header.begin(), header.end());
+    wire.insert(wire.end(), msg.data.begin(), msg.data.end());
+}
+
+/** Receive the given bytes over and over, in chunks as the socket handler does. */
+static void RecvMessages(benchmark::State& state, const std::vector<char>& wire, std::shared_ptr<RecvBufferPool> pool)
+{
+    std::shared_ptr<RecvBufferAccount> account;
+    if (pool) account = std::make_shared<RecvBufferAccount>(pool, MAX_RECV_POOL_PEER_BYTES);
+    V1TransportDeserializer deserializer(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION, account);
+
+    while (state.KeepRunning()) {
+        for (size_t pos = 0; pos < wire.size();) {
+            const int ret = deserializer.Read(wire.data() + pos, std::min<size_t>(wire.size() - pos, 0x10000));
+            assert(ret > 0);
+            pos += ret;
+            if (deserializer.Complete()) {
+                CNetMessage msg = deserializer.GetMessage(Params().MessageStart(), 0);
+                assert(msg.m_valid_checksum);
+            }
+        }
+    }
+}
+
+/** Small inv, tx and ping messages, which a relay node receives most of the time */
+static std::vector<char> SmallMessages()
+{
+    const CNetMsgMaker msg_maker(PROTOCOL_VERSION);
+    std::vector<char> wire;
+    for (int i = 0; i < 100; ++i) {
+        AppendMessage(wire, msg_maker.Make(NetMsgType::INV, std::vector<CInv>{CInv(MSG_TX, uint256())}));
+        AppendMessage(wire, msg_maker.Make(NetMsgType::TX, std::vector<unsigned char>(250, i)));
+        AppendMessage(wire, msg_maker.Make(NetMsgType::PING, (uint64_t)i));
+    }
+    return wire;
+}
+
+/** Compact block sized messages, and a full block */
+static std::vector<char> LargeMessages()
+{
+    const CNetMsgMaker msg_maker(PROTOCOL_VERSION);
+    std::vector<char> wire;
+    for (int i = 0; i < 10; ++i) {
+        AppendMessage(wire, msg_maker.Make(NetMsgType::CMPCTBLOCK, std::vector<unsigned char>(20000, i)));
+    }
+    AppendMessage(wire, msg_maker.Make(NetMsgType::BLOCK, std::vector<unsigned char>(1000000, 0)));
+    return wire;
+}
+
+static void RecvSmallMessages(benchmark::State& state)
+{
+    RecvMessages(state, SmallMessages(), nullptr);
+}
+
+static void RecvSmallMessagesPooled(benchmark::State& state)
+{
+    RecvMessages(state, SmallMessages(), std::make_shared<RecvBufferPool>());
+}
+
+static void RecvLargeMessages(benchmark::State& state)
+{
+    RecvMessages(state, LargeMessages(), nullptr);
+}
+
+static void RecvLargeMessagesPooled(benchmark::State& state)
+{
+    RecvMessages(state, LargeMessages(), std::make_shared<RecvBufferPool>());
+}
+
+BENCHMARK(RecvSmallMessages, 500);
+BENCHMARK(RecvSmallMessagesPooled, 500);
+BENCHMARK(RecvLargeMessages, 20);
+BENCHMARK(RecvLargeMessagesPooled, 20);
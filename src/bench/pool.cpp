@@ -0,0 +1,60 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <support/allocators/pool.h>
+
+#include <unordered_map>
+
+// The map type CCoinsMap used before it was switched to the pool allocator.
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMapStdAllocator;
+
+static COutPoint MakeOutPoint(uint64_t i)
+{
+    uint256 hash;
+    WriteLE64(hash.begin(), i);
+    return COutPoint(hash, i & 0xff);
+}
+
+// Mimics the access pattern of a CCoinsViewCache while connecting blocks:
+// insert a batch of entries, look them all up, spend half of them and
+// finally flush (clear) the whole map.
+template <typename Map>
+static void BenchCoinsMap(benchmark::State& state, Map& map)
+{
+    const uint64_t batch_size = 5000;
+    uint64_t i = 0;
+    while (state.KeepRunning()) {
+        const uint64_t first = i;
+        for (uint64_t j = 0; j < batch_size; ++j, ++i) {
+            map.emplace(std::piecewise_construct, std::forward_as_tuple(MakeOutPoint(i)), std::tuple<>());
+        }
+        for (uint64_t k = first; k < i; ++k) {
+            auto it = map.find(MakeOutPoint(k));
+            assert(it != map.end());
+            it->second.flags |= CCoinsCacheEntry::DIRTY;
+        }
+        for (uint64_t k = first; k < i; k += 2) {
+            map.erase(MakeOutPoint(k));
+        }
+        map.clear();
+    }
+}
+
+static void CoinsMapStdAllocator(benchmark::State& state)
+{
+    CCoinsMapStdAllocator map;
+    BenchCoinsMap(state, map);
+}
+
+static void CoinsMapPoolAllocator(benchmark::State& state)
+{
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
+    BenchCoinsMap(state, map);
+}
+
+BENCHMARK(CoinsMapStdAllocator, 50);
+BENCHMARK(CoinsMapPoolAllocator, 50);
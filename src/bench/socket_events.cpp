@@ -0,0 +1,126 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <compat.h>
+#include <util/system.h>
+
+#ifdef USE_EPOLL
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+/** Number of connected loopback socket pairs, standing in for peers */
+static constexpr int NUM_PEERS = 4000;
+/** File descriptors left for the rest of the process */
+static constexpr int RESERVED_FDS = 100;
+
+/**
+ * Loopback peers, of which one at a time receives a byte. This is the common
+ * case for a relay node: many mostly idle connections, and few with data.
+ */
+class LoopbackPeers
+{
+public:
+    std::vector<int> local;
+    std::vector<int> remote;
+    int num_peers;
+    int next{0};
+
+    LoopbackPeers()
+    {
+        // Use fewer peers if the file descriptor limit cannot be raised far enough,
+        // but at least one.
+        num_peers = std::max(1, std::min(NUM_PEERS, (RaiseFileDescriptorLimit(2 * NUM_PEERS + RESERVED_FDS) - RESERVED_FDS) / 2));
+        for (int i = 0; i < num_peers; ++i) {
+            int fds[2];
+            const int ret = socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+            assert(ret == 0);
+            local.push_back(fds[0]);
+            remote.push_back(fds[1]);
+        }
+    }
+
+    ~LoopbackPeers()
+    {
+        for (int fd : local) close(fd);
+        for (int fd : remote) close(fd);
+    }
+
+    /** Make the next peer's socket readable. */
+    void Send()
+    {
+        const char byte = 0;
+        const ssize_t ret = write(remote[next], &byte, 1);
+        assert(ret == 1);
+        next = (next + 1) % num_peers;
+    }
+
+    void Receive(int fd)
+    {
+        char byte;
+        const ssize_t ret = read(fd, &byte, 1);
+        assert(ret == 1);
+    }
+};
+
+/** Rebuild the set of sockets and poll() them all, as SocketEvents() does with USE_POLL. */
+static void SocketEventsPoll(benchmark::State& state)
+{
+    LoopbackPeers peers;
+    std::vector<struct pollfd> pollfds;
+    while (state.KeepRunning()) {
+        peers.Send();
+        pollfds.clear();
+        for (int fd : peers.local) {
+            struct pollfd entry;
+            entry.fd = fd;
+            entry.events = POLLIN;
+            entry.revents = 0;
+            pollfds.push_back(entry);
+        }
+        const int ready = poll(pollfds.data(), pollfds.size(), 0);
+        assert(ready == 1);
+        for (const struct pollfd& entry : pollfds) {
+            if (entry.revents & POLLIN) peers.Receive(entry.fd);
+        }
+    }
+}
+
+/** Wait on persistent edge-triggered registrations, as SocketEvents() does with USE_EPOLL. */
+static void SocketEventsEpoll(benchmark::State& state)
+{
+    LoopbackPeers peers;
+    const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    assert(epoll_fd != -1);
+    for (int fd : peers.local) {
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.fd = fd;
+        const int ret = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+        assert(ret == 0);
+    }
+    // Consume the initial writable events.
+    struct epoll_event events[1024];
+    while (epoll_wait(epoll_fd, events, 1024, 0) > 0) {}
+
+    while (state.KeepRunning()) {
+        peers.Send();
+        const int ready = epoll_wait(epoll_fd, events, 1024, 0);
+        assert(ready == 1);
+        peers.Receive(events[0].data.fd);
+    }
+    close(epoll_fd);
+}
+
+BENCHMARK(SocketEventsPoll, 200);
+BENCHMARK(SocketEventsEpoll, 200 * 1000);
+
+#endif // USE_EPOLL
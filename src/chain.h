@@ -129,6 +129,13 @@ enum BlockStatus: uint32_t {
     BLOCK_FAILED_MASK        =   BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
 
     BLOCK_OPT_WITNESS       =   128, //!< block data in blk*.data was received with a witness-enforcing client
+
+    /**
+     * The block's transactions have not been downloaded or validated; the
+     * block is an ancestor of (or is) the base of a UTXO snapshot that the
+     * active chainstate was loaded from, and nTx/nChainTx are placeholders.
+     */
+    BLOCK_ASSUMED_VALID      =   256,
 };
 
 /** The block chain is a tree shaped structure starting with the
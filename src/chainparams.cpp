@@ -316,6 +316,15 @@ public:
             0
         };
 
+        m_assumeutxo_data = MapAssumeutxo{
+            {
+                // Snapshot of the 100-block chain produced by the functional
+                // tests with mocktime set to genesis time + 1.
+                100,
+                {uint256S("0xd4b614f476b99a6e569973bf1c0120d88b1a168076f8ce25691fb41dd1cef149"), 100, 101},
+            },
+        };
+
         base58Prefixes[PUBKEY_ADDRESS] = std::vector<unsigned char>(1,111);
         base58Prefixes[SCRIPT_ADDRESS] = std::vector<unsigned char>(1,196);
         base58Prefixes[SECRET_KEY] =     std::vector<unsigned char>(1,239);
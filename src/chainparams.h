@@ -37,6 +37,28 @@ struct ChainTxData {
     double dTxRate;   //!< estimated number of transactions per second after that timestamp
 };
 
+/**
+ * Holds configuration for use during UTXO snapshot load and validation. The contents
+ * here are security critical, since they dictate which UTXO snapshots are recognized
+ * as valid.
+ */
+struct AssumeutxoData {
+    //! The expected hash of the deserialized UTXO set (see GetUTXOStats).
+    uint256 hash_serialized;
+
+    //! The expected number of coins in the UTXO set.
+    uint64_t coins_count;
+
+    //! Used to populate the nChainTx value of the snapshot base block.
+    unsigned int nChainTx;
+};
+
+/**
+ * Mapping from the height of a snapshot base block to the UTXO set data that
+ * a snapshot built at that height must match.
+ */
+typedef std::map<int, AssumeutxoData> MapAssumeutxo;
+
 /**
  * CChainParams defines various tweakable parameters of a given instance of the
  * Bitcoin system. There are three: the main network on which people trade goods
@@ -84,6 +106,8 @@ public:
     const std::vector<SeedSpec6>& FixedSeeds() const { return vFixedSeeds; }
     const CCheckpointData& Checkpoints() const { return checkpointData; }
     const ChainTxData& TxData() const { return chainTxData; }
+    /** UTXO snapshots that may be loaded with loadtxoutset, keyed by base block height */
+    const MapAssumeutxo& Assumeutxo() const { return m_assumeutxo_data; }
 protected:
     CChainParams() {}
 
@@ -104,6 +128,7 @@ protected:
     bool m_is_test_chain;
     CCheckpointData checkpointData;
     ChainTxData chainTxData;
+    MapAssumeutxo m_assumeutxo_data;
 };
 
 /**
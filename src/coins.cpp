@@ -7,6 +7,7 @@
 #include <consensus/consensus.h>
 #include <logging.h>
 #include <random.h>
+#include <util/memory.h>
 #include <version.h>
 
 bool CCoinsView::GetCoin(const COutPoint &outpoint, Coin &coin) const { return false; }
@@ -33,7 +34,7 @@ size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
 
 SaltedOutpointHasher::SaltedOutpointHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {}
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), m_cache_coins_memory_resource(MakeUnique<CCoinsMapMemoryResource>()), cacheCoins(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), m_cache_coins_memory_resource.get()), cachedCoinsUsage(0) {}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
     return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
@@ -204,9 +205,40 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
 
 bool CCoinsViewCache::Flush() {
     bool fOk = base->BatchWrite(cacheCoins, hashBlock);
+    ClearCache();
+    return fOk;
+}
+
+void CCoinsViewCache::MoveEntriesTo(CCoinsViewCache& dest)
+{
+    assert(dest.cacheCoins.empty());
+    // The map is move-constructed together with the pool its nodes live in,
+    // so no entry is copied.
+    dest.cacheCoins.~CCoinsMap();
+    dest.m_cache_coins_memory_resource = std::move(m_cache_coins_memory_resource);
+    ::new (&dest.cacheCoins) CCoinsMap(std::move(cacheCoins));
+    dest.cachedCoinsUsage = cachedCoinsUsage;
+    dest.hashBlock = hashBlock;
+
+    cacheCoins.~CCoinsMap();
+    m_cache_coins_memory_resource = MakeUnique<CCoinsMapMemoryResource>();
+    ::new (&cacheCoins) CCoinsMap(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), m_cache_coins_memory_resource.get());
+    cachedCoinsUsage = 0;
+}
+
+void CCoinsViewCache::ClearCache()
+{
     cacheCoins.clear();
     cachedCoinsUsage = 0;
-    return fOk;
+    ReallocateCache();
+}
+
+void CCoinsViewCache::ReallocateCache()
+{
+    assert(cacheCoins.size() == 0);
+    cacheCoins.~CCoinsMap();
+    m_cache_coins_memory_resource = MakeUnique<CCoinsMapMemoryResource>();
+    ::new (&cacheCoins) CCoinsMap(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), m_cache_coins_memory_resource.get());
 }
 
 void CCoinsViewCache::Uncache(const COutPoint& hash)
@@ -218,6 +250,30 @@ void CCoinsViewCache::Uncache(const COutPoint& hash)
     }
 }
 
+bool CCoinsViewCache::WarmCoin(const COutPoint& outpoint, Coin&& coin)
+{
+    if (coin.IsSpent()) return false;
+    std::pair<CCoinsMap::iterator, bool> inserted = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(coin)));
+    if (!inserted.second) return false;
+    cachedCoinsUsage += inserted.first->second.coin.DynamicMemoryUsage();
+    return true;
+}
+
+void CCoinsViewCache::ForEachModifiedCoin(const std::function<void(const COutPoint&, const Coin&, const Coin&)>& func) const
+{
+    const Coin spent;
+    for (const auto& entry : cacheCoins) {
+        if (!(entry.second.flags & CCoinsCacheEntry::DIRTY)) continue;
+        // A FRESH entry was not in the backing view, or only as a spent coin.
+        Coin previous;
+        if (entry.second.flags & CCoinsCacheEntry::FRESH || !base->GetCoin(entry.first, previous)) {
+            func(entry.first, spent, entry.second.coin);
+        } else {
+            func(entry.first, previous, entry.second.coin);
+        }
+    }
+}
+
 unsigned int CCoinsViewCache::GetCacheSize() const {
     return cacheCoins.size();
 }
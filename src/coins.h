@@ -12,12 +12,14 @@
 #include <crypto/siphash.h>
 #include <memusage.h>
 #include <serialize.h>
+#include <support/allocators/pool.h>
 #include <uint256.h>
 
 #include <assert.h>
 #include <stdint.h>
 
 #include <functional>
+#include <memory>
 #include <unordered_map>
 
 /**
@@ -128,7 +130,24 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * PoolAllocator's MAX_BLOCK_SIZE_BYTES parameter here uses sizeof the data, and adds the size
+ * of 4 pointers. We do not know the exact node size used in the std::unordered_node implementation
+ * because it is implementation defined. Most implementations have an overhead of 1 or 2 pointers,
+ * so nodes can be connected in a linked list, and in some cases the hash value is stored as well.
+ * Using an additional sizeof(void*)*4 for MAX_BLOCK_SIZE_BYTES should thus be sufficient so that
+ * all implementations can allocate the nodes from the PoolAllocator.
+ */
+typedef std::unordered_map<COutPoint,
+                           CCoinsCacheEntry,
+                           SaltedOutpointHasher,
+                           std::equal_to<COutPoint>,
+                           PoolAllocator<std::pair<const COutPoint, CCoinsCacheEntry>,
+                                         sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4,
+                                         alignof(void*)>>
+    CCoinsMap;
+
+typedef CCoinsMap::allocator_type::ResourceType CCoinsMapMemoryResource;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -215,6 +234,8 @@ protected:
      * declared as "const".
      */
     mutable uint256 hashBlock;
+    /* The cache entries are allocated from this pool, which must outlive cacheCoins. */
+    std::unique_ptr<CCoinsMapMemoryResource> m_cache_coins_memory_resource;
     mutable CCoinsMap cacheCoins;
 
     /* Cached dynamic memory usage for the inner Coin objects. */
@@ -277,12 +298,36 @@ public:
      */
     bool Flush();
 
+    /**
+     * Move all entries and the best block of this cache into `dest`, which
+     * must be empty. Unlike Flush(), nothing is written to the backing view:
+     * this cache is left empty, at the same best block, so `dest` can be
+     * written out later without holding up users of this cache.
+     */
+    void MoveEntriesTo(CCoinsViewCache& dest);
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is
      * not modified.
      */
     void Uncache(const COutPoint &outpoint);
 
+    /**
+     * Insert a coin that was read from the backing view on another thread,
+     * without marking it as modified. Nothing is changed if the cache already
+     * holds an entry (spent or not) for the outpoint, so this can never
+     * overwrite newer state. Returns whether the coin was inserted.
+     */
+    bool WarmCoin(const COutPoint& outpoint, Coin&& coin);
+
+    /**
+     * Call func(outpoint, previous, coin) for every coin modified in this
+     * cache but not yet flushed, where previous is the coin the backing view
+     * holds for the outpoint. Spent coins stand for outpoints without an
+     * unspent output.
+     */
+    void ForEachModifiedCoin(const std::function<void(const COutPoint&, const Coin&, const Coin&)>& func) const;
+
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
@@ -308,6 +353,17 @@ private:
      * memory usage.
      */
     CCoinsMap::iterator FetchCoin(const COutPoint &outpoint) const;
+
+    /**
+     * Release the pooled memory of an empty cache. Pool memory is only handed
+     * back on destruction of the resource, so without this a flushed cache
+     * would keep its peak memory usage.
+     */
+    void ReallocateCache();
+
+protected:
+    //! Drop all entries, e.g. once they were written out by other means than Flush().
+    void ClearCache();
 };
 
 //! Utility function to add all of a transaction's outputs to a cache.
@@ -93,6 +93,10 @@ typedef char* sockopt_arg_type;
 // __APPLE__ poll is broke https://github.com/bitcoin/bitcoin/pull/14336#issuecomment-437384408
 #if defined(__linux__)
 #define USE_POLL
+#if !defined(DISABLE_EPOLL)
+// Wait for socket events with epoll, which keeps sockets registered between waits.
+#define USE_EPOLL
+#endif
 #endif
 
 bool static inline IsSelectableSocket(const SOCKET& s) {
@@ -0,0 +1,230 @@
+// Copyright (c) 2017-2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/muhash.h>
+
+#include <crypto/chacha20.h>
+#include <crypto/common.h>
+#include <crypto/sha256.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <limits>
+
+namespace {
+
+using limb_t = Num3072::limb_t;
+using double_limb_t = Num3072::double_limb_t;
+constexpr int LIMB_SIZE = Num3072::LIMB_SIZE;
+constexpr int LIMBS = Num3072::LIMBS;
+/** 2^3072 - 1103717, the largest 3072-bit safe prime number, is used as the modulus. */
+constexpr limb_t MAX_PRIME_DIFF = 1103717;
+
+/** [c0,c1,c2] += a * b */
+inline void muladd3(limb_t& c0, limb_t& c1, limb_t& c2, const limb_t& a, const limb_t& b)
+{
+    double_limb_t t = (double_limb_t)a * b;
+    limb_t th = t >> LIMB_SIZE;
+    limb_t tl = t;
+
+    c0 += tl;
+    th += (c0 < tl) ? 1 : 0;
+    c1 += th;
+    c2 += (c1 < th) ? 1 : 0;
+}
+
+/** Extract the lowest limb of [c0,c1,c2] into n, and left shift the number by 1 limb. */
+inline void extract3(limb_t& c0, limb_t& c1, limb_t& c2, limb_t& n)
+{
+    n = c0;
+    c0 = c1;
+    c1 = c2;
+    c2 = 0;
+}
+
+inline limb_t ReadLimb(const unsigned char* data)
+{
+#ifdef __SIZEOF_INT128__
+    return ReadLE64(data);
+#else
+    return ReadLE32(data);
+#endif
+}
+
+inline void WriteLimb(unsigned char* data, limb_t x)
+{
+#ifdef __SIZEOF_INT128__
+    WriteLE64(data, x);
+#else
+    WriteLE32(data, x);
+#endif
+}
+
+} // namespace
+
+/** Indicates whether d is larger than the modulus. */
+bool Num3072::IsOverflow() const
+{
+    if (limbs[0] <= std::numeric_limits<limb_t>::max() - MAX_PRIME_DIFF) return false;
+    for (int i = 1; i < LIMBS; ++i) {
+        if (limbs[i] != std::numeric_limits<limb_t>::max()) return false;
+    }
+    return true;
+}
+
+/** Subtract the modulus from a number in [modulus, 2^3072). */
+void Num3072::FullReduce()
+{
+    // x - (2^3072 - MAX_PRIME_DIFF) = x + MAX_PRIME_DIFF - 2^3072: the carry out of the top is dropped.
+    limb_t carry = MAX_PRIME_DIFF;
+    for (int i = 0; i < LIMBS && carry; ++i) {
+        limbs[i] += carry;
+        carry = limbs[i] < carry ? 1 : 0;
+    }
+}
+
+void Num3072::Multiply(const Num3072& a)
+{
+    limb_t c0 = 0, c1 = 0, c2 = 0;
+    limb_t tmp[LIMBS * 2];
+
+    // Schoolbook multiplication into a 6144-bit product, one column at a time.
+    for (int i = 0; i < LIMBS * 2 - 1; ++i) {
+        const int lo = std::max(0, i - (LIMBS - 1));
+        const int hi = std::min(i, LIMBS - 1);
+        for (int j = lo; j <= hi; ++j) {
+            muladd3(c0, c1, c2, limbs[j], a.limbs[i - j]);
+        }
+        extract3(c0, c1, c2, tmp[i]);
+    }
+    tmp[LIMBS * 2 - 1] = c0;
+
+    // Reduce: hi * 2^3072 + lo is congruent to lo + hi * MAX_PRIME_DIFF.
+    double_limb_t carry = 0;
+    for (int i = 0; i < LIMBS; ++i) {
+        carry += (double_limb_t)tmp[LIMBS + i] * MAX_PRIME_DIFF + tmp[i];
+        limbs[i] = carry;
+        carry >>= LIMB_SIZE;
+    }
+    // Fold what is left above 2^3072 back in the same way. This can only
+    // overflow again if the result wraps around to a small number, to which
+    // the second fold adds MAX_PRIME_DIFF without further overflow.
+    for (int round = 0; round < 2 && carry; ++round) {
+        carry *= MAX_PRIME_DIFF;
+        for (int i = 0; i < LIMBS && carry; ++i) {
+            carry += limbs[i];
+            limbs[i] = carry;
+            carry >>= LIMB_SIZE;
+        }
+    }
+    assert(carry == 0);
+
+    if (IsOverflow()) FullReduce();
+}
+
+Num3072 Num3072::GetInverse() const
+{
+    // Fermat's little theorem: x^(p-2) is the inverse of x modulo the prime p.
+    // Every bit of p - 2 is set except for some in its lowest limb.
+    const limb_t low_limb = std::numeric_limits<limb_t>::max() - MAX_PRIME_DIFF - 1;
+    Num3072 out;
+    for (int i = LIMBS - 1; i >= 0; --i) {
+        const limb_t exp = i ? std::numeric_limits<limb_t>::max() : low_limb;
+        for (int bit = LIMB_SIZE - 1; bit >= 0; --bit) {
+            out.Multiply(out);
+            if ((exp >> bit) & 1) out.Multiply(*this);
+        }
+    }
+    return out;
+}
+
+void Num3072::Divide(const Num3072& a)
+{
+    if (this->IsOverflow()) this->FullReduce();
+
+    Num3072 inv{};
+    if (a.IsOverflow()) {
+        Num3072 b = a;
+        b.FullReduce();
+        inv = b.GetInverse();
+    } else {
+        inv = a.GetInverse();
+    }
+
+    this->Multiply(inv);
+    if (this->IsOverflow()) this->FullReduce();
+}
+
+void Num3072::SetToOne()
+{
+    limbs[0] = 1;
+    for (int i = 1; i < LIMBS; ++i) {
+        limbs[i] = 0;
+    }
+}
+
+Num3072::Num3072(const unsigned char (&data)[BYTE_SIZE])
+{
+    for (int i = 0; i < LIMBS; ++i) {
+        limbs[i] = ReadLimb(data + i * sizeof(limb_t));
+    }
+}
+
+void Num3072::ToBytes(unsigned char (&out)[BYTE_SIZE]) const
+{
+    for (int i = 0; i < LIMBS; ++i) {
+        WriteLimb(out + i * sizeof(limb_t), limbs[i]);
+    }
+}
+
+Num3072 MuHash3072::ToNum3072(const unsigned char* data, size_t len)
+{
+    unsigned char hashed_in[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(data, len).Finalize(hashed_in);
+    unsigned char tmp[Num3072::BYTE_SIZE];
+    ChaCha20(hashed_in, sizeof(hashed_in)).Keystream(tmp, Num3072::BYTE_SIZE);
+    return Num3072(tmp);
+}
+
+MuHash3072::MuHash3072(const unsigned char* data, size_t len) noexcept
+{
+    m_numerator = ToNum3072(data, len);
+}
+
+MuHash3072& MuHash3072::Insert(const unsigned char* data, size_t len) noexcept
+{
+    m_numerator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::Remove(const unsigned char* data, size_t len) noexcept
+{
+    m_denominator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator*=(const MuHash3072& mul) noexcept
+{
+    m_numerator.Multiply(mul.m_numerator);
+    m_denominator.Multiply(mul.m_denominator);
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator/=(const MuHash3072& div) noexcept
+{
+    m_numerator.Multiply(div.m_denominator);
+    m_denominator.Multiply(div.m_numerator);
+    return *this;
+}
+
+void MuHash3072::Finalize(uint256& out) const noexcept
+{
+    Num3072 value = m_numerator;
+    value.Divide(m_denominator);
+
+    unsigned char data[Num3072::BYTE_SIZE];
+    value.ToBytes(data);
+
+    CSHA256().Write(data, sizeof(data)).Finalize(out.begin());
+}
@@ -113,6 +113,23 @@ public:
     size_t SizeEstimate() const { return size_estimate; }
 };
 
+/** A consistent read-only view of a database as of the moment it was created. */
+class CDBSnapshot
+{
+    friend class CDBWrapper;
+private:
+    leveldb::DB* const pdb;
+    const leveldb::Snapshot* const snapshot;
+
+    explicit CDBSnapshot(leveldb::DB* pdb_in) : pdb(pdb_in), snapshot(pdb_in->GetSnapshot()) {}
+
+public:
+    ~CDBSnapshot() { pdb->ReleaseSnapshot(snapshot); }
+
+    CDBSnapshot(const CDBSnapshot&) = delete;
+    CDBSnapshot& operator=(const CDBSnapshot&) = delete;
+};
+
 class CDBIterator
 {
 private:
@@ -309,6 +326,23 @@ public:
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
     }
 
+    /**
+     * Take a snapshot of the database. It must be released, by destroying
+     * it, before this instance is destroyed.
+     */
+    std::unique_ptr<const CDBSnapshot> GetSnapshot() const
+    {
+        return std::unique_ptr<const CDBSnapshot>(new CDBSnapshot(pdb));
+    }
+
+    /** Iterate over the state of the database as of the given snapshot. */
+    CDBIterator *NewIterator(const CDBSnapshot& snapshot) const
+    {
+        leveldb::ReadOptions options = iteroptions;
+        options.snapshot = snapshot.snapshot;
+        return new CDBIterator(*this, pdb->NewIterator(options));
+    }
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
@@ -0,0 +1,261 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <crypto/sha256.h>
+#include <index/addrindex.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+/* The index database stores one entry per output paying to a scriptPubKey and one per input
+ * spending such an output. Keys have the type
+ * [DB_ADDR_ENTRY, SHA256(scriptPubKey), height (BE), type, txid, output or input index (BE)],
+ * so that the entries of a scriptPubKey are contiguous and ordered by height. Values hold the
+ * amount and, for spending entries, the outpoint spent.
+ *
+ * Entries of blocks that are not yet committed, or that are reorganized out of the active chain,
+ * have to be erased. To find them, the hash of each block written is kept under
+ * [DB_BLOCK_HEIGHT, height (BE)] in the same batch as the block's entries.
+ */
+constexpr char DB_ADDR_ENTRY = 'a';
+constexpr char DB_BLOCK_HEIGHT = 'h';
+
+/** Size of the pending batch above which it is written out during sync */
+constexpr size_t MAX_BATCH_SIZE = 16 << 20;
+
+namespace {
+
+enum EntryType : uint8_t {
+    FUNDING = 0,
+    SPENDING = 1,
+};
+
+struct DBEntryKey {
+    uint256 script_hash;
+    int height;
+    uint8_t type;
+    uint256 txid;
+    uint32_t index;
+
+    DBEntryKey() : height(0), type(FUNDING), index(0) {}
+    DBEntryKey(const uint256& script_hash_in, int height_in, uint8_t type_in, const uint256& txid_in, uint32_t index_in) :
+        script_hash(script_hash_in), height(height_in), type(type_in), txid(txid_in), index(index_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDR_ENTRY);
+        s << script_hash;
+        ser_writedata32be(s, height);
+        ser_writedata8(s, type);
+        s << txid;
+        ser_writedata32be(s, index);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_ADDR_ENTRY) {
+            throw std::ios_base::failure("Invalid format for addrindex DB entry key");
+        }
+        s >> script_hash;
+        height = ser_readdata32be(s);
+        type = ser_readdata8(s);
+        s >> txid;
+        index = ser_readdata32be(s);
+    }
+};
+
+struct DBEntryVal {
+    COutPoint prevout;
+    CAmount value;
+
+    DBEntryVal() : value(0) {}
+    DBEntryVal(const COutPoint& prevout_in, CAmount value_in) : prevout(prevout_in), value(value_in) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(prevout);
+        READWRITE(value);
+    }
+};
+
+struct DBHeightKey {
+    int height;
+
+    explicit DBHeightKey(int height_in) : height(height_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_BLOCK_HEIGHT);
+        ser_writedata32be(s, height);
+    }
+};
+
+uint256 GetScriptHash(const CScript& script)
+{
+    uint256 hash;
+    CSHA256().Write(script.data(), script.size()).Finalize(hash.begin());
+    return hash;
+}
+
+}; // namespace
+
+std::unique_ptr<AddrIndex> g_addr_index;
+
+AddrIndex::AddrIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<BaseIndex::DB>(GetDataDir() / "indexes" / "addrindex", n_cache_size, f_memory, f_wipe)),
+      m_batch(*m_db)
+{}
+
+bool AddrIndex::Init()
+{
+    CBlockLocator locator;
+    if (!m_db->ReadBestBlock(locator)) {
+        locator.SetNull();
+    }
+
+    // Blocks above the point where the index resumes were either written without being
+    // committed, or reorganized out of the active chain while the node was offline. Erase them
+    // before BaseIndex::Init() lets BlockConnected write new ones.
+    const CBlockIndex* fork = nullptr;
+    if (!locator.IsNull()) {
+        LOCK(cs_main);
+        fork = FindForkInGlobalIndex(::ChainActive(), locator);
+    }
+    if (!EraseBlocksAbove(fork ? fork->nHeight : -1)) return false;
+
+    return BaseIndex::Init();
+}
+
+bool AddrIndex::FlushBatch()
+{
+    if (m_batch.SizeEstimate() == 0) return true;
+    if (!m_db->WriteBatch(m_batch)) return false;
+    m_batch.Clear();
+    return true;
+}
+
+bool AddrIndex::CommitInternal(CDBBatch& batch)
+{
+    // The entries must be on disk before the locator that covers them.
+    if (!FlushBatch()) {
+        return error("%s: Failed to write pending %s entries", __func__, GetName());
+    }
+    return BaseIndex::CommitInternal(batch);
+}
+
+bool AddrIndex::ApplyBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex, bool erase) const
+{
+    // The genesis block's outputs are unspendable.
+    if (pindex->nHeight == 0) return true;
+
+    CBlockUndo block_undo;
+    if (!UndoReadFromDisk(block_undo, pindex)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txid = tx.GetHash();
+        for (uint32_t j = 0; j < tx.vout.size(); ++j) {
+            const CTxOut& out = tx.vout[j];
+            if (out.scriptPubKey.IsUnspendable()) continue;
+            const DBEntryKey key(GetScriptHash(out.scriptPubKey), pindex->nHeight, FUNDING, txid, j);
+            if (erase) {
+                batch.Erase(key);
+            } else {
+                batch.Write(key, DBEntryVal(COutPoint(), out.nValue));
+            }
+        }
+
+        if (tx.IsCoinBase()) continue;
+        const CTxUndo& tx_undo = block_undo.vtxundo.at(i - 1);
+        for (uint32_t j = 0; j < tx.vin.size(); ++j) {
+            const CTxOut& spent = tx_undo.vprevout.at(j).out;
+            const DBEntryKey key(GetScriptHash(spent.scriptPubKey), pindex->nHeight, SPENDING, txid, j);
+            if (erase) {
+                batch.Erase(key);
+            } else {
+                batch.Write(key, DBEntryVal(tx.vin[j].prevout, spent.nValue));
+            }
+        }
+    }
+    return true;
+}
+
+bool AddrIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    if (!ApplyBlock(m_batch, block, pindex, /* erase */ false)) return false;
+    m_batch.Write(DBHeightKey(pindex->nHeight), pindex->GetBlockHash());
+
+    // While catching up, write in large batches. Once in sync, make each block visible to
+    // lookups as soon as it is connected.
+    if (IsSynced() || m_batch.SizeEstimate() > MAX_BATCH_SIZE) {
+        return FlushBatch();
+    }
+    return true;
+}
+
+bool AddrIndex::EraseBlocksAbove(int height)
+{
+    CDBBatch batch(*m_db);
+    uint256 block_hash;
+    for (int h = height + 1; m_db->Read(DBHeightKey(h), block_hash); ++h) {
+        const CBlockIndex* pindex = WITH_LOCK(cs_main, return LookupBlockIndex(block_hash));
+        CBlock block;
+        if (!pindex || !ReadBlockFromDisk(block, pindex, Params().GetConsensus()) ||
+            !ApplyBlock(batch, block, pindex, /* erase */ true)) {
+            return error("%s: Failed to erase block %s from %s",
+                         __func__, block_hash.ToString(), GetName());
+        }
+        batch.Erase(DBHeightKey(h));
+    }
+    return m_db->WriteBatch(batch);
+}
+
+bool AddrIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    if (!FlushBatch() || !EraseBlocksAbove(new_tip->nHeight)) return false;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+bool AddrIndex::FindEntries(const CScript& script, size_t skip, size_t count, std::vector<Entry>& entries) const
+{
+    entries.clear();
+    const uint256 script_hash = GetScriptHash(script);
+
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    db_it->Seek(std::make_pair(DB_ADDR_ENTRY, script_hash));
+    for (; db_it->Valid() && entries.size() < count; db_it->Next()) {
+        DBEntryKey key;
+        if (!db_it->GetKey(key) || key.script_hash != script_hash) break;
+        if (skip > 0) {
+            --skip;
+            continue;
+        }
+
+        DBEntryVal value;
+        if (!db_it->GetValue(value)) {
+            return error("%s: unable to read value in %s", __func__, GetName());
+        }
+        Entry entry;
+        entry.spending = key.type == SPENDING;
+        entry.height = key.height;
+        entry.txid = key.txid;
+        entry.index = key.index;
+        entry.prevout = value.prevout;
+        entry.value = value.value;
+        entries.push_back(std::move(entry));
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_ADDRINDEX_H
+#define BITCOIN_INDEX_ADDRINDEX_H
+
+#include <amount.h>
+#include <chain.h>
+#include <index/base.h>
+#include <script/script.h>
+
+/**
+ * AddrIndex is used to look up the history of a scriptPubKey: the outputs
+ * that paid to it and the inputs that spent those outputs, ordered by block
+ * height. Entries are keyed by the SHA256 of the scriptPubKey.
+ */
+class AddrIndex final : public BaseIndex
+{
+public:
+    /// An output funding a scriptPubKey, or an input spending one.
+    struct Entry {
+        bool spending{false};
+        int height{0};
+        uint256 txid;
+        /// The output index for funding entries, the input index for spending ones.
+        uint32_t index{0};
+        /// The output spent, for spending entries.
+        COutPoint prevout;
+        CAmount value{0};
+    };
+
+private:
+    const std::unique_ptr<BaseIndex::DB> m_db;
+
+    /// Entries of the blocks written since the last flush. They are written
+    /// to the database in large batches while the index catches up.
+    CDBBatch m_batch;
+
+    bool FlushBatch();
+
+    /// Add the entries of a block to, or erase them from, a batch.
+    bool ApplyBlock(CDBBatch& batch, const CBlock& block, const CBlockIndex* pindex, bool erase) const;
+
+    /// Erase the entries of all blocks written above the given height.
+    bool EraseBlocksAbove(int height);
+
+protected:
+    bool Init() override;
+
+    bool CommitInternal(CDBBatch& batch) override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return "addrindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddrIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Look up the history of a scriptPubKey.
+    ///
+    /// @param[in]   script  The scriptPubKey to look up.
+    /// @param[in]   skip  The number of entries to skip.
+    /// @param[in]   count  The maximum number of entries to return.
+    /// @param[out]  entries  The entries found, by ascending height.
+    /// @return  false if the index could not be read
+    bool FindEntries(const CScript& script, size_t skip, size_t count, std::vector<Entry>& entries) const;
+};
+
+/// The global address index. May be null.
+extern std::unique_ptr<AddrIndex> g_addr_index;
+
+#endif // BITCOIN_INDEX_ADDRINDEX_H
@@ -85,6 +85,9 @@ protected:
 
     virtual DB& GetDB() const = 0;
 
+    /// Whether the index has caught up with the chain and follows BlockConnected notifications.
+    bool IsSynced() const { return m_synced; }
+
     /// Get the name of the index for display in logs.
     virtual const char* GetName() const = 0;
 
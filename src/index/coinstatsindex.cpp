@@ -0,0 +1,317 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <coins.h>
+#include <index/coinstatsindex.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+/* The index database stores the statistics of the UTXO set as of each block: the MuHash3072
+ * digest, the number of coins, their bogosize and total amount. As in the block filter index,
+ * entries of blocks on the active chain are indexed by height, and those of blocks that have been
+ * reorganized out of the active chain are indexed by block hash.
+ *
+ * The full MuHash3072 state of the index's best block, which is needed to continue hashing, is
+ * kept in memory and written under DB_MUHASH together with the best block locator on commit.
+ *
+ * Keys for the height index have the type [DB_BLOCK_HEIGHT, uint32 (BE)].
+ * Keys for the hash index have the type [DB_BLOCK_HASH, uint256].
+ */
+constexpr char DB_BLOCK_HASH = 's';
+constexpr char DB_BLOCK_HEIGHT = 't';
+constexpr char DB_MUHASH = 'M';
+
+namespace {
+
+struct DBVal {
+    uint256 muhash;
+    uint64_t coins_count;
+    uint64_t bogo_size;
+    CAmount total_amount;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(muhash);
+        READWRITE(coins_count);
+        READWRITE(bogo_size);
+        READWRITE(total_amount);
+    }
+};
+
+struct DBHeightKey {
+    int height;
+
+    DBHeightKey() : height(0) {}
+    explicit DBHeightKey(int height_in) : height(height_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_BLOCK_HEIGHT);
+        ser_writedata32be(s, height);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_BLOCK_HEIGHT) {
+            throw std::ios_base::failure("Invalid format for coinstatsindex DB height key");
+        }
+        height = ser_readdata32be(s);
+    }
+};
+
+struct DBHashKey {
+    uint256 hash;
+
+    explicit DBHashKey(const uint256& hash_in) : hash(hash_in) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        char prefix = DB_BLOCK_HASH;
+        READWRITE(prefix);
+        if (prefix != DB_BLOCK_HASH) {
+            throw std::ios_base::failure("Invalid format for coinstatsindex DB hash key");
+        }
+
+        READWRITE(hash);
+    }
+};
+
+/**
+ * The two mainnet blocks exempt from BIP30 contain coinbase transactions identical to those of
+ * earlier blocks, and their outputs replaced the earlier ones in the UTXO set.
+ * @returns the height of the block whose coinbase outputs `pindex` overwrote, or -1.
+ */
+int GetBIP30OverwrittenHeight(const CBlockIndex* pindex)
+{
+    if (pindex->nHeight == 91842 && pindex->GetBlockHash() == uint256S("0x00000000000a4d0a398161ffc163c503763b1f4360639393e0e4c8e300e0caec")) return 91812;
+    if (pindex->nHeight == 91880 && pindex->GetBlockHash() == uint256S("0x00000000000743f190a18c5577a3c2d2a1f610ae9601ac046a38084ccb7cd721")) return 91722;
+    return -1;
+}
+
+}; // namespace
+
+std::unique_ptr<CoinStatsIndex> g_coin_stats_index;
+
+CoinStatsIndex::CoinStatsIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+{
+    fs::path path = GetDataDir() / "indexes" / "coinstats";
+    fs::create_directories(path);
+
+    m_db = MakeUnique<BaseIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe);
+}
+
+bool CoinStatsIndex::Init()
+{
+    if (!m_db->Read(DB_MUHASH, m_stats)) {
+        // Check that the cause of the read failure is that the key does not exist. Any other errors
+        // indicate database corruption or a disk failure, and starting the index would cause
+        // further corruption.
+        if (m_db->Exists(DB_MUHASH)) {
+            return error("%s: Cannot read current %s state; index may be corrupted",
+                         __func__, GetName());
+        }
+        m_stats = RollingCoinStats();
+    }
+
+    CBlockLocator locator;
+    if (!m_db->ReadBestBlock(locator)) {
+        locator.SetNull();
+    }
+    if (locator.IsNull()) return BaseIndex::Init();
+
+    // m_stats belongs to the first block of the locator. If that block was reorganized out of the
+    // active chain while the node was offline, the index resumes from the fork point, so the
+    // blocks above it have to be reversed first. This happens before BaseIndex::Init() lets
+    // BlockConnected update m_stats.
+    const CBlockIndex* stored_index;
+    const CBlockIndex* best_block_index;
+    {
+        LOCK(cs_main);
+        stored_index = LookupBlockIndex(locator.vHave.at(0));
+        best_block_index = FindForkInGlobalIndex(::ChainActive(), locator);
+    }
+    if (!stored_index) {
+        return error("%s: best block of %s not found", __func__, GetName());
+    }
+    for (const CBlockIndex* pindex = stored_index; pindex != best_block_index; pindex = pindex->pprev) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()) || !ReverseBlock(block, pindex)) {
+            return error("%s: unable to reverse block %s in %s",
+                         __func__, pindex->GetBlockHash().ToString(), GetName());
+        }
+    }
+
+    std::pair<uint256, DBVal> read_out;
+    if (!m_db->Read(DBHeightKey(best_block_index->nHeight), read_out) ||
+        read_out.first != best_block_index->GetBlockHash() ||
+        read_out.second.muhash != m_stats.GetHash()) {
+        return error("%s: Cannot read current %s state; index may be corrupted",
+                     __func__, GetName());
+    }
+    return BaseIndex::Init();
+}
+
+bool CoinStatsIndex::CommitInternal(CDBBatch& batch)
+{
+    batch.Write(DB_MUHASH, m_stats);
+    return BaseIndex::CommitInternal(batch);
+}
+
+bool CoinStatsIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // The genesis block's outputs are not added to the UTXO set.
+    if (pindex->nHeight > 0) {
+        CBlockUndo block_undo;
+        if (!UndoReadFromDisk(block_undo, pindex)) {
+            return false;
+        }
+
+        std::pair<uint256, DBVal> read_out;
+        if (!m_db->Read(DBHeightKey(pindex->nHeight - 1), read_out)) {
+            return false;
+        }
+
+        uint256 expected_block_hash = pindex->pprev->GetBlockHash();
+        if (read_out.first != expected_block_hash) {
+            return error("%s: previous block stats belong to unexpected block %s; expected %s",
+                         __func__, read_out.first.ToString(), expected_block_hash.ToString());
+        }
+
+        const int overwritten_height = GetBIP30OverwrittenHeight(pindex);
+        for (size_t i = 0; i < block.vtx.size(); ++i) {
+            const CTransaction& tx = *block.vtx[i];
+            for (uint32_t j = 0; j < tx.vout.size(); ++j) {
+                const CTxOut& out = tx.vout[j];
+                if (out.scriptPubKey.IsUnspendable()) continue;
+                const COutPoint outpoint(tx.GetHash(), j);
+                if (tx.IsCoinBase() && overwritten_height >= 0) {
+                    m_stats.Remove(outpoint, Coin(out, overwritten_height, true));
+                }
+                m_stats.Add(outpoint, Coin(out, pindex->nHeight, tx.IsCoinBase()));
+            }
+
+            if (tx.IsCoinBase()) continue;
+            const CTxUndo& tx_undo = block_undo.vtxundo.at(i - 1);
+            for (size_t j = 0; j < tx.vin.size(); ++j) {
+                m_stats.Remove(tx.vin[j].prevout, tx_undo.vprevout.at(j));
+            }
+        }
+    }
+
+    std::pair<uint256, DBVal> value;
+    value.first = pindex->GetBlockHash();
+    value.second.muhash = m_stats.GetHash();
+    value.second.coins_count = m_stats.coins_count;
+    value.second.bogo_size = m_stats.bogo_size;
+    value.second.total_amount = m_stats.total_amount;
+
+    return m_db->Write(DBHeightKey(pindex->nHeight), value);
+}
+
+bool CoinStatsIndex::ReverseBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    if (pindex->nHeight == 0) return true;
+
+    CBlockUndo block_undo;
+    if (!UndoReadFromDisk(block_undo, pindex)) {
+        return false;
+    }
+
+    const int overwritten_height = GetBIP30OverwrittenHeight(pindex);
+    for (size_t i = block.vtx.size(); i-- > 0;) {
+        const CTransaction& tx = *block.vtx[i];
+        for (uint32_t j = 0; j < tx.vout.size(); ++j) {
+            const CTxOut& out = tx.vout[j];
+            if (out.scriptPubKey.IsUnspendable()) continue;
+            const COutPoint outpoint(tx.GetHash(), j);
+            m_stats.Remove(outpoint, Coin(out, pindex->nHeight, tx.IsCoinBase()));
+            if (tx.IsCoinBase() && overwritten_height >= 0) {
+                m_stats.Add(outpoint, Coin(out, overwritten_height, true));
+            }
+        }
+
+        if (tx.IsCoinBase()) continue;
+        const CTxUndo& tx_undo = block_undo.vtxundo.at(i - 1);
+        for (size_t j = 0; j < tx.vin.size(); ++j) {
+            m_stats.Add(tx.vin[j].prevout, tx_undo.vprevout.at(j));
+        }
+    }
+    return true;
+}
+
+bool CoinStatsIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    CDBBatch batch(*m_db);
+
+    // During a reorg, copy the stats of the blocks getting disconnected from the height index to
+    // the hash index so they can still be looked up once the height index entries are overwritten.
+    // The in-memory MuHash state is reversed block by block at the same time.
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        std::pair<uint256, DBVal> value;
+        if (!m_db->Read(DBHeightKey(pindex->nHeight), value) || value.first != pindex->GetBlockHash()) {
+            return error("%s: unable to read value in %s at key (%c, %d)",
+                         __func__, GetName(), DB_BLOCK_HEIGHT, pindex->nHeight);
+        }
+        batch.Write(DBHashKey(value.first), std::move(value.second));
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            return error("%s: Failed to read block %s from disk",
+                         __func__, pindex->GetBlockHash().ToString());
+        }
+        if (!ReverseBlock(block, pindex)) {
+            return error("%s: Failed to reverse block %s in %s",
+                         __func__, pindex->GetBlockHash().ToString(), GetName());
+        }
+    }
+    if (!m_db->WriteBatch(batch)) return false;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+static bool LookupOne(const CDBWrapper& db, const CBlockIndex* block_index, DBVal& result)
+{
+    // First check if the result is stored under the height index and the value there matches the
+    // block hash. This should be the case if the block is on the active chain.
+    std::pair<uint256, DBVal> read_out;
+    if (!db.Read(DBHeightKey(block_index->nHeight), read_out)) {
+        return false;
+    }
+    if (read_out.first == block_index->GetBlockHash()) {
+        result = std::move(read_out.second);
+        return true;
+    }
+
+    // If value at the height index corresponds to an different block, the result will be stored in
+    // the hash index.
+    return db.Read(DBHashKey(block_index->GetBlockHash()), result);
+}
+
+bool CoinStatsIndex::LookUpStats(const CBlockIndex* block_index, CCoinsStats& coins_stats, uint256& muhash) const
+{
+    DBVal entry;
+    if (!LookupOne(*m_db, block_index, entry)) {
+        return false;
+    }
+
+    coins_stats.nHeight = block_index->nHeight;
+    coins_stats.hashBlock = block_index->GetBlockHash();
+    coins_stats.nTransactionOutputs = entry.coins_count;
+    coins_stats.coins_count = entry.coins_count;
+    coins_stats.nBogoSize = entry.bogo_size;
+    coins_stats.nTotalAmount = entry.total_amount;
+    muhash = entry.muhash;
+    return true;
+}
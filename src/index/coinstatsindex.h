@@ -0,0 +1,60 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_COINSTATSINDEX_H
+#define BITCOIN_INDEX_COINSTATSINDEX_H
+
+#include <chain.h>
+#include <index/base.h>
+#include <node/coinstats.h>
+#include <node/rollingcoinstats.h>
+
+/**
+ * CoinStatsIndex maintains statistics on the UTXO set as of every block of
+ * the chain: the number of coins, their total amount and bogosize, and the
+ * MuHash3072 digest of the set. This makes the statistics for any height a
+ * single lookup instead of a walk over the whole UTXO set.
+ */
+class CoinStatsIndex final : public BaseIndex
+{
+private:
+    std::unique_ptr<BaseIndex::DB> m_db;
+
+    /// Statistics of the UTXO set as of the index's best block.
+    RollingCoinStats m_stats;
+
+    /// Undo the effect of a block on m_stats.
+    bool ReverseBlock(const CBlock& block, const CBlockIndex* pindex);
+
+protected:
+    bool Init() override;
+
+    bool CommitInternal(CDBBatch& batch) override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return "coinstatsindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit CoinStatsIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Look up the statistics of the UTXO set as of a block. The block does
+    /// not need to be on the active chain, as long as it has been indexed.
+    ///
+    /// @param[in]   block_index  The block to return the statistics for.
+    /// @param[out]  coins_stats  The statistics, with hashSerialized left null.
+    /// @param[out]  muhash  The MuHash3072 digest of the UTXO set.
+    /// @return  true if the block is found in the index, false otherwise
+    bool LookUpStats(const CBlockIndex* block_index, CCoinsStats& coins_stats, uint256& muhash) const;
+};
+
+/// The global UTXO set statistics index. May be null.
+extern std::unique_ptr<CoinStatsIndex> g_coin_stats_index;
+
+#endif // BITCOIN_INDEX_COINSTATSINDEX_H
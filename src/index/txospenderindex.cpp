@@ -0,0 +1,133 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <index/txospenderindex.h>
+#include <util/system.h>
+#include <validation.h>
+
+/* The index database stores, for each outpoint spent, the hash of the spending transaction and
+ * the height of its block under [DB_SPENDER, outpoint].
+ *
+ * Entries of blocks that are not yet committed, or that are reorganized out of the active chain,
+ * have to be erased. To find them, the hash of each block written is kept under
+ * [DB_BLOCK_HEIGHT, height (BE)] in the same batch as the block's entries.
+ */
+constexpr char DB_SPENDER = 's';
+constexpr char DB_BLOCK_HEIGHT = 'h';
+
+namespace {
+
+struct DBVal {
+    uint256 txid;
+    int height;
+
+    DBVal() : height(0) {}
+    DBVal(const uint256& txid_in, int height_in) : txid(txid_in), height(height_in) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(VARINT(height, VarIntMode::NONNEGATIVE_SIGNED));
+    }
+};
+
+struct DBHeightKey {
+    int height;
+
+    explicit DBHeightKey(int height_in) : height(height_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_BLOCK_HEIGHT);
+        ser_writedata32be(s, height);
+    }
+};
+
+}; // namespace
+
+std::unique_ptr<TxoSpenderIndex> g_txospender_index;
+
+TxoSpenderIndex::TxoSpenderIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<BaseIndex::DB>(GetDataDir() / "indexes" / "txospenderindex", n_cache_size, f_memory, f_wipe))
+{}
+
+bool TxoSpenderIndex::Init()
+{
+    CBlockLocator locator;
+    if (!m_db->ReadBestBlock(locator)) {
+        locator.SetNull();
+    }
+
+    // Blocks above the point where the index resumes were either written without being
+    // committed, or reorganized out of the active chain while the node was offline. Erase them
+    // before BaseIndex::Init() lets BlockConnected write new ones.
+    const CBlockIndex* fork = nullptr;
+    if (!locator.IsNull()) {
+        LOCK(cs_main);
+        fork = FindForkInGlobalIndex(::ChainActive(), locator);
+    }
+    if (!EraseBlocksAbove(fork ? fork->nHeight : -1)) return false;
+
+    return BaseIndex::Init();
+}
+
+bool TxoSpenderIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CDBBatch batch(*m_db);
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        const uint256& txid = tx->GetHash();
+        for (const CTxIn& txin : tx->vin) {
+            batch.Write(std::make_pair(DB_SPENDER, txin.prevout), DBVal(txid, pindex->nHeight));
+        }
+    }
+    batch.Write(DBHeightKey(pindex->nHeight), pindex->GetBlockHash());
+    return m_db->WriteBatch(batch);
+}
+
+bool TxoSpenderIndex::EraseBlocksAbove(int height)
+{
+    CDBBatch batch(*m_db);
+    uint256 block_hash;
+    for (int h = height + 1; m_db->Read(DBHeightKey(h), block_hash); ++h) {
+        const CBlockIndex* pindex = WITH_LOCK(cs_main, return LookupBlockIndex(block_hash));
+        CBlock block;
+        if (!pindex || !ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            return error("%s: Failed to erase block %s from %s",
+                         __func__, block_hash.ToString(), GetName());
+        }
+        for (const auto& tx : block.vtx) {
+            if (tx->IsCoinBase()) continue;
+            for (const CTxIn& txin : tx->vin) {
+                batch.Erase(std::make_pair(DB_SPENDER, txin.prevout));
+            }
+        }
+        batch.Erase(DBHeightKey(h));
+    }
+    return m_db->WriteBatch(batch);
+}
+
+bool TxoSpenderIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    if (!EraseBlocksAbove(new_tip->nHeight)) return false;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+bool TxoSpenderIndex::FindSpender(const COutPoint& prevout, uint256& txid, int& height) const
+{
+    DBVal value;
+    if (!m_db->Read(std::make_pair(DB_SPENDER, prevout), value)) {
+        return false;
+    }
+    txid = value.txid;
+    height = value.height;
+    return true;
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_TXOSPENDERINDEX_H
+#define BITCOIN_INDEX_TXOSPENDERINDEX_H
+
+#include <chain.h>
+#include <index/base.h>
+
+/**
+ * TxoSpenderIndex is used to look up the transaction that spent an output.
+ * The index is written to a LevelDB database and records, for each outpoint
+ * spent in the active chain, the hash of the spending transaction and the
+ * height of the block it is included in.
+ */
+class TxoSpenderIndex final : public BaseIndex
+{
+private:
+    const std::unique_ptr<BaseIndex::DB> m_db;
+
+    /// Erase the entries of all blocks written above the given height.
+    bool EraseBlocksAbove(int height);
+
+protected:
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return "txospenderindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit TxoSpenderIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Look up the transaction spending an output.
+    ///
+    /// @param[in]   prevout  The output to look up.
+    /// @param[out]  txid  The hash of the spending transaction.
+    /// @param[out]  height  The height of the block the spending transaction is found in.
+    /// @return  true if the output is spent in the indexed chain, false otherwise
+    bool FindSpender(const COutPoint& prevout, uint256& txid, int& height) const;
+};
+
+/// The global spent output index. May be null.
+extern std::unique_ptr<TxoSpenderIndex> g_txospender_index;
+
+#endif // BITCOIN_INDEX_TXOSPENDERINDEX_H
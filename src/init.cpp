@@ -20,8 +20,11 @@
 #include <fs.h>
 #include <httprpc.h>
 #include <httpserver.h>
+#include <index/addrindex.h>
 #include <index/blockfilterindex.h>
+#include <index/coinstatsindex.h>
 #include <index/txindex.h>
+#include <index/txospenderindex.h>
 #include <interfaces/chain.h>
 #include <key.h>
 #include <miner.h>
@@ -167,6 +170,16 @@ void Interrupt(NodeContext& node)
         g_txindex->Interrupt();
     }
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Interrupt(); });
+    if (g_coin_stats_index) {
+        g_coin_stats_index->Interrupt();
+    }
+    if (g_addr_index) {
+        g_addr_index->Interrupt();
+    }
+    if (g_txospender_index) {
+        g_txospender_index->Interrupt();
+    }
+    InterruptBackgroundValidation();
 }
 
 void Shutdown(NodeContext& node)
@@ -199,6 +212,10 @@ void Shutdown(NodeContext& node)
     if (node.connman) node.connman->Stop();
     if (g_txindex) g_txindex->Stop();
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
+    if (g_coin_stats_index) g_coin_stats_index->Stop();
+    if (g_addr_index) g_addr_index->Stop();
+    if (g_txospender_index) g_txospender_index->Stop();
+    StopBackgroundValidation();
 
     StopTorControl();
 
@@ -214,6 +231,9 @@ void Shutdown(NodeContext& node)
     node.banman.reset();
     g_txindex.reset();
     DestroyAllBlockFilterIndexes();
+    g_coin_stats_index.reset();
+    g_addr_index.reset();
+    g_txospender_index.reset();
 
     if (::mempool.IsLoaded() && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool(::mempool);
@@ -256,8 +276,15 @@ void Shutdown(NodeContext& node)
         LOCK(cs_main);
         if (g_chainstate && g_chainstate->CanFlushToDisk()) {
             g_chainstate->ForceFlushStateToDisk();
+            if (gArgs.GetBoolArg("-blockindexsnapshot", DEFAULT_BLOCKINDEX_SNAPSHOT) && !fReindex && !::fImporting) {
+                WriteBlockIndexSnapshot(Params());
+            }
             g_chainstate->ResetCoinsViews();
         }
+        if (g_ibd_chainstate && g_ibd_chainstate->CanFlushToDisk()) {
+            g_ibd_chainstate->ForceFlushStateToDisk();
+            g_ibd_chainstate->ResetCoinsViews();
+        }
         pblocktree.reset();
     }
     for (const auto& client : node.chain_clients) {
@@ -360,10 +387,12 @@ void SetupServerArgs()
     gArgs.AddArg("-alertnotify=<cmd>", "Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
     gArgs.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockindexsnapshot", strprintf("Write the block index to a flat file on shutdown, for the next start to load it faster (default: %u)", DEFAULT_BLOCKINDEX_SNAPSHOT), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksdir=<dir>", "Specify directory to hold blocks subdirectory for *.dat files (default: <datadir>)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #if HAVE_SYSTEM
     gArgs.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
+    gArgs.AddArg("-backgroundflush", strprintf("Write the chainstate cache to disk in a background thread while validation continues. The cache then uses at most half of its space (see -dbcache), the rest holding the coins being written (default: %u)", DEFAULT_BACKGROUND_FLUSH), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blockreconstructionextratxn=<n>", strprintf("Extra transactions to keep in memory for compact block reconstructions (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksonly", strprintf("Whether to reject transactions from network peers. Transactions from the wallet, RPC and relay whitelisted inbound peers are not affected. (default: %u)", DEFAULT_BLOCKSONLY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-conf=<file>", strprintf("Specify configuration file. Relative paths will be prefixed by datadir location. (default: %s)", BITCOIN_CONF_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -382,11 +411,13 @@ void SetupServerArgs()
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-prefetchthreads=<n>", strprintf("Set the number of threads reading a block's inputs from the chainstate database before it is connected (0 to %d, 0 = disable, default: %d)", MAX_PREFETCH_THREADS, DEFAULT_PREFETCH_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-reindexthreads=<n>", strprintf("Set the number of threads reading and checking block files during -reindex (0 to %d, 0 = one per core, default: %d). Besides a %u MB read buffer, each thread may queue up to %u MiB of decoded blocks for import", MAX_REINDEX_THREADS, DEFAULT_REINDEX_THREADS, 2 * MAX_BLOCK_SERIALIZED_SIZE / 1000000, REINDEX_SCAN_BYTES_PER_THREAD >> 20), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #ifndef WIN32
     gArgs.AddArg("-sysperms", "Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #else
@@ -397,6 +428,9 @@ void SetupServerArgs()
                  strprintf("Maintain an index of compact filters by block (default: %s, values: %s).", DEFAULT_BLOCKFILTERINDEX, ListBlockFilterTypes()) +
                  " If <type> is not supplied or if <type> = 1, indexes for all known types are enabled.",
                  ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-addrindex", strprintf("Maintain an index of the outputs paying to and the inputs spending from each scriptPubKey, used by the getaddresshistory rpc call (default: %u)", DEFAULT_ADDRINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-txospenderindex", strprintf("Maintain an index of the transaction spending each output, used by the gettxspendingprevout rpc call (default: %u)", DEFAULT_TXOSPENDERINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-coinstatsindex", strprintf("Maintain UTXO set statistics as of every block, used by the gettxoutsetinfo rpc call with a block hash or height (default: %u)", DEFAULT_COINSTATSINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 
     gArgs.AddArg("-addnode=<ip>", "Add a node to connect to and attempt to keep the connection open (see the `addnode` RPC command help for more info). This option can be specified multiple times to add multiple nodes.", ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-banscore=<n>", strprintf("Threshold for disconnecting misbehaving peers (default: %u)", DEFAULT_BANSCORE_THRESHOLD), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
@@ -415,6 +449,7 @@ void SetupServerArgs()
     gArgs.AddArg("-maxsendbuffer=<n>", strprintf("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXSENDBUFFER), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxtimeadjustment", strprintf("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)", DEFAULT_MAX_TIME_ADJUSTMENT), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxuploadtarget=<n>", strprintf("Tries to keep outbound traffic under the given target (in MiB per 24h), 0 = no limit (default: %d)", DEFAULT_MAX_UPLOAD_TARGET), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-msgworkers=<n>", strprintf("Number of threads processing ping, pong, feefilter and bloom filter messages while the message handler thread is busy, 0 = disabled (maximum: %d, default: %d)", MAX_MSG_WORKERS, DEFAULT_MSG_WORKERS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onion=<ip:port>", "Use separate SOCKS5 proxy to reach peers via Tor hidden services, set -noonion to disable (default: -proxy)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onlynet=<net>", "Make outgoing connections only through network <net> (ipv4, ipv6 or onion). Incoming connections are not affected by this option. This option can be specified multiple times to allow multiple networks.", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peerbloomfilters", strprintf("Support filtering of blocks and transaction with bloom filters (default: %u)", DEFAULT_PEERBLOOMFILTERS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
@@ -664,18 +699,7 @@ static void ThreadImport(std::vector<fs::path> vImportFiles)
 
     // -reindex
     if (fReindex) {
-        int nFile = 0;
-        while (true) {
-            FlatFilePos pos(nFile, 0);
-            if (!fs::exists(GetBlockPosFilename(pos)))
-                break; // No block files left to reindex
-            FILE *file = OpenBlockFile(pos, true);
-            if (!file)
-                break; // This error is logged in OpenBlockFile
-            LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-            LoadExternalBlockFile(chainparams, file, &pos);
-            nFile++;
-        }
+        ReindexBlockFiles(chainparams);
         pblocktree->WriteReindexing(false);
         fReindex = false;
         LogPrintf("Reindexing finished\n");
@@ -951,6 +975,15 @@ bool AppInitParameterInteraction()
         if (!g_enabled_filter_types.empty()) {
             return InitError(_("Prune mode is incompatible with -blockfilterindex.").translated);
         }
+        if (gArgs.GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX)) {
+            return InitError(_("Prune mode is incompatible with -coinstatsindex.").translated);
+        }
+        if (gArgs.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX)) {
+            return InitError(_("Prune mode is incompatible with -addrindex.").translated);
+        }
+        if (gArgs.GetBoolArg("-txospenderindex", DEFAULT_TXOSPENDERINDEX)) {
+            return InitError(_("Prune mode is incompatible with -txospenderindex.").translated);
+        }
     }
 
     // -bind and -whitebind can't be set when not listening
@@ -1252,6 +1285,17 @@ bool AppInitMain(NodeContext& node)
         }
     }
 
+    int prefetch_threads = std::max(0, std::min<int>(gArgs.GetArg("-prefetchthreads", DEFAULT_PREFETCH_THREADS), MAX_PREFETCH_THREADS));
+    LogPrintf("Block input prefetching uses %d threads\n", prefetch_threads);
+    if (prefetch_threads >= 1) {
+        g_parallel_coin_prefetch = true;
+        for (int i = 0; i < prefetch_threads; ++i) {
+            threadGroup.create_thread([i]() { return ThreadCoinPrefetch(i); });
+        }
+    }
+
+    g_background_coins_flush = gArgs.GetBoolArg("-backgroundflush", DEFAULT_BACKGROUND_FLUSH);
+
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = std::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
@@ -1434,6 +1478,12 @@ bool AppInitMain(NodeContext& node)
         filter_index_cache = max_cache / n_indexes;
         nTotalCache -= filter_index_cache * n_indexes;
     }
+    int64_t coin_stats_index_cache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX) ? max_coinstats_index_cache << 20 : 0);
+    nTotalCache -= coin_stats_index_cache;
+    int64_t addr_index_cache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX) ? max_addr_index_cache << 20 : 0);
+    nTotalCache -= addr_index_cache;
+    int64_t txospender_index_cache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-txospenderindex", DEFAULT_TXOSPENDERINDEX) ? max_txospender_index_cache << 20 : 0);
+    nTotalCache -= txospender_index_cache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1448,6 +1498,15 @@ bool AppInitMain(NodeContext& node)
         LogPrintf("* Using %.1f MiB for %s block filter index database\n",
                   filter_index_cache * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
     }
+    if (gArgs.GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX)) {
+        LogPrintf("* Using %.1f MiB for coin statistics index database\n", coin_stats_index_cache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX)) {
+        LogPrintf("* Using %.1f MiB for address index database\n", addr_index_cache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-txospenderindex", DEFAULT_TXOSPENDERINDEX)) {
+        LogPrintf("* Using %.1f MiB for spent output index database\n", txospender_index_cache * (1.0 / 1024 / 1024));
+    }
     LogPrintf("* Using %.1f MiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for in-memory UTXO set (plus up to %.1f MiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
@@ -1463,8 +1522,23 @@ bool AppInitMain(NodeContext& node)
             bool is_coinsview_empty;
             try {
                 LOCK(cs_main);
+                // A chainstate loaded from a UTXO snapshot (see loadtxoutset)
+                // supersedes the one built by connecting blocks.
+                uint256 snapshot_blockhash;
+                if (DetectSnapshotChainstate(snapshot_blockhash)) {
+                    if (fReset) {
+                        LogPrintf("Removing snapshot chainstate due to -reindex\n");
+                        RemoveSnapshotChainstate();
+                        snapshot_blockhash.SetNull();
+                    } else if (fReindexChainState) {
+                        strLoadError = _("A chainstate loaded from a UTXO snapshot cannot be rebuilt with -reindex-chainstate. Use -reindex instead.").translated;
+                        break;
+                    }
+                }
+
                 // This statement makes ::ChainstateActive() usable.
-                g_chainstate = MakeUnique<CChainState>();
+                g_chainstate = MakeUnique<CChainState>(snapshot_blockhash);
+                g_ibd_chainstate.reset();
                 UnloadBlockIndex();
 
                 // new CBlockTreeDB tries to delete the existing file, which
@@ -1520,7 +1594,8 @@ bool AppInitMain(NodeContext& node)
                 ::ChainstateActive().InitCoinsDB(
                     /* cache_size_bytes */ nCoinDBCache,
                     /* in_memory */ false,
-                    /* should_wipe */ fReset || fReindexChainState);
+                    /* should_wipe */ fReset || fReindexChainState,
+                    /* leveldb_name */ snapshot_blockhash.IsNull() ? "chainstate" : SNAPSHOT_CHAINSTATE_DIR);
 
                 ::ChainstateActive().CoinsErrorCatcher().AddReadErrCallback([]() {
                     uiInterface.ThreadSafeMessageBox(
@@ -1545,6 +1620,11 @@ bool AppInitMain(NodeContext& node)
                 ::ChainstateActive().InitCoinsCache();
                 assert(::ChainstateActive().CanFlushToDisk());
 
+                if (!::ChainstateActive().LoadRollingCoinStats()) {
+                    strLoadError = _("Error loading the UTXO set statistics").translated;
+                    break;
+                }
+
                 is_coinsview_empty = fReset || fReindexChainState ||
                     ::ChainstateActive().CoinsTip().GetBestBlock().IsNull();
                 if (!is_coinsview_empty) {
@@ -1555,6 +1635,41 @@ bool AppInitMain(NodeContext& node)
                     }
                     assert(::ChainActive().Tip() != nullptr);
                 }
+
+                if (!snapshot_blockhash.IsNull()) {
+                    const CBlockIndex* base = LookupBlockIndex(snapshot_blockhash);
+                    if (is_coinsview_empty || !base || ::ChainActive()[base->nHeight] != base) {
+                        strLoadError = _("Error loading the chainstate created from a UTXO snapshot").translated;
+                        break;
+                    }
+                    LogPrintf("Using chainstate loaded from UTXO snapshot at %s\n", snapshot_blockhash.ToString());
+
+                    // The chainstate built from genesis keeps validating up to
+                    // the snapshot base, see StartBackgroundValidation.
+                    g_ibd_chainstate = MakeUnique<CChainState>();
+                    g_ibd_chainstate->InitCoinsDB(
+                        /* cache_size_bytes */ nCoinDBCache * BACKGROUND_VALIDATION_CACHE_PERCENT / 100,
+                        /* in_memory */ false,
+                        /* should_wipe */ false);
+                    if (!g_ibd_chainstate->ReplayBlocks(chainparams)) {
+                        strLoadError = _("Unable to replay blocks. You will need to rebuild the database using -reindex.").translated;
+                        break;
+                    }
+                    g_ibd_chainstate->InitCoinsCache();
+                    if (!g_ibd_chainstate->LoadRollingCoinStats()) {
+                        strLoadError = _("Error loading the UTXO set statistics").translated;
+                        break;
+                    }
+                    const uint256 background_tip = g_ibd_chainstate->CoinsTip().GetBestBlock();
+                    if (!background_tip.IsNull()) {
+                        CBlockIndex* tip = LookupBlockIndex(background_tip);
+                        if (!tip || base->GetAncestor(tip->nHeight) != tip) {
+                            strLoadError = _("Error loading the chainstate created from a UTXO snapshot").translated;
+                            break;
+                        }
+                        g_ibd_chainstate->m_chain.SetTip(tip);
+                    }
+                }
             } catch (const std::exception& e) {
                 LogPrintf("%s\n", e.what());
                 strLoadError = _("Error opening block database").translated;
@@ -1657,6 +1772,24 @@ bool AppInitMain(NodeContext& node)
         GetBlockFilterIndex(filter_type)->Start();
     }
 
+    if (gArgs.GetBoolArg("-coinstatsindex", DEFAULT_COINSTATSINDEX)) {
+        g_coin_stats_index = MakeUnique<CoinStatsIndex>(coin_stats_index_cache, false, fReindex);
+        g_coin_stats_index->Start();
+    }
+
+    if (gArgs.GetBoolArg("-addrindex", DEFAULT_ADDRINDEX)) {
+        g_addr_index = MakeUnique<AddrIndex>(addr_index_cache, false, fReindex);
+        g_addr_index->Start();
+    }
+
+    if (gArgs.GetBoolArg("-txospenderindex", DEFAULT_TXOSPENDERINDEX)) {
+        g_txospender_index = MakeUnique<TxoSpenderIndex>(txospender_index_cache, false, fReindex);
+        g_txospender_index->Start();
+    }
+
+    // Validate the blocks below the base of a snapshot chainstate, if any.
+    StartBackgroundValidation();
+
     // ********************************************************* Step 9: load wallet
     for (const auto& client : node.chain_clients) {
         if (!client->load()) {
@@ -1668,6 +1801,12 @@ bool AppInitMain(NodeContext& node)
 
     // if pruning, unset the service bit and perform the initial blockstore prune
     // after any wallet rescanning has taken place.
+    // A snapshot chainstate lacks the blocks below its base, like a pruned node.
+    if (!::ChainstateActive().m_from_snapshot_blockhash.IsNull()) {
+        LogPrintf("Unsetting NODE_NETWORK on snapshot chainstate\n");
+        nLocalServices = ServiceFlags(nLocalServices & ~NODE_NETWORK);
+    }
+
     if (fPruneMode) {
         LogPrintf("Unsetting NODE_NETWORK on prune mode\n");
         nLocalServices = ServiceFlags(nLocalServices & ~NODE_NETWORK);
@@ -1771,6 +1910,7 @@ bool AppInitMain(NodeContext& node)
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
     connOptions.m_peer_connect_timeout = peer_connect_timeout;
+    connOptions.m_msg_workers = gArgs.GetArg("-msgworkers", DEFAULT_MSG_WORKERS);
 
     for (const std::string& strBind : gArgs.GetArgs("-bind")) {
         CService addrBind;
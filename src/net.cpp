@@ -13,6 +13,7 @@
 #include <chainparams.h>
 #include <clientversion.h>
 #include <consensus/consensus.h>
+#include <crypto/common.h>
 #include <crypto/sha256.h>
 #include <netbase.h>
 #include <net_permissions.h>
@@ -32,6 +33,10 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/upnpcommands.h>
@@ -45,6 +50,11 @@ static_assert(MINIUPNPC_API_VERSION >= 10, "miniUPnPc API version >= 10 assumed"
 
 #include <math.h>
 
+#ifdef USE_EPOLL
+/** Maximum number of socket events handled per wait; the rest are left for the next one */
+static constexpr int MAX_EPOLL_EVENTS = 1024;
+#endif
+
 // Dump addresses to peers.dat every 15 minutes (900s)
 static constexpr int DUMP_PEERS_INTERVAL = 15 * 60;
 
@@ -443,7 +453,7 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
     NodeId id = GetNewNodeId();
     uint64_t nonce = GetDeterministicRandomizer(RANDOMIZER_ID_LOCALHOSTNONCE).Write(id).Finalize();
     CAddress addr_bind = GetBindAddress(hSocket);
-    CNode* pnode = new CNode(id, nLocalServices, GetBestHeight(), hSocket, addrConnect, CalculateKeyedNetGroup(addrConnect), nonce, addr_bind, pszDest ? pszDest : "", false, block_relay_only);
+    CNode* pnode = new CNode(id, nLocalServices, GetBestHeight(), hSocket, addrConnect, CalculateKeyedNetGroup(addrConnect), nonce, addr_bind, pszDest ? pszDest : "", false, block_relay_only, m_recv_buffer_pool);
     pnode->AddRef();
 
     // We're making a new connection, harvest entropy from the time (and our peer count)
@@ -530,6 +540,8 @@ void CNode::copyStats(CNodeStats &stats)
     {
         LOCK(cs_vRecv);
         X(mapRecvBytesPerMsgCmd);
+        X(mapRecvWaitPerMsgCmd);
+        X(mapRecvProcessPerMsgCmd);
         X(nRecvBytes);
     }
     X(m_legacyWhitelisted);
@@ -626,6 +638,152 @@ int CNode::GetSendVersion() const
     return nSendVersion;
 }
 
+int RecvBufferPool::SizeClass(size_t size)
+{
+    return size <= MEDIUM_BUFFER_SIZE ? 0 : 1;
+}
+
+size_t RecvBufferPool::Take(uint32_t size, CDataStream& stream)
+{
+    LOCK(m_mutex);
+    ++m_taken;
+    std::vector<CDataStream>& idle = m_idle[SizeClass(size)];
+    // Medium buffers are all of their class size. Large ones are as large as the largest
+    // message they received, and are only reused for messages that fit.
+    auto it = std::find_if(idle.rbegin(), idle.rend(), [size](const CDataStream& buffer) { return buffer.capacity() >= size; });
+    if (it == idle.rend()) return 0;
+
+    const int type = stream.GetType();
+    const int version = stream.GetVersion();
+    stream = std::move(*it);
+    idle.erase(std::next(it).base());
+    stream.SetType(type);
+    stream.SetVersion(version);
+
+    const size_t bytes = stream.capacity();
+    m_idle_bytes -= bytes;
+    ++m_reused;
+    return bytes;
+}
+
+void RecvBufferPool::Give(CDataStream&& stream)
+{
+    stream.clear();
+    const int size_class = SizeClass(stream.capacity());
+    if (size_class == 0) {
+        stream.reserve(MEDIUM_BUFFER_SIZE);
+    }
+
+    const size_t bytes = stream.capacity();
+    LOCK(m_mutex);
+    if (m_idle_bytes + bytes > m_max_idle_bytes) return;
+    m_idle[size_class].push_back(std::move(stream));
+    m_idle_bytes += bytes;
+}
+
+RecvBufferPool::Stats RecvBufferPool::GetStats() const
+{
+    LOCK(m_mutex);
+    Stats stats;
+    stats.taken = m_taken;
+    stats.reused = m_reused;
+    stats.idle_buffers = 0;
+    for (const auto& idle : m_idle) {
+        stats.idle_buffers += idle.size();
+    }
+    stats.idle_bytes = m_idle_bytes;
+    return stats;
+}
+
+size_t RecvBufferAccount::Take(uint32_t size, CDataStream& stream)
+{
+    if (m_bytes + size > m_max_bytes) return 0;
+    const size_t bytes = m_pool->Take(size, stream);
+    m_bytes += bytes;
+    return bytes;
+}
+
+void RecvBufferAccount::Give(CDataStream&& stream, size_t charged)
+{
+    m_bytes -= charged;
+    m_pool->Give(std::move(stream));
+}
+
+int64_t MessageLatencyStats::Histogram::Percentile(double fraction) const
+{
+    const uint64_t rank = std::ceil(fraction * count);
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank && seen > 0) return int64_t{1} << i;
+    }
+    return 0;
+}
+
+void MessageLatencyStats::AtomicHistogram::Record(int64_t duration)
+{
+    const int bucket = std::min<int>(CountBits(std::max<int64_t>(duration, 0)), NUM_BUCKETS - 1);
+    count.fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(std::max<int64_t>(duration, 0), std::memory_order_relaxed);
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+MessageLatencyStats::Histogram MessageLatencyStats::AtomicHistogram::Load() const
+{
+    Histogram histogram;
+    histogram.count = count.load(std::memory_order_relaxed);
+    histogram.total = total.load(std::memory_order_relaxed);
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        histogram.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+    return histogram;
+}
+
+MessageLatencyStats::MessageLatencyStats()
+    : m_commands(getAllNetMessageTypes())
+{
+    m_commands.push_back(NET_MESSAGE_COMMAND_OTHER);
+    std::sort(m_commands.begin(), m_commands.end());
+    m_wait.reset(new AtomicHistogram[NUM_PEER_CLASSES * m_commands.size()]);
+    m_process.reset(new AtomicHistogram[NUM_PEER_CLASSES * m_commands.size()]);
+}
+
+const char* MessageLatencyStats::PeerClassName(PeerClass peer_class)
+{
+    switch (peer_class) {
+    case INBOUND: return "inbound";
+    case OUTBOUND_FULL_RELAY: return "outbound-full-relay";
+    case BLOCK_RELAY: return "block-relay-only";
+    case MANUAL: return "manual";
+    case NUM_PEER_CLASSES: break;
+    }
+    assert(false);
+}
+
+void MessageLatencyStats::Record(PeerClass peer_class, const std::string& command, int64_t wait, int64_t process)
+{
+    auto it = std::lower_bound(m_commands.begin(), m_commands.end(), command);
+    if (it == m_commands.end() || *it != command) {
+        it = std::lower_bound(m_commands.begin(), m_commands.end(), NET_MESSAGE_COMMAND_OTHER);
+    }
+    const size_t index = peer_class * m_commands.size() + (it - m_commands.begin());
+    m_wait[index].Record(wait);
+    m_process[index].Record(process);
+}
+
+std::vector<MessageLatencyStats::Entry> MessageLatencyStats::GetStats() const
+{
+    std::vector<Entry> entries;
+    for (int peer_class = 0; peer_class < NUM_PEER_CLASSES; ++peer_class) {
+        for (size_t i = 0; i < m_commands.size(); ++i) {
+            const size_t index = peer_class * m_commands.size() + i;
+            if (m_process[index].count.load(std::memory_order_relaxed) == 0) continue;
+            entries.push_back({PeerClass(peer_class), m_commands[i], m_wait[index].Load(), m_process[index].Load()});
+        }
+    }
+    return entries;
+}
+
 int V1TransportDeserializer::readHeader(const char *pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
@@ -655,6 +813,11 @@ int V1TransportDeserializer::readHeader(const char *pch, unsigned int nBytes)
     // switch state to reading message data
     in_data = true;
 
+    // receive the message into a recycled buffer, unless one is held from an aborted message
+    if (m_buffer_account && m_buffer_charged == 0 && RecvBufferPool::IsPooled(hdr.nMessageSize)) {
+        m_buffer_charged = m_buffer_account->Take(hdr.nMessageSize, vRecv);
+    }
+
     return nCopy;
 }
 
@@ -686,6 +849,11 @@ const uint256& V1TransportDeserializer::GetMessageHash() const
 CNetMessage V1TransportDeserializer::GetMessage(const CMessageHeader::MessageStartChars& message_start, int64_t time) {
     // decompose a single CNetMessage from the TransportDeserializer
     CNetMessage msg(std::move(vRecv));
+    if (m_buffer_charged > 0 || RecvBufferPool::IsPooled(hdr.nMessageSize)) {
+        msg.m_buffer_account = m_buffer_account.get();
+        msg.m_buffer_charged = m_buffer_charged;
+        m_buffer_charged = 0;
+    }
 
     // store state about valid header, netmagic and checksum
     msg.m_valid_header = hdr.IsValid(message_start);
@@ -722,26 +890,52 @@ size_t CConnman::SocketSendData(CNode *pnode) const EXCLUSIVE_LOCKS_REQUIRED(pno
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert((*it)->size() > pnode->nSendOffset);
         int nBytes = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
+#ifdef WIN32
+            const auto &data = **it;
             nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            // Hand the queued headers and payloads to the kernel in one call, without copying them.
+            struct iovec iov[MAX_SEND_IOVECS];
+            size_t iov_count = 0;
+            size_t offset = pnode->nSendOffset;
+            for (auto iov_it = it; iov_it != pnode->vSendMsg.end() && iov_count < MAX_SEND_IOVECS; ++iov_it) {
+                const auto &data = **iov_it;
+                iov[iov_count].iov_base = const_cast<unsigned char*>(data.data()) + offset;
+                iov[iov_count].iov_len = data.size() - offset;
+                ++iov_count;
+                offset = 0;
+            }
+            struct msghdr msg = {};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = iov_count;
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            // Move past the buffers sent in full.
+            size_t nRemaining = nBytes;
+            while (nRemaining > 0) {
+                const size_t nLeft = (*it)->size() - pnode->nSendOffset;
+                if (nRemaining < nLeft) {
+                    pnode->nSendOffset += nRemaining;
+                    break;
+                }
+                nRemaining -= nLeft;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
+                pnode->nSendSize -= (*it)->size();
                 pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
                 it++;
-            } else {
+            }
+            if (pnode->nSendOffset != 0) {
                 // could not send full message; stop sending more
                 break;
             }
@@ -1010,7 +1204,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     if (NetPermissions::HasFlag(permissionFlags, PF_BLOOMFILTER)) {
         nodeServices = static_cast<ServiceFlags>(nodeServices | NODE_BLOOM);
     }
-    CNode* pnode = new CNode(id, nodeServices, GetBestHeight(), hSocket, addr, CalculateKeyedNetGroup(addr), nonce, addr_bind, "", true);
+    CNode* pnode = new CNode(id, nodeServices, GetBestHeight(), hSocket, addr, CalculateKeyedNetGroup(addr), nonce, addr_bind, "", true, false, m_recv_buffer_pool);
     pnode->AddRef();
     pnode->m_permissionFlags = permissionFlags;
     // If this flag is present, the user probably expect that RPC and QT report it as whitelisted (backward compatibility)
@@ -1024,6 +1218,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
+    AddSocketEvents(hSocket);
 
     // We received a new connection, harvest entropy from the time (and our peer count)
     RandAddEvent((uint32_t)id);
@@ -1184,7 +1379,47 @@ bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &s
     return !recv_set.empty() || !send_set.empty() || !error_set.empty();
 }
 
-#ifdef USE_POLL
+#ifdef USE_EPOLL
+void CConnman::AddSocketEvents(SOCKET hSocket)
+{
+    if (m_epoll_fd == -1 || hSocket == INVALID_SOCKET) return;
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.fd = hSocket;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, hSocket, &event) != 0) {
+        LogPrintf("epoll_ctl failed to add socket: %s\n", NetworkErrorString(errno));
+    }
+}
+
+void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+{
+    // Sockets stay registered, so there is no set to rebuild. Sockets closed by
+    // CloseSocketDisconnect() are removed from the epoll instance by the kernel.
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    const int timeout = m_socket_work_pending ? 0 : SELECT_TIMEOUT_MILLISECONDS;
+    const int n_events = epoll_wait(m_epoll_fd, events, MAX_EPOLL_EVENTS, timeout);
+
+    if (interruptNet) return;
+
+    if (n_events < 0) {
+        if (errno != EINTR) {
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(errno));
+            interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        }
+        return;
+    }
+
+    for (int i = 0; i < n_events; ++i) {
+        const SOCKET hSocket = events[i].data.fd;
+        if (events[i].events & EPOLLIN)                           recv_set.insert(hSocket);
+        if (events[i].events & EPOLLOUT)                          send_set.insert(hSocket);
+        if (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) error_set.insert(hSocket);
+    }
+}
+#elif defined(USE_POLL)
+void CConnman::AddSocketEvents(SOCKET hSocket) {}
+
 void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
@@ -1227,6 +1462,8 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
     }
 }
 #else
+void CConnman::AddSocketEvents(SOCKET hSocket) {}
+
 void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
@@ -1330,6 +1567,9 @@ void CConnman::SocketHandler()
         for (CNode* pnode : vNodesCopy)
             pnode->AddRef();
     }
+#ifdef USE_EPOLL
+    m_socket_work_pending = false;
+#endif
     for (CNode* pnode : vNodesCopy)
     {
         if (interruptNet)
@@ -1349,6 +1589,15 @@ void CConnman::SocketHandler()
             sendSet = send_set.count(pnode->hSocket) > 0;
             errorSet = error_set.count(pnode->hSocket) > 0;
         }
+#ifdef USE_EPOLL
+        // Apply the same logic as GenerateSelectSet() to the readiness remembered from
+        // earlier events: drain the send buffer first, and only receive while not paused.
+        pnode->m_sock_recv_ready |= recvSet || errorSet;
+        pnode->m_sock_send_ready |= sendSet;
+        const bool has_send_data = WITH_LOCK(pnode->cs_vSend, return !pnode->vSendMsg.empty());
+        sendSet = pnode->m_sock_send_ready && has_send_data;
+        recvSet = pnode->m_sock_recv_ready && !pnode->fPauseRecv && !has_send_data;
+#endif
         if (recvSet || errorSet)
         {
             // typical socket buffer is 8K-64K
@@ -1360,6 +1609,11 @@ void CConnman::SocketHandler()
                     continue;
                 nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
             }
+#ifdef USE_EPOLL
+            // Keep receiving until the socket reports it is drained (or closed); only data
+            // arriving after that raises a new event.
+            if (nBytes <= 0) pnode->m_sock_recv_ready = false;
+#endif
             if (nBytes > 0)
             {
                 bool notify = false;
@@ -1415,8 +1669,23 @@ void CConnman::SocketHandler()
             if (nBytes) {
                 RecordBytesSent(nBytes);
             }
+#ifdef USE_EPOLL
+            // Data left over means the socket is full; space freeing up raises a new event.
+            pnode->m_sock_send_ready = pnode->vSendMsg.empty();
+#endif
         }
 
+#ifdef USE_EPOLL
+        // Only come straight back if the next pass can make progress with this peer. Receiving
+        // waits while there is data to send, so a peer that does not read what we send cannot
+        // keep the loop spinning.
+        const bool send_pending = WITH_LOCK(pnode->cs_vSend, return !pnode->vSendMsg.empty());
+        if ((pnode->m_sock_recv_ready && !pnode->fPauseRecv && !send_pending) ||
+            (pnode->m_sock_send_ready && send_pending)) {
+            m_socket_work_pending = true;
+        }
+#endif
+
         InactivityCheck(pnode);
     }
     {
@@ -1441,8 +1710,10 @@ void CConnman::WakeMessageHandler()
     {
         std::lock_guard<std::mutex> lock(mutexMsgProc);
         fMsgProcWake = true;
+        ++m_msg_worker_wake_seq;
     }
     condMsgProc.notify_one();
+    m_msg_worker_cond.notify_all();
 }
 
 
@@ -1997,6 +2268,7 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
+    WITH_LOCK(pnode->cs_hSocket, AddSocketEvents(pnode->hSocket));
 }
 
 void CConnman::ThreadMessageHandler()
@@ -2013,12 +2285,20 @@ void CConnman::ThreadMessageHandler()
         }
 
         bool fMoreWork = false;
+        const int64_t pass_start = GetTimeMicros();
 
         for (CNode* pnode : vNodesCopy)
         {
             if (pnode->fDisconnect)
                 continue;
 
+            // A message worker is processing this peer's messages, come back to it once it is done.
+            TRY_LOCK(pnode->cs_msgProcessing, lockMsgProcessing);
+            if (!lockMsgProcessing) {
+                fMoreWork = true;
+                continue;
+            }
+
             // Receive messages
             bool fMoreNodeWork = m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc);
             fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
@@ -2034,6 +2314,8 @@ void CConnman::ThreadMessageHandler()
                 return;
         }
 
+        m_msghand_stats.busy_time += GetTimeMicros() - pass_start;
+
         {
             LOCK(cs_vNodes);
             for (CNode* pnode : vNodesCopy)
@@ -2048,10 +2330,68 @@ void CConnman::ThreadMessageHandler()
     }
 }
 
+void CConnman::ThreadMessageWorker(size_t worker)
+{
+    MessageThreadStats& stats = *m_msg_worker_stats[worker];
+    uint64_t wake_seq = WITH_LOCK(mutexMsgProc, return m_msg_worker_wake_seq);
 
+    while (!flagInterruptMsgProc)
+    {
+        std::vector<CNode*> vNodesCopy;
+        {
+            LOCK(cs_vNodes);
+            vNodesCopy = vNodes;
+            for (CNode* pnode : vNodesCopy) {
+                pnode->AddRef();
+            }
+        }
+
+        uint64_t processed = 0;
+        const int64_t pass_start = GetTimeMicros();
+
+        // Start at a different peer in each worker, so that they do not all contend for the same ones.
+        for (size_t i = 0; i < vNodesCopy.size() && !flagInterruptMsgProc; ++i)
+        {
+            CNode* pnode = vNodesCopy[(i + worker) % vNodesCopy.size()];
+            if (pnode->fDisconnect)
+                continue;
+
+            TRY_LOCK(pnode->cs_msgProcessing, lockMsgProcessing);
+            if (!lockMsgProcessing)
+                continue;
 
+            // Take at most one message per peer and pass, like the message handler thread does.
+            if (m_msgproc->ProcessConcurrentMessage(pnode, flagInterruptMsgProc)) {
+                ++processed;
+            }
+        }
 
+        stats.busy_time += GetTimeMicros() - pass_start;
+        stats.messages += processed;
 
+        {
+            LOCK(cs_vNodes);
+            for (CNode* pnode : vNodesCopy)
+                pnode->Release();
+        }
+
+        WAIT_LOCK(mutexMsgProc, lock);
+        if (processed == 0) {
+            m_msg_worker_cond.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this, wake_seq] { return m_msg_worker_wake_seq != wake_seq || flagInterruptMsgProc; });
+        }
+        wake_seq = m_msg_worker_wake_seq;
+    }
+}
+
+void CConnman::GetMessageThreadInfo(std::vector<MessageThreadInfo>& info, int64_t& uptime) const
+{
+    info.clear();
+    info.push_back({m_msghand_stats.name, m_msghand_stats.busy_time, m_msghand_stats.messages});
+    for (const auto& stats : m_msg_worker_stats) {
+        info.push_back({stats->name, stats->busy_time, stats->messages});
+    }
+    uptime = m_msg_threads_start_time ? GetTimeMicros() - m_msg_threads_start_time : 0;
+}
 
 bool CConnman::BindListenPort(const CService& addrBind, std::string& strError, NetPermissionFlags permissions)
 {
@@ -2302,6 +2642,27 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         fMsgProcWake = false;
     }
 
+#ifdef USE_EPOLL
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll_fd == -1) {
+        if (clientInterface) {
+            clientInterface->ThreadSafeMessageBox(
+                strprintf(_("Failed to create the socket event queue: %s").translated, NetworkErrorString(errno)),
+                "", CClientUIInterface::MSG_ERROR);
+        }
+        return false;
+    }
+    // Listening sockets are level-triggered, as each event accepts a single connection.
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = hListenSocket.socket;
+        if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, hListenSocket.socket, &event) != 0) {
+            LogPrintf("epoll_ctl failed to add listening socket: %s\n", NetworkErrorString(errno));
+        }
+    }
+#endif
+
     // Send and receive from sockets, accept connections
     threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
 
@@ -2325,7 +2686,15 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         threadOpenConnections = std::thread(&TraceThread<std::function<void()> >, "opencon", std::function<void()>(std::bind(&CConnman::ThreadOpenConnections, this, connOptions.m_specified_outgoing)));
 
     // Process messages
+    m_msg_threads_start_time = GetTimeMicros();
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    m_msg_worker_stats.clear();
+    for (int i = 0; i < m_msg_workers; ++i) {
+        m_msg_worker_stats.push_back(MakeUnique<MessageThreadStats>(strprintf("msgworker.%d", i)));
+    }
+    for (int i = 0; i < m_msg_workers; ++i) {
+        m_msg_worker_threads.emplace_back(&TraceThread<std::function<void()> >, m_msg_worker_stats[i]->name.c_str(), std::function<void()>(std::bind(&CConnman::ThreadMessageWorker, this, i)));
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery(std::bind(&CConnman::DumpAddresses, this), DUMP_PEERS_INTERVAL * 1000);
@@ -2355,6 +2724,7 @@ void CConnman::Interrupt()
         flagInterruptMsgProc = true;
     }
     condMsgProc.notify_all();
+    m_msg_worker_cond.notify_all();
 
     interruptNet();
     InterruptSocks5(true);
@@ -2376,6 +2746,11 @@ void CConnman::Stop()
 {
     if (threadMessageHandler.joinable())
         threadMessageHandler.join();
+    for (std::thread& thread : m_msg_worker_threads) {
+        if (thread.joinable())
+            thread.join();
+    }
+    m_msg_worker_threads.clear();
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
@@ -2409,6 +2784,12 @@ void CConnman::Stop()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+#ifdef USE_EPOLL
+    if (m_epoll_fd != -1) {
+        close(m_epoll_fd);
+        m_epoll_fd = -1;
+    }
+#endif
     semOutbound.reset();
     semAddnode.reset();
 }
@@ -2670,7 +3051,7 @@ int CConnman::GetBestHeight() const
 
 unsigned int CConnman::GetReceiveFloodSize() const { return nReceiveFloodSize; }
 
-CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn, SOCKET hSocketIn, const CAddress& addrIn, uint64_t nKeyedNetGroupIn, uint64_t nLocalHostNonceIn, const CAddress& addrBindIn, const std::string& addrNameIn, bool fInboundIn, bool block_relay_only)
+CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn, SOCKET hSocketIn, const CAddress& addrIn, uint64_t nKeyedNetGroupIn, uint64_t nLocalHostNonceIn, const CAddress& addrBindIn, const std::string& addrNameIn, bool fInboundIn, bool block_relay_only, std::shared_ptr<RecvBufferPool> recv_buffer_pool)
     : nTimeConnected(GetSystemTimeInSeconds()),
     addr(addrIn),
     addrBind(addrBindIn),
@@ -2695,6 +3076,10 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     for (const std::string &msg : getAllNetMessageTypes())
         mapRecvBytesPerMsgCmd[msg] = 0;
     mapRecvBytesPerMsgCmd[NET_MESSAGE_COMMAND_OTHER] = 0;
+    for (const auto& i : mapRecvBytesPerMsgCmd) {
+        mapRecvWaitPerMsgCmd[i.first] = 0;
+        mapRecvProcessPerMsgCmd[i.first] = 0;
+    }
 
     if (fLogIPs) {
         LogPrint(BCLog::NET, "Added connection to %s peer=%d\n", addrName, id);
@@ -2702,7 +3087,11 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
         LogPrint(BCLog::NET, "Added connection peer=%d\n", id);
     }
 
-    m_deserializer = MakeUnique<V1TransportDeserializer>(V1TransportDeserializer(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION));
+    std::shared_ptr<RecvBufferAccount> buffer_account;
+    if (recv_buffer_pool) {
+        buffer_account = std::make_shared<RecvBufferAccount>(std::move(recv_buffer_pool), MAX_RECV_POOL_PEER_BYTES);
+    }
+    m_deserializer = MakeUnique<V1TransportDeserializer>(V1TransportDeserializer(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION, std::move(buffer_account)));
 }
 
 CNode::~CNode()
@@ -2715,19 +3104,36 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
     return pnode && pnode->fSuccessfullyConnected && !pnode->fDisconnect;
 }
 
+CSharedNetMsg::CSharedNetMsg(CSerializedNetMsg&& msg)
+    : data(std::make_shared<const std::vector<unsigned char>>(std::move(msg.data))),
+      command(std::move(msg.command)),
+      hash(Hash(data->data(), data->data() + data->size()))
+{
+}
+
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
-    size_t nMessageSize = msg.data.size();
+    const uint256 hash = Hash(msg.data.data(), msg.data.data() + msg.data.size());
+    PushSerializedMessage(pnode, msg.command, std::make_shared<const std::vector<unsigned char>>(std::move(msg.data)), hash);
+}
+
+void CConnman::PushMessage(CNode* pnode, const CSharedNetMsg& msg)
+{
+    PushSerializedMessage(pnode, msg.command, msg.data, msg.hash);
+}
+
+void CConnman::PushSerializedMessage(CNode* pnode, const std::string& command, std::shared_ptr<const std::vector<unsigned char>> payload, const uint256& hash)
+{
+    size_t nMessageSize = payload->size();
     size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
-    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command), nMessageSize, pnode->GetId());
+    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(command), nMessageSize, pnode->GetId());
 
-    std::vector<unsigned char> serializedHeader;
-    serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
-    uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
-    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
+    auto serializedHeader = std::make_shared<std::vector<unsigned char>>();
+    serializedHeader->reserve(CMessageHeader::HEADER_SIZE);
+    CMessageHeader hdr(Params().MessageStart(), command.c_str(), nMessageSize);
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
-    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
+    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, *serializedHeader, 0, hdr};
 
     size_t nBytesSent = 0;
     {
@@ -2735,14 +3141,14 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         bool optimisticSend(pnode->vSendMsg.empty());
 
         //log total amount of bytes per command
-        pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
+        pnode->mapSendBytesPerMsgCmd[command] += nTotalSize;
         pnode->nSendSize += nTotalSize;
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
         pnode->vSendMsg.push_back(std::move(serializedHeader));
         if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+            pnode->vSendMsg.push_back(std::move(payload));
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
@@ -2752,6 +3158,30 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         RecordBytesSent(nBytesSent);
 }
 
+void CConnman::RecordMessageLatency(CNode* pnode, const std::string& command, int64_t wait, int64_t process)
+{
+    MessageLatencyStats::PeerClass peer_class = MessageLatencyStats::OUTBOUND_FULL_RELAY;
+    if (pnode->fInbound) {
+        peer_class = MessageLatencyStats::INBOUND;
+    } else if (pnode->m_manual_connection) {
+        peer_class = MessageLatencyStats::MANUAL;
+    } else if (!pnode->m_tx_relay) {
+        peer_class = MessageLatencyStats::BLOCK_RELAY;
+    }
+    m_msg_latency.Record(peer_class, command, wait, process);
+
+    LOCK(pnode->cs_vRecv);
+    auto wait_it = pnode->mapRecvWaitPerMsgCmd.find(command);
+    auto process_it = pnode->mapRecvProcessPerMsgCmd.find(command);
+    if (wait_it == pnode->mapRecvWaitPerMsgCmd.end()) {
+        wait_it = pnode->mapRecvWaitPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
+        process_it = pnode->mapRecvProcessPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
+    }
+    assert(wait_it != pnode->mapRecvWaitPerMsgCmd.end() && process_it != pnode->mapRecvProcessPerMsgCmd.end());
+    wait_it->second += std::max<int64_t>(wait, 0);
+    process_it->second += std::max<int64_t>(process, 0);
+}
+
 bool CConnman::ForNode(NodeId id, std::function<bool(CNode* pnode)> func)
 {
     CNode* found = nullptr;
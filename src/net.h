@@ -57,6 +57,12 @@ static const unsigned int MAX_INV_SZ = 50000;
 static const unsigned int MAX_LOCATOR_SZ = 101;
 /** The maximum number of new addresses to accumulate before announcing. */
 static const unsigned int MAX_ADDR_TO_SEND = 1000;
+/** Maximum memory of the idle buffers kept for receiving messages */
+static const size_t MAX_RECV_POOL_IDLE_BYTES = 32 * 1024 * 1024;
+/** Maximum memory of pooled receive buffers held by one peer's unprocessed messages */
+static const size_t MAX_RECV_POOL_PEER_BYTES = 8 * 1024 * 1024;
+/** Maximum number of queued buffers handed to the kernel in one send call */
+static const size_t MAX_SEND_IOVECS = 64;
 /** Maximum length of incoming protocol messages (no message over 4 MB is currently acceptable). */
 static const unsigned int MAX_PROTOCOL_MESSAGE_LENGTH = 4 * 1000 * 1000;
 /** Maximum length of the user agent string in `version` message */
@@ -89,6 +95,10 @@ static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** Default number of threads processing messages that do not need cs_main, 0 = disabled */
+static const int DEFAULT_MSG_WORKERS = 0;
+/** Maximum number of threads processing messages that do not need cs_main */
+static const int MAX_MSG_WORKERS = 16;
 
 typedef int64_t NodeId;
 
@@ -116,6 +126,147 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+/**
+ * A serialized message that can be pushed to many peers. Its payload and checksum
+ * are computed once, and the payload is shared by the send queues of all peers
+ * instead of being copied into each of them.
+ */
+struct CSharedNetMsg
+{
+    explicit CSharedNetMsg(CSerializedNetMsg&& msg);
+
+    std::shared_ptr<const std::vector<unsigned char>> data;
+    std::string command;
+    /** Double-SHA256 of the payload, the message checksum is taken from it */
+    uint256 hash;
+};
+
+
+/**
+ * Recycles the buffers that messages are received into. Without it, a buffer is
+ * allocated as each message is received and freed once it is processed.
+ * Idle buffers are kept by size class: medium (up to 64 KiB, such as compact blocks
+ * and headers) and large (blocks). Small messages, such as most inv, tx and ping
+ * messages, are left to the allocator, which serves them faster than the pool can.
+ */
+class RecvBufferPool
+{
+public:
+    struct Stats {
+        uint64_t taken;         //!< Number of messages received with the pool
+        uint64_t reused;        //!< Number of them received into an idle buffer
+        size_t idle_buffers;
+        size_t idle_bytes;
+    };
+
+    explicit RecvBufferPool(size_t max_idle_bytes = MAX_RECV_POOL_IDLE_BYTES) : m_max_idle_bytes(max_idle_bytes) {}
+
+    /** Whether messages with a payload of the given size are received into pooled buffers */
+    static bool IsPooled(uint32_t size) { return size > SMALL_MESSAGE_SIZE; }
+
+    /** Move an idle buffer able to hold a payload of the given size into a stream, if there is one.
+     *  Returns the memory of the buffer, or 0 if the stream is left unchanged. */
+    size_t Take(uint32_t size, CDataStream& stream);
+    /** Give back the buffer of a processed message, which is kept if the pool has room for it. */
+    void Give(CDataStream&& stream);
+    Stats GetStats() const;
+
+private:
+    static constexpr size_t SMALL_MESSAGE_SIZE = 1024;
+    static constexpr size_t MEDIUM_BUFFER_SIZE = 64 * 1024;
+    static constexpr int NUM_SIZE_CLASSES = 2;
+
+    static int SizeClass(size_t size);
+
+    const size_t m_max_idle_bytes;
+    mutable Mutex m_mutex;
+    std::vector<CDataStream> m_idle[NUM_SIZE_CLASSES] GUARDED_BY(m_mutex);
+    size_t m_idle_bytes GUARDED_BY(m_mutex){0};
+    uint64_t m_taken GUARDED_BY(m_mutex){0};
+    uint64_t m_reused GUARDED_BY(m_mutex){0};
+};
+
+/** A peer's use of a RecvBufferPool, limiting the pooled memory its unprocessed messages hold. */
+class RecvBufferAccount
+{
+public:
+    RecvBufferAccount(std::shared_ptr<RecvBufferPool> pool, size_t max_bytes) : m_pool(std::move(pool)), m_max_bytes(max_bytes) {}
+
+    /** Take a pooled buffer for a message, unless the peer holds too much pooled memory already.
+     *  Returns the memory charged to the peer. */
+    size_t Take(uint32_t size, CDataStream& stream);
+    /** Give back the buffer of a processed message, and the memory charged for it. */
+    void Give(CDataStream&& stream, size_t charged);
+
+private:
+    const std::shared_ptr<RecvBufferPool> m_pool;
+    const size_t m_max_bytes;
+    std::atomic<size_t> m_bytes{0};
+};
+
+/**
+ * Histograms of how long received messages wait in their peer's process queue, and
+ * of how long they take to process, by class of peer and message type. Durations
+ * are counted in buckets of powers of two microseconds. Recording a message only
+ * increments relaxed atomic counters, so it takes no lock.
+ */
+class MessageLatencyStats
+{
+public:
+    enum PeerClass {
+        INBOUND,
+        OUTBOUND_FULL_RELAY,
+        BLOCK_RELAY,
+        MANUAL,
+        NUM_PEER_CLASSES
+    };
+
+    /** Bucket 0 counts durations under 1us, bucket i > 0 those in [2^(i-1), 2^i) us, and the last
+     *  bucket all longer ones. */
+    static constexpr int NUM_BUCKETS = 28;
+
+    struct Histogram {
+        uint64_t count{0};
+        int64_t total{0};       //!< Sum of the durations, in microseconds
+        uint64_t buckets[NUM_BUCKETS] = {};
+
+        /** Upper bound of the bucket the given fraction of durations falls under, in microseconds */
+        int64_t Percentile(double fraction) const;
+    };
+
+    struct Entry {
+        PeerClass peer_class;
+        std::string command;
+        Histogram wait;
+        Histogram process;
+    };
+
+    MessageLatencyStats();
+
+    static const char* PeerClassName(PeerClass peer_class);
+
+    /** Record a processed message. Unknown commands are counted under NET_MESSAGE_COMMAND_OTHER. */
+    void Record(PeerClass peer_class, const std::string& command, int64_t wait, int64_t process);
+
+    /** Get the histograms of all peer classes and message types with messages recorded. */
+    std::vector<Entry> GetStats() const;
+
+private:
+    struct AtomicHistogram {
+        std::atomic<uint64_t> count{0};
+        std::atomic<int64_t> total{0};
+        std::atomic<uint64_t> buckets[NUM_BUCKETS] = {};
+
+        void Record(int64_t duration);
+        Histogram Load() const;
+    };
+
+    /** Known commands and NET_MESSAGE_COMMAND_OTHER, sorted */
+    std::vector<std::string> m_commands;
+    /** Histograms, indexed by peer class and then position of the command in m_commands */
+    std::unique_ptr<AtomicHistogram[]> m_wait;
+    std::unique_ptr<AtomicHistogram[]> m_process;
+};
 
 class NetEventsInterface;
 class CConnman
@@ -146,6 +297,7 @@ public:
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
         int64_t m_peer_connect_timeout = DEFAULT_PEER_CONNECT_TIMEOUT;
+        int m_msg_workers = DEFAULT_MSG_WORKERS;
         std::vector<std::string> vSeedNodes;
         std::vector<NetWhitelistPermissions> vWhitelistedRange;
         std::vector<NetWhitebindPermissions> vWhiteBinds;
@@ -171,6 +323,7 @@ public:
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         m_peer_connect_timeout = connOptions.m_peer_connect_timeout;
+        m_msg_workers = std::max(0, std::min(connOptions.m_msg_workers, MAX_MSG_WORKERS));
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -208,6 +361,7 @@ public:
     bool ForNode(NodeId id, std::function<bool(CNode* pnode)> func);
 
     void PushMessage(CNode* pnode, CSerializedNetMsg&& msg);
+    void PushMessage(CNode* pnode, const CSharedNetMsg& msg);
 
     template<typename Callable>
     void ForEachNode(Callable&& func)
@@ -322,8 +476,27 @@ public:
 
     unsigned int GetReceiveFloodSize() const;
 
+    RecvBufferPool::Stats GetRecvBufferPoolStats() const { return m_recv_buffer_pool->GetStats(); }
+
+    /** Record the time a message from a peer waited to be processed, and took to process. */
+    void RecordMessageLatency(CNode* pnode, const std::string& command, int64_t wait, int64_t process);
+    std::vector<MessageLatencyStats::Entry> GetMessageLatencyStats() const { return m_msg_latency.GetStats(); }
+
     void WakeMessageHandler();
 
+    /** Busy time of a message processing thread, for utilization statistics. */
+    struct MessageThreadInfo {
+        std::string name;
+        /** Time spent processing messages, in microseconds */
+        int64_t busy_time;
+        /** Number of messages processed, only counted by worker threads */
+        uint64_t messages;
+    };
+
+    /** Get the busy time of the message handler and worker threads, and the time in microseconds
+     *  since they were started. */
+    void GetMessageThreadInfo(std::vector<MessageThreadInfo>& info, int64_t& uptime) const;
+
     /** Attempts to obfuscate tx time through exponentially distributed emitting.
         Works assuming that a single interval is used.
         Variable intervals will result in privacy decrease.
@@ -348,11 +521,17 @@ private:
     void ProcessOneShot();
     void ThreadOpenConnections(std::vector<std::string> connect);
     void ThreadMessageHandler();
+    /** Process messages that do not need cs_main, while the message handler thread is busy with
+     *  other peers. Messages of a peer are only processed by one thread at a time, in order. */
+    void ThreadMessageWorker(size_t worker);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
     void InactivityCheck(CNode *pnode);
     bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+    /** Register a peer's socket with the event queue, if one is in use. Must be called after
+     *  the peer is added to vNodes, so that no event is reported before the peer is serviced. */
+    void AddSocketEvents(SOCKET hSocket);
     void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketHandler();
     void ThreadSocketHandler();
@@ -373,6 +552,8 @@ private:
 
     NodeId GetNewNodeId();
 
+    /** Queue a message with the given payload to be sent to a peer, and try to send it right away. */
+    void PushSerializedMessage(CNode* pnode, const std::string& command, std::shared_ptr<const std::vector<unsigned char>> payload, const uint256& hash);
     size_t SocketSendData(CNode *pnode) const;
     void DumpAddresses();
 
@@ -456,6 +637,11 @@ private:
     /** SipHasher seeds for deterministic randomness */
     const uint64_t nSeed0, nSeed1;
 
+    MessageLatencyStats m_msg_latency;
+
+    /** Buffers shared by all peers to receive messages into */
+    const std::shared_ptr<RecvBufferPool> m_recv_buffer_pool{std::make_shared<RecvBufferPool>()};
+
     /** flag for waking the message processor. */
     bool fMsgProcWake;
 
@@ -463,13 +649,40 @@ private:
     Mutex mutexMsgProc;
     std::atomic<bool> flagInterruptMsgProc{false};
 
+    /** Number of message worker threads */
+    int m_msg_workers{0};
+    /** Incremented when the message workers are woken, guarded by mutexMsgProc. */
+    uint64_t m_msg_worker_wake_seq{0};
+    std::condition_variable m_msg_worker_cond;
+
+    /** Per-thread message processing statistics */
+    struct MessageThreadStats {
+        const std::string name;
+        std::atomic<int64_t> busy_time{0};
+        std::atomic<uint64_t> messages{0};
+
+        explicit MessageThreadStats(std::string name_in) : name(std::move(name_in)) {}
+    };
+    MessageThreadStats m_msghand_stats{"msghand"};
+    std::vector<std::unique_ptr<MessageThreadStats>> m_msg_worker_stats;
+    /** Time the message processing threads were started, in microseconds */
+    int64_t m_msg_threads_start_time{0};
+
     CThreadInterrupt interruptNet;
 
+#ifdef USE_EPOLL
+    /** epoll instance holding the listening and peer sockets. Peer sockets are edge-triggered. */
+    int m_epoll_fd{-1};
+    /** Whether a peer had data left to receive or send after the last socket handler pass. */
+    bool m_socket_work_pending{false};
+#endif
+
     std::thread threadDNSAddressSeed;
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadMessageHandler;
+    std::vector<std::thread> m_msg_worker_threads;
 
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of m_max_outbound_full_relay
@@ -479,6 +692,7 @@ private:
     std::atomic<int64_t> m_next_send_inv_to_incoming{0};
 
     friend struct CConnmanTest;
+    friend struct ConnmanTestMsg;
 };
 void Discover();
 void StartMapPort();
@@ -509,6 +723,9 @@ class NetEventsInterface
 public:
     virtual bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) = 0;
     virtual bool SendMessages(CNode* pnode) = 0;
+    /** Process the next message of a peer if it does not need cs_main and can be processed out of
+     *  the message handler thread. Returns whether a message was processed. */
+    virtual bool ProcessConcurrentMessage(CNode* pnode, std::atomic<bool>& interrupt) = 0;
     virtual void InitializeNode(CNode* pnode) = 0;
     virtual void FinalizeNode(NodeId id, bool& update_connection_time) = 0;
 
@@ -591,6 +808,8 @@ public:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     uint64_t nRecvBytes;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    mapMsgCmdSize mapRecvWaitPerMsgCmd;
+    mapMsgCmdSize mapRecvProcessPerMsgCmd;
     NetPermissionFlags m_permissionFlags;
     bool m_legacyWhitelisted;
     double dPingTime;
@@ -621,8 +840,22 @@ public:
     uint32_t m_message_size = 0;         // size of the payload
     uint32_t m_raw_message_size = 0;     // used wire size of the message (including header/checksum)
     std::string m_command;
+    RecvBufferAccount* m_buffer_account = nullptr; // gets m_recv back once the message is processed, outlives the message
+    size_t m_buffer_charged = 0;         // memory charged to m_buffer_account for m_recv
 
     CNetMessage(CDataStream&& recv_in) : m_recv(std::move(recv_in)) {}
+    CNetMessage(CNetMessage&& other) : m_recv(std::move(other.m_recv)), m_time(other.m_time), m_valid_netmagic(other.m_valid_netmagic),
+        m_valid_header(other.m_valid_header), m_valid_checksum(other.m_valid_checksum), m_message_size(other.m_message_size),
+        m_raw_message_size(other.m_raw_message_size), m_command(std::move(other.m_command)),
+        m_buffer_account(other.m_buffer_account), m_buffer_charged(other.m_buffer_charged)
+    {
+        other.m_buffer_account = nullptr;
+    }
+    CNetMessage& operator=(CNetMessage&&) = delete;
+    ~CNetMessage()
+    {
+        if (m_buffer_account) m_buffer_account->Give(std::move(m_recv), m_buffer_charged);
+    }
 
     void SetVersion(int nVersionIn)
     {
@@ -656,6 +889,8 @@ private:
     CDataStream hdrbuf;             // partially received header
     CMessageHeader hdr;             // complete header
     CDataStream vRecv;              // received message data
+    const std::shared_ptr<RecvBufferAccount> m_buffer_account; // receive buffers are taken from, if set
+    size_t m_buffer_charged{0};     // memory charged to m_buffer_account for vRecv
     unsigned int nHdrPos;
     unsigned int nDataPos;
 
@@ -676,7 +911,8 @@ private:
 
 public:
 
-    V1TransportDeserializer(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
+    V1TransportDeserializer(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn, std::shared_ptr<RecvBufferAccount> buffer_account = nullptr)
+        : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn), m_buffer_account(std::move(buffer_account)) {
         Reset();
     }
 
@@ -712,7 +948,8 @@ public:
     size_t nSendSize{0}; // total size of all vSendMsg entries
     size_t nSendOffset{0}; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::deque<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    /** Message headers and payloads to send. Payloads may be shared with the queues of other peers. */
+    std::deque<std::shared_ptr<const std::vector<unsigned char>>> vSendMsg GUARDED_BY(cs_vSend);
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
@@ -722,6 +959,8 @@ public:
     size_t nProcessQueueSize{0};
 
     CCriticalSection cs_sendProcessing;
+    /** Held by the thread processing this peer's messages. Taken before cs_sendProcessing. */
+    Mutex cs_msgProcessing;
 
     std::deque<CInv> vRecvGetData;
     uint64_t nRecvBytes GUARDED_BY(cs_vRecv){0};
@@ -769,6 +1008,9 @@ public:
 protected:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     mapMsgCmdSize mapRecvBytesPerMsgCmd GUARDED_BY(cs_vRecv);
+    // Time received messages waited to be processed, and took to process, in microseconds
+    mapMsgCmdSize mapRecvWaitPerMsgCmd GUARDED_BY(cs_vRecv);
+    mapMsgCmdSize mapRecvProcessPerMsgCmd GUARDED_BY(cs_vRecv);
 
 public:
     uint256 hashContinue;
@@ -841,7 +1083,7 @@ public:
 
     std::set<uint256> orphan_work_set;
 
-    CNode(NodeId id, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn, SOCKET hSocketIn, const CAddress &addrIn, uint64_t nKeyedNetGroupIn, uint64_t nLocalHostNonceIn, const CAddress &addrBindIn, const std::string &addrNameIn = "", bool fInboundIn = false, bool block_relay_only = false);
+    CNode(NodeId id, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn, SOCKET hSocketIn, const CAddress &addrIn, uint64_t nKeyedNetGroupIn, uint64_t nLocalHostNonceIn, const CAddress &addrBindIn, const std::string &addrNameIn = "", bool fInboundIn = false, bool block_relay_only = false, std::shared_ptr<RecvBufferPool> recv_buffer_pool = nullptr);
     ~CNode();
     CNode(const CNode&) = delete;
     CNode& operator=(const CNode&) = delete;
@@ -871,6 +1113,12 @@ private:
     int nSendVersion{0};
     NetPermissionFlags m_permissionFlags{ PF_NONE };
     std::list<CNetMessage> vRecvMsg;  // Used only by SocketHandler thread
+#ifdef USE_EPOLL
+    // Whether the socket may have data to receive, or space to send. Events are edge-triggered,
+    // so these are only cleared once a recv or send finds the socket drained or full.
+    bool m_sock_recv_ready{false}; // Used only by SocketHandler thread
+    bool m_sock_send_ready{false}; // Used only by SocketHandler thread
+#endif
 
     mutable CCriticalSection cs_addrName;
     std::string addrName GUARDED_BY(cs_addrName);
@@ -28,6 +28,7 @@
 #include <util/strencodings.h>
 #include <util/validation.h>
 
+#include <list>
 #include <memory>
 
 #if defined(NDEBUG)
@@ -40,6 +41,10 @@ static constexpr int64_t ORPHAN_TX_EXPIRE_TIME = 20 * 60;
 static constexpr int64_t ORPHAN_TX_EXPIRE_INTERVAL = 5 * 60;
 /** How long to cache transactions in mapRelay for normal relay */
 static constexpr std::chrono::seconds RELAY_TX_CACHE_TIME{15 * 60};
+/** Maximum memory of the serialized transactions kept in mapRelay */
+static constexpr size_t MAX_RELAY_TX_CACHE_BYTES = 32 * 1024 * 1024;
+/** Maximum memory of the block messages read from disk kept for serving other peers */
+static constexpr size_t MAX_BLOCK_SERVE_CACHE_BYTES = 64 * 1024 * 1024;
 /** Headers download timeout expressed in microseconds
  *  Timeout = base + per_header * (expected number of headers) */
 static constexpr int64_t HEADERS_DOWNLOAD_TIMEOUT_BASE = 15 * 60 * 1000000; // 15 minutes
@@ -171,9 +176,27 @@ namespace {
     /** When our tip was last updated. */
     std::atomic<int64_t> g_last_tip_update(0);
 
+    /**
+     * A transaction announced to peers. Its tx messages, with and without
+     * witness, are serialized on the first getdata for them, and shared by the
+     * send queues of all peers requesting it after that.
+     */
+    struct RelayTx {
+        CTransactionRef tx;
+        std::unique_ptr<const CSharedNetMsg> msg_with_witness;
+        std::unique_ptr<const CSharedNetMsg> msg_no_witness;
+
+        explicit RelayTx(CTransactionRef tx_in) : tx(std::move(tx_in)) {}
+    };
+
     /** Relay map */
-    typedef std::map<uint256, CTransactionRef> MapRelay;
+    typedef std::map<uint256, RelayTx> MapRelay;
     MapRelay mapRelay GUARDED_BY(cs_main);
+    /** Memory of the tx messages serialized in mapRelay entries, bounded by MAX_RELAY_TX_CACHE_BYTES */
+    size_t g_relay_tx_cache_bytes GUARDED_BY(cs_main) = 0;
+    size_t g_relay_tx_cache_entries GUARDED_BY(cs_main) = 0;
+    uint64_t g_relay_tx_cache_hits GUARDED_BY(cs_main) = 0;
+    uint64_t g_relay_tx_cache_misses GUARDED_BY(cs_main) = 0;
     /** Expiration-time ordered list of (expire time, relay map entry) pairs. */
     std::deque<std::pair<int64_t, MapRelay::iterator>> vRelayExpiration GUARDED_BY(cs_main);
 
@@ -679,6 +702,45 @@ static void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vec
     }
 }
 
+/** Add to vBlocks, up to count entries in total, the blocks below the snapshot
+ *  base that the background chainstate needs next, if the peer has them. */
+static void FindNextHistoricalBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<const CBlockIndex*>& vBlocks, const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    if (vBlocks.size() >= count)
+        return;
+
+    const CBlockIndex* target = GetBackgroundValidationTarget();
+    if (target == nullptr)
+        return;
+
+    CNodeState *state = State(nodeid);
+    assert(state != nullptr);
+
+    ProcessBlockAvailability(nodeid);
+    if (state->pindexBestKnownBlock == nullptr || state->pindexBestKnownBlock->GetAncestor(target->nHeight) != target) {
+        // This peer does not have the snapshot base.
+        return;
+    }
+
+    // Stay within BLOCK_DOWNLOAD_WINDOW of the background chainstate's tip,
+    // which connects the blocks in order.
+    const int nWindowStart = g_ibd_chainstate->m_chain.Height() + 1;
+    const int nWindowEnd = std::min<int>(target->nHeight, nWindowStart + BLOCK_DOWNLOAD_WINDOW - 1);
+    for (int nHeight = nWindowStart; nHeight <= nWindowEnd; nHeight++) {
+        const CBlockIndex* pindex = target->GetAncestor(nHeight);
+        if (!State(nodeid)->fHaveWitness && IsWitnessEnabled(pindex->pprev, consensusParams)) {
+            // We wouldn't download this block or its descendants from this peer.
+            return;
+        }
+        if (pindex->nStatus & BLOCK_HAVE_DATA || mapBlocksInFlight.count(pindex->GetBlockHash()))
+            continue;
+        vBlocks.push_back(pindex);
+        if (vBlocks.size() >= count) {
+            return;
+        }
+    }
+}
+
 void EraseTxRequest(const uint256& txid) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     g_already_asked_for.erase(txid);
@@ -1193,10 +1255,12 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
         fWitnessesPresentInMostRecentCompactBlock = fWitnessEnabled;
     }
 
-    connman->ForEachNode([this, &pcmpctblock, pindex, &msgMaker, fWitnessEnabled, &hashBlock](CNode* pnode) {
+    // Serialized on first use, and shared by the send queues of all peers it is announced to
+    std::unique_ptr<const CSharedNetMsg> cmpctblock_msg;
+
+    connman->ForEachNode([this, &pcmpctblock, &cmpctblock_msg, pindex, &msgMaker, fWitnessEnabled, &hashBlock](CNode* pnode) {
         AssertLockHeld(cs_main);
 
-        // TODO: Avoid the repeated-serialization here
         if (pnode->nVersion < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect)
             return;
         ProcessBlockAvailability(pnode->GetId());
@@ -1208,7 +1272,10 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
 
             LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->GetId());
-            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            if (!cmpctblock_msg) {
+                cmpctblock_msg = MakeUnique<const CSharedNetMsg>(msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            }
+            connman->PushMessage(pnode, *cmpctblock_msg);
             state.pindexBestHeaderSent = pindex;
         }
     });
@@ -1370,6 +1437,69 @@ static void RelayAddress(const CAddress& addr, bool fReachable, CConnman* connma
     connman->ForEachNodeThen(std::move(sortfunc), std::move(pushfunc));
 }
 
+namespace {
+/**
+ * Block messages recently read from disk to serve peers, least recently used
+ * last. Peers syncing from us request the same blocks around the same time,
+ * and share one disk read and checksum, and the payload in their send queues.
+ */
+class BlockServeCache
+{
+    Mutex m_mutex;
+    std::list<std::pair<uint256, std::shared_ptr<const CSharedNetMsg>>> m_lru GUARDED_BY(m_mutex);
+    std::map<uint256, decltype(m_lru)::iterator> m_index GUARDED_BY(m_mutex);
+    size_t m_bytes GUARDED_BY(m_mutex){0};
+    uint64_t m_hits GUARDED_BY(m_mutex){0};
+    uint64_t m_misses GUARDED_BY(m_mutex){0};
+
+public:
+    std::shared_ptr<const CSharedNetMsg> Get(const uint256& hash)
+    {
+        LOCK(m_mutex);
+        auto it = m_index.find(hash);
+        if (it == m_index.end()) {
+            m_misses++;
+            return nullptr;
+        }
+        m_hits++;
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return it->second->second;
+    }
+
+    void Insert(const uint256& hash, std::shared_ptr<const CSharedNetMsg> msg)
+    {
+        LOCK(m_mutex);
+        if (msg->data->size() > MAX_BLOCK_SERVE_CACHE_BYTES || m_index.count(hash)) return;
+        m_bytes += msg->data->size();
+        m_lru.emplace_front(hash, std::move(msg));
+        m_index.emplace(hash, m_lru.begin());
+        while (m_bytes > MAX_BLOCK_SERVE_CACHE_BYTES) {
+            m_bytes -= m_lru.back().second->data->size();
+            m_index.erase(m_lru.back().first);
+            m_lru.pop_back();
+        }
+    }
+
+    BlockServeCacheStats GetStats()
+    {
+        LOCK(m_mutex);
+        BlockServeCacheStats stats;
+        stats.hits = m_hits;
+        stats.misses = m_misses;
+        stats.entries = m_lru.size();
+        stats.bytes = m_bytes;
+        return stats;
+    }
+};
+
+BlockServeCache g_block_serve_cache;
+} // namespace
+
+BlockServeCacheStats GetBlockServeCacheStats()
+{
+    return g_block_serve_cache.GetStats();
+}
+
 void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, const CInv& inv, CConnman* connman)
 {
     bool send = false;
@@ -1446,11 +1576,17 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
         } else if (inv.type == MSG_WITNESS_BLOCK) {
             // Fast-path: in this case it is possible to serve the block directly from disk,
             // as the network format matches the format on disk
-            std::vector<uint8_t> block_data;
-            if (!ReadRawBlockFromDisk(block_data, pindex, chainparams.MessageStart())) {
-                assert(!"cannot load block from disk");
+            std::shared_ptr<const CSharedNetMsg> block_msg = g_block_serve_cache.Get(pindex->GetBlockHash());
+            if (!block_msg) {
+                CSerializedNetMsg serialized;
+                serialized.command = NetMsgType::BLOCK;
+                if (!ReadRawBlockFromDisk(serialized.data, pindex, chainparams.MessageStart())) {
+                    assert(!"cannot load block from disk");
+                }
+                block_msg = std::make_shared<const CSharedNetMsg>(std::move(serialized));
+                g_block_serve_cache.Insert(pindex->GetBlockHash(), block_msg);
             }
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(block_data)));
+            connman->PushMessage(pfrom, *block_msg);
             // Don't set pblock as we've sent the block
         } else {
             // Send block from disk
@@ -1525,6 +1661,51 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
     }
 }
 
+/** Send a relayed transaction, serializing its tx message if this is the first request for it. */
+static void PushRelayTx(CNode* pfrom, CConnman* connman, const CNetMsgMaker& msgMaker, RelayTx& relay_tx, int nSendFlags) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    std::unique_ptr<const CSharedNetMsg>& msg = (nSendFlags & SERIALIZE_TRANSACTION_NO_WITNESS) ? relay_tx.msg_no_witness : relay_tx.msg_with_witness;
+    if (msg) {
+        g_relay_tx_cache_hits++;
+        connman->PushMessage(pfrom, *msg);
+        return;
+    }
+
+    g_relay_tx_cache_misses++;
+    CSerializedNetMsg serialized = msgMaker.Make(nSendFlags, NetMsgType::TX, *relay_tx.tx);
+    if (g_relay_tx_cache_bytes + serialized.data.size() > MAX_RELAY_TX_CACHE_BYTES) {
+        connman->PushMessage(pfrom, std::move(serialized));
+        return;
+    }
+    g_relay_tx_cache_bytes += serialized.data.size();
+    g_relay_tx_cache_entries++;
+    msg = MakeUnique<const CSharedNetMsg>(std::move(serialized));
+    connman->PushMessage(pfrom, *msg);
+}
+
+/** Erase a mapRelay entry, and account for the tx messages serialized in it. */
+static void EraseRelayTx(MapRelay::iterator it) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    for (const auto* msg : {&it->second.msg_with_witness, &it->second.msg_no_witness}) {
+        if (*msg) {
+            g_relay_tx_cache_bytes -= (*msg)->data->size();
+            g_relay_tx_cache_entries--;
+        }
+    }
+    mapRelay.erase(it);
+}
+
+RelayTxCacheStats GetRelayTxCacheStats()
+{
+    LOCK(cs_main);
+    RelayTxCacheStats stats;
+    stats.hits = g_relay_tx_cache_hits;
+    stats.misses = g_relay_tx_cache_misses;
+    stats.entries = g_relay_tx_cache_entries;
+    stats.bytes = g_relay_tx_cache_bytes;
+    return stats;
+}
+
 void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc) LOCKS_EXCLUDED(cs_main)
 {
     AssertLockNotHeld(cs_main);
@@ -1559,7 +1740,7 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
             auto mi = mapRelay.find(inv.hash);
             int nSendFlags = (inv.type == MSG_TX ? SERIALIZE_TRANSACTION_NO_WITNESS : 0);
             if (mi != mapRelay.end()) {
-                connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::TX, *mi->second));
+                PushRelayTx(pfrom, connman, msgMaker, mi->second, nSendFlags);
                 push = true;
             } else {
                 auto txinfo = mempool.info(inv.hash);
@@ -3246,6 +3427,55 @@ bool PeerLogicValidation::CheckIfBanned(CNode* pnode)
     return false;
 }
 
+/** Process a received message whose header and checksum are valid, logging the exceptions it causes. */
+static bool ProcessReceivedMessage(CNode* pfrom, CNetMessage& msg, const CChainParams& chainparams, CConnman* connman, BanMan* banman, const std::atomic<bool>& interruptMsgProc)
+{
+    const std::string& strCommand = msg.m_command;
+    unsigned int nMessageSize = msg.m_message_size;
+    CDataStream& vRecv = msg.m_recv;
+
+    const int64_t nTimeStart = GetTimeMicros();
+    bool fRet = false;
+    try
+    {
+        fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.m_time, chainparams, connman, banman, interruptMsgProc);
+        if (interruptMsgProc)
+            return false;
+    }
+    catch (const std::ios_base::failure& e)
+    {
+        if (strstr(e.what(), "end of data")) {
+            // Allow exceptions from under-length message on vRecv
+            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught, normally caused by a message being shorter than its stated length\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
+        } else if (strstr(e.what(), "size too large")) {
+            // Allow exceptions from over-long size
+            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
+        } else if (strstr(e.what(), "non-canonical ReadCompactSize()")) {
+            // Allow exceptions from non-canonical encoding
+            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
+        } else if (strstr(e.what(), "Superfluous witness record")) {
+            // Allow exceptions from illegal witness encoding
+            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
+        } else if (strstr(e.what(), "Unknown transaction optional data")) {
+            // Allow exceptions from unknown witness encoding
+            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
+        } else {
+            PrintExceptionContinue(&e, "ProcessReceivedMessage()");
+        }
+    }
+    catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "ProcessReceivedMessage()");
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "ProcessReceivedMessage()");
+    }
+    connman->RecordMessageLatency(pfrom, strCommand, nTimeStart - msg.m_time, GetTimeMicros() - nTimeStart);
+
+    if (!fRet) {
+        LogPrint(BCLog::NET, "%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
+    }
+    return fRet;
+}
+
 bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
 {
     const CChainParams& chainparams = Params();
@@ -3316,7 +3546,6 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     unsigned int nMessageSize = msg.m_message_size;
 
     // Checksum
-    CDataStream& vRecv = msg.m_recv;
     if (!msg.m_valid_checksum)
     {
         LogPrint(BCLog::NET, "%s(%s, %u bytes): CHECKSUM ERROR peer=%d\n", __func__,
@@ -3325,45 +3554,11 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     }
 
     // Process message
-    bool fRet = false;
-    try
-    {
-        fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.m_time, chainparams, connman, m_banman, interruptMsgProc);
-        if (interruptMsgProc)
-            return false;
-        if (!pfrom->vRecvGetData.empty())
-            fMoreWork = true;
-    }
-    catch (const std::ios_base::failure& e)
-    {
-        if (strstr(e.what(), "end of data")) {
-            // Allow exceptions from under-length message on vRecv
-            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught, normally caused by a message being shorter than its stated length\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-        } else if (strstr(e.what(), "size too large")) {
-            // Allow exceptions from over-long size
-            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-        } else if (strstr(e.what(), "non-canonical ReadCompactSize()")) {
-            // Allow exceptions from non-canonical encoding
-            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-        } else if (strstr(e.what(), "Superfluous witness record")) {
-            // Allow exceptions from illegal witness encoding
-            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-        } else if (strstr(e.what(), "Unknown transaction optional data")) {
-            // Allow exceptions from unknown witness encoding
-            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-        } else {
-            PrintExceptionContinue(&e, "ProcessMessages()");
-        }
-    }
-    catch (const std::exception& e) {
-        PrintExceptionContinue(&e, "ProcessMessages()");
-    } catch (...) {
-        PrintExceptionContinue(nullptr, "ProcessMessages()");
-    }
-
-    if (!fRet) {
-        LogPrint(BCLog::NET, "%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
-    }
+    ProcessReceivedMessage(pfrom, msg, chainparams, connman, m_banman, interruptMsgProc);
+    if (interruptMsgProc)
+        return false;
+    if (!pfrom->vRecvGetData.empty())
+        fMoreWork = true;
 
     LOCK(cs_main);
     CheckIfBanned(pfrom);
@@ -3371,6 +3566,46 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     return fMoreWork;
 }
 
+/** Whether a message can be processed without cs_main, out of the message handler thread */
+static bool IsConcurrentMessage(const std::string& strCommand)
+{
+    return strCommand == NetMsgType::PING ||
+           strCommand == NetMsgType::PONG ||
+           strCommand == NetMsgType::FEEFILTER ||
+           strCommand == NetMsgType::FILTERLOAD ||
+           strCommand == NetMsgType::FILTERADD ||
+           strCommand == NetMsgType::FILTERCLEAR;
+}
+
+bool PeerLogicValidation::ProcessConcurrentMessage(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
+{
+    // Messages before the handshake completes, and pending getdata or orphan work, are left to
+    // ProcessMessages() to keep the order of responses.
+    if (!pfrom->fSuccessfullyConnected || pfrom->fDisconnect || pfrom->fPauseSend)
+        return false;
+    if (!pfrom->vRecvGetData.empty() || !pfrom->orphan_work_set.empty())
+        return false;
+
+    std::list<CNetMessage> msgs;
+    {
+        LOCK(pfrom->cs_vProcessMsg);
+        if (pfrom->vProcessMsg.empty())
+            return false;
+        const CNetMessage& next = pfrom->vProcessMsg.front();
+        if (!next.m_valid_netmagic || !next.m_valid_header || !next.m_valid_checksum || !IsConcurrentMessage(next.m_command))
+            return false;
+        msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
+        pfrom->nProcessQueueSize -= msgs.front().m_raw_message_size;
+        pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
+    }
+    CNetMessage& msg(msgs.front());
+    msg.SetVersion(pfrom->GetRecvVersion());
+
+    // Misbehaving peers are disconnected by CheckIfBanned() in SendMessages().
+    ProcessReceivedMessage(pfrom, msg, Params(), connman, m_banman, interruptMsgProc);
+    return true;
+}
+
 void PeerLogicValidation::ConsiderEviction(CNode *pto, int64_t time_in_seconds)
 {
     AssertLockHeld(cs_main);
@@ -3897,11 +4132,11 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                             // Expire old relay messages
                             while (!vRelayExpiration.empty() && vRelayExpiration.front().first < nNow)
                             {
-                                mapRelay.erase(vRelayExpiration.front().second);
+                                EraseRelayTx(vRelayExpiration.front().second);
                                 vRelayExpiration.pop_front();
                             }
 
-                            auto ret = mapRelay.insert(std::make_pair(hash, std::move(txinfo.tx)));
+                            auto ret = mapRelay.emplace(hash, std::move(txinfo.tx));
                             if (ret.second) {
                                 vRelayExpiration.push_back(std::make_pair(nNow + std::chrono::microseconds{RELAY_TX_CACHE_TIME}.count(), ret.first));
                             }
@@ -3990,6 +4225,10 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
             std::vector<const CBlockIndex*> vToDownload;
             NodeId staller = -1;
             FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller, consensusParams);
+            // Only full nodes serve the blocks below a snapshot base.
+            if (!pto->m_limited_node) {
+                FindNextHistoricalBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, consensusParams);
+            }
             for (const CBlockIndex *pindex : vToDownload) {
                 uint32_t nFetchFlags = GetFetchFlags(pto);
                 vGetData.push_back(CInv(MSG_BLOCK | nFetchFlags, pindex->GetBlockHash()));
@@ -58,6 +58,15 @@ public:
     */
     bool ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt) override;
     /**
+    * Process the next message of a given node on a message worker thread, if it does
+    * not need cs_main (ping, pong, feefilter and bloom filter messages).
+    *
+    * @param[in]   pfrom           The node which we have received messages from.
+    * @param[in]   interrupt       Interrupt condition for processing threads
+    * @return                      True if a message was processed
+    */
+    bool ProcessConcurrentMessage(CNode* pfrom, std::atomic<bool>& interrupt) override;
+    /**
     * Send queued protocol messages to be sent to a give node.
     *
     * @param[in]   pto             The node which we are sending messages to.
@@ -86,6 +95,26 @@ struct CNodeStateStats {
 /** Get statistics from node state */
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 
+struct RelayTxCacheStats {
+    uint64_t hits = 0;          //!< getdata answered with an already serialized transaction
+    uint64_t misses = 0;        //!< getdata that serialized a relayed transaction
+    size_t entries = 0;         //!< Serialized transactions cached
+    size_t bytes = 0;           //!< Memory of the serialized transactions cached
+};
+
+/** Get statistics of the serialized relay transaction cache */
+RelayTxCacheStats GetRelayTxCacheStats();
+
+struct BlockServeCacheStats {
+    uint64_t hits = 0;          //!< Blocks served without reading them from disk
+    uint64_t misses = 0;        //!< Blocks read from disk to be served
+    size_t entries = 0;         //!< Block messages cached
+    size_t bytes = 0;           //!< Memory of the block messages cached
+};
+
+/** Get statistics of the cache of blocks served from disk */
+BlockServeCacheStats GetBlockServeCacheStats();
+
 /** Relay transaction to every node */
 void RelayTransaction(const uint256&, const CConnman& connman);
 
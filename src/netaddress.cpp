@@ -823,6 +823,24 @@ std::string CSubNet::ToString() const
     return network.ToString() + "/" + strNetmask;
 }
 
+int CSubNet::GetPrefixLength() const
+{
+    int n = 0;
+    while (n < 16 && netmask[n] == 0xff)
+        ++n;
+    int bits = n * 8;
+    if (n < 16) {
+        const int tail = NetmaskBits(netmask[n]);
+        if (tail < 0)
+            return -1;
+        bits += tail;
+        for (++n; n < 16; ++n)
+            if (netmask[n] != 0x00)
+                return -1;
+    }
+    return bits;
+}
+
 bool CSubNet::IsValid() const
 {
     return valid;
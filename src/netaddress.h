@@ -118,6 +118,11 @@ class CSubNet
 
         bool Match(const CNetAddr &addr) const;
 
+        /// The network address, with the bits outside of the netmask cleared
+        const CNetAddr& GetNetwork() const { return network; }
+        /// Number of leading address bits, of all 128, covered by the netmask, or -1 if it is not a prefix
+        int GetPrefixLength() const;
+
         std::string ToString() const;
         bool IsValid() const;
 
@@ -0,0 +1,83 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/rollingcoinstats.h>
+
+#include <coins.h>
+#include <streams.h>
+#include <util/system.h>
+#include <version.h>
+
+#include <memory>
+#include <vector>
+
+//! The serialization of a coin that is hashed into RollingCoinStats::muhash
+static void TxOutSer(std::vector<unsigned char>& out, const COutPoint& outpoint, const Coin& coin)
+{
+    CVectorWriter ss(SER_DISK, PROTOCOL_VERSION, out, 0);
+    ss << outpoint;
+    ss << static_cast<uint32_t>(coin.nHeight * 2 + coin.fCoinBase);
+    ss << coin.out;
+}
+
+//! Same per-output size estimate as GetUTXOStats()
+static uint64_t GetBogoSize(const Coin& coin)
+{
+    return 32 /* txid */ + 4 /* vout index */ + 4 /* height + coinbase */ + 8 /* amount */ +
+           2 /* scriptPubKey len */ + coin.out.scriptPubKey.size() /* scriptPubKey */;
+}
+
+void RollingCoinStats::Add(const COutPoint& outpoint, const Coin& coin)
+{
+    std::vector<unsigned char> ser;
+    TxOutSer(ser, outpoint, coin);
+    muhash.Insert(ser.data(), ser.size());
+    ++coins_count;
+    bogo_size += GetBogoSize(coin);
+    total_amount += coin.out.nValue;
+}
+
+void RollingCoinStats::Remove(const COutPoint& outpoint, const Coin& coin)
+{
+    std::vector<unsigned char> ser;
+    TxOutSer(ser, outpoint, coin);
+    muhash.Remove(ser.data(), ser.size());
+    --coins_count;
+    bogo_size -= GetBogoSize(coin);
+    total_amount -= coin.out.nValue;
+}
+
+void RollingCoinStats::ApplyChanges(const CCoinsViewCache& view)
+{
+    view.ForEachModifiedCoin([this](const COutPoint& outpoint, const Coin& previous, const Coin& coin) {
+        if (!previous.IsSpent()) Remove(outpoint, previous);
+        if (!coin.IsSpent()) Add(outpoint, coin);
+    });
+}
+
+uint256 RollingCoinStats::GetHash() const
+{
+    uint256 out;
+    muhash.Finalize(out);
+    return out;
+}
+
+bool ComputeRollingCoinStats(CCoinsView* view, RollingCoinStats& stats, const std::function<bool()>& interrupt)
+{
+    stats = RollingCoinStats();
+    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
+    assert(pcursor);
+
+    while (pcursor->Valid()) {
+        COutPoint key;
+        Coin coin;
+        if (!pcursor->GetKey(key) || !pcursor->GetValue(coin)) {
+            return error("%s: unable to read value", __func__);
+        }
+        stats.Add(key, coin);
+        if (stats.coins_count % 100000 == 0 && interrupt()) return false;
+        pcursor->Next();
+    }
+    return true;
+}
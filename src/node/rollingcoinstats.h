@@ -0,0 +1,59 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_ROLLINGCOINSTATS_H
+#define BITCOIN_NODE_ROLLINGCOINSTATS_H
+
+#include <amount.h>
+#include <crypto/muhash.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <cstdint>
+#include <functional>
+
+class CCoinsView;
+class CCoinsViewCache;
+class COutPoint;
+class Coin;
+
+/**
+ * Statistics about the unspent transaction output set that are updated coin
+ * by coin as blocks are connected and disconnected, so that they can be
+ * queried without walking the whole set like GetUTXOStats() does. The set is
+ * hashed with MuHash3072, which allows coins to be added and removed in any
+ * order.
+ */
+struct RollingCoinStats
+{
+    MuHash3072 muhash;
+    uint64_t coins_count{0};
+    uint64_t bogo_size{0};
+    CAmount total_amount{0};
+
+    void Add(const COutPoint& outpoint, const Coin& coin);
+    void Remove(const COutPoint& outpoint, const Coin& coin);
+
+    //! Account for the coins `view` modified on top of its backing view, before they are flushed to it.
+    void ApplyChanges(const CCoinsViewCache& view);
+
+    //! @returns the MuHash3072 digest of the set.
+    uint256 GetHash() const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(muhash);
+        READWRITE(coins_count);
+        READWRITE(bogo_size);
+        READWRITE(total_amount);
+    }
+};
+
+//! Calculate the rolling statistics of the unspent transaction output set from scratch
+bool ComputeRollingCoinStats(CCoinsView* view, RollingCoinStats& stats, const std::function<bool()>& interrupt);
+
+#endif // BITCOIN_NODE_ROLLINGCOINSTATS_H
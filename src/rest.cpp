@@ -291,6 +291,53 @@ static bool rest_chaininfo(HTTPRequest* req, const std::string& strURIPart)
     }
 }
 
+// A bit of a hack - dependency on a function defined in rpc/blockchain.cpp
+UniValue getaddresshistory(const JSONRPCRequest& request);
+
+static bool rest_address_history(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() != 3)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No count and skip specified. Use /rest/addresshistory/<count>/<skip>/<address>.<ext>.");
+
+    int32_t count, skip;
+    if (!ParseInt32(path[0], &count))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid count: " + SanitizeString(path[0]));
+    if (!ParseInt32(path[1], &skip))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid skip: " + SanitizeString(path[1]));
+
+    switch (rf) {
+    case RetFormat::JSON: {
+        JSONRPCRequest jsonRequest;
+        jsonRequest.params = UniValue(UniValue::VARR);
+        jsonRequest.params.push_back(path[2]);
+        jsonRequest.params.push_back(skip);
+        jsonRequest.params.push_back(count);
+        UniValue history;
+        try {
+            history = getaddresshistory(jsonRequest);
+        } catch (const UniValue& objError) {
+            // RPC_MISC_ERROR means the index is disabled or still syncing, not a bad request
+            const bool unavailable = find_value(objError, "code").get_int() == RPC_MISC_ERROR;
+            return RESTERR(req, unavailable ? HTTP_SERVICE_UNAVAILABLE : HTTP_BAD_REQUEST, find_value(objError, "message").get_str());
+        }
+        std::string strJSON = history.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+    }
+    }
+}
+
 static bool rest_mempool_info(HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -634,6 +681,7 @@ static const struct {
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/addresshistory/", rest_address_history},
 };
 
 void StartREST()
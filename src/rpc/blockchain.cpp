@@ -12,18 +12,27 @@
 #include <coins.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <crypto/siphash.h>
 #include <hash.h>
+#include <key_io.h>
+#include <index/addrindex.h>
 #include <index/blockfilterindex.h>
+#include <index/coinstatsindex.h>
+#include <index/txospenderindex.h>
+#include <index/txindex.h>
 #include <node/coinstats.h>
 #include <node/context.h>
+#include <node/rollingcoinstats.h>
 #include <node/utxo_snapshot.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
 #include <policy/rbf.h>
 #include <primitives/transaction.h>
+#include <random.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
+#include <script/standard.h>
 #include <streams.h>
 #include <sync.h>
 #include <txdb.h>
@@ -43,6 +52,8 @@
 #include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <unordered_set>
 
 struct CUpdatedBlock
 {
@@ -409,37 +420,33 @@ static std::string EntryDescriptionString()
            "    \"bip125-replaceable\" : true|false,  (boolean) Whether this transaction could be replaced due to BIP125 (replace-by-fee)\n";
 }
 
-static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPoolEntry& e) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+static void entryToJSON(UniValue& info, const MemPoolSnapshot::Entry& e)
 {
-    AssertLockHeld(pool.cs);
-
     UniValue fees(UniValue::VOBJ);
-    fees.pushKV("base", ValueFromAmount(e.GetFee()));
-    fees.pushKV("modified", ValueFromAmount(e.GetModifiedFee()));
-    fees.pushKV("ancestor", ValueFromAmount(e.GetModFeesWithAncestors()));
-    fees.pushKV("descendant", ValueFromAmount(e.GetModFeesWithDescendants()));
+    fees.pushKV("base", ValueFromAmount(e.fee));
+    fees.pushKV("modified", ValueFromAmount(e.modified_fee));
+    fees.pushKV("ancestor", ValueFromAmount(e.mod_fees_with_ancestors));
+    fees.pushKV("descendant", ValueFromAmount(e.mod_fees_with_descendants));
     info.pushKV("fees", fees);
 
-    info.pushKV("vsize", (int)e.GetTxSize());
-    if (IsDeprecatedRPCEnabled("size")) info.pushKV("size", (int)e.GetTxSize());
-    info.pushKV("weight", (int)e.GetTxWeight());
-    info.pushKV("fee", ValueFromAmount(e.GetFee()));
-    info.pushKV("modifiedfee", ValueFromAmount(e.GetModifiedFee()));
-    info.pushKV("time", count_seconds(e.GetTime()));
-    info.pushKV("height", (int)e.GetHeight());
-    info.pushKV("descendantcount", e.GetCountWithDescendants());
-    info.pushKV("descendantsize", e.GetSizeWithDescendants());
-    info.pushKV("descendantfees", e.GetModFeesWithDescendants());
-    info.pushKV("ancestorcount", e.GetCountWithAncestors());
-    info.pushKV("ancestorsize", e.GetSizeWithAncestors());
-    info.pushKV("ancestorfees", e.GetModFeesWithAncestors());
-    info.pushKV("wtxid", pool.vTxHashes[e.vTxHashesIdx].first.ToString());
-    const CTransaction& tx = e.GetTx();
+    info.pushKV("vsize", (int)e.vsize);
+    if (IsDeprecatedRPCEnabled("size")) info.pushKV("size", (int)e.vsize);
+    info.pushKV("weight", (int)e.weight);
+    info.pushKV("fee", ValueFromAmount(e.fee));
+    info.pushKV("modifiedfee", ValueFromAmount(e.modified_fee));
+    info.pushKV("time", count_seconds(e.time));
+    info.pushKV("height", (int)e.height);
+    info.pushKV("descendantcount", e.count_with_descendants);
+    info.pushKV("descendantsize", e.size_with_descendants);
+    info.pushKV("descendantfees", e.mod_fees_with_descendants);
+    info.pushKV("ancestorcount", e.count_with_ancestors);
+    info.pushKV("ancestorsize", e.size_with_ancestors);
+    info.pushKV("ancestorfees", e.mod_fees_with_ancestors);
+    info.pushKV("wtxid", e.tx->GetWitnessHash().ToString());
     std::set<std::string> setDepends;
-    for (const CTxIn& txin : tx.vin)
+    for (const uint256& parent : e.depends)
     {
-        if (pool.exists(txin.prevout.hash))
-            setDepends.insert(txin.prevout.hash.ToString());
+        setDepends.insert(parent.ToString());
     }
 
     UniValue depends(UniValue::VARR);
@@ -451,35 +458,35 @@ static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPool
     info.pushKV("depends", depends);
 
     UniValue spent(UniValue::VARR);
-    const CTxMemPool::txiter& it = pool.mapTx.find(tx.GetHash());
-    const CTxMemPool::setEntries& setChildren = pool.GetMemPoolChildren(it);
-    for (CTxMemPool::txiter childiter : setChildren) {
-        spent.push_back(childiter->GetTx().GetHash().ToString());
+    for (const uint256& child : e.spentby) {
+        spent.push_back(child.ToString());
     }
 
     info.pushKV("spentby", spent);
 
     // Add opt-in RBF status
-    bool rbfStatus = false;
-    RBFTransactionState rbfState = IsRBFOptIn(tx, pool);
-    if (rbfState == RBFTransactionState::UNKNOWN) {
-        throw JSONRPCError(RPC_MISC_ERROR, "Transaction is not in mempool");
-    } else if (rbfState == RBFTransactionState::REPLACEABLE_BIP125) {
-        rbfStatus = true;
-    }
+    info.pushKV("bip125-replaceable", e.bip125_replaceable);
+}
 
-    info.pushKV("bip125-replaceable", rbfStatus);
+/** Copy an entry under pool.cs, so it can be turned into JSON after releasing the lock */
+static MemPoolSnapshot::Entry CopyEntry(const CTxMemPool& pool, CTxMemPool::txiter it) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+{
+    MemPoolSnapshot::Entry entry = pool.GetSnapshotEntry(it);
+    entry.bip125_replaceable = IsRBFOptIn(it->GetTx(), pool) == RBFTransactionState::REPLACEABLE_BIP125;
+    return entry;
 }
 
 UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose)
 {
     if (verbose) {
-        LOCK(pool.cs);
+        // Readers share a snapshot, so formatting a large mempool does not
+        // hold up transaction acceptance or block connection.
+        const std::shared_ptr<const MemPoolSnapshot> snapshot = pool.GetSnapshot();
         UniValue o(UniValue::VOBJ);
-        for (const CTxMemPoolEntry& e : pool.mapTx) {
-            const uint256& hash = e.GetTx().GetHash();
+        for (const MemPoolSnapshot::Entry& e : snapshot->entries) {
+            const uint256& hash = e.tx->GetHash();
             UniValue info(UniValue::VOBJ);
-            entryToJSON(pool, info, e);
+            entryToJSON(info, e);
             // Mempool has unique entries so there is no advantage in using
             // UniValue::pushKV, which checks if the key already exists in O(N).
             // UniValue::__pushKV is used instead which currently is O(1).
@@ -566,32 +573,40 @@ static UniValue getmempoolancestors(const JSONRPCRequest& request)
 
     uint256 hash = ParseHashV(request.params[0], "parameter 1");
 
-    LOCK(mempool.cs);
+    std::vector<uint256> ancestors;
+    std::vector<MemPoolSnapshot::Entry> entries;
+    {
+        LOCK(mempool.cs);
 
-    CTxMemPool::txiter it = mempool.mapTx.find(hash);
-    if (it == mempool.mapTx.end()) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction not in mempool");
-    }
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it == mempool.mapTx.end()) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction not in mempool");
+        }
 
-    CTxMemPool::setEntries setAncestors;
-    uint64_t noLimit = std::numeric_limits<uint64_t>::max();
-    std::string dummy;
-    mempool.CalculateMemPoolAncestors(*it, setAncestors, noLimit, noLimit, noLimit, noLimit, dummy, false);
+        CTxMemPool::setEntries setAncestors;
+        uint64_t noLimit = std::numeric_limits<uint64_t>::max();
+        std::string dummy;
+        mempool.CalculateMemPoolAncestors(*it, setAncestors, noLimit, noLimit, noLimit, noLimit, dummy, false);
+
+        for (CTxMemPool::txiter ancestorIt : setAncestors) {
+            ancestors.push_back(ancestorIt->GetTx().GetHash());
+            if (fVerbose) entries.push_back(CopyEntry(mempool, ancestorIt));
+        }
+    }
 
     if (!fVerbose) {
         UniValue o(UniValue::VARR);
-        for (CTxMemPool::txiter ancestorIt : setAncestors) {
-            o.push_back(ancestorIt->GetTx().GetHash().ToString());
+        for (const uint256& ancestor : ancestors) {
+            o.push_back(ancestor.ToString());
         }
 
         return o;
     } else {
         UniValue o(UniValue::VOBJ);
-        for (CTxMemPool::txiter ancestorIt : setAncestors) {
-            const CTxMemPoolEntry &e = *ancestorIt;
-            const uint256& _hash = e.GetTx().GetHash();
+        for (const MemPoolSnapshot::Entry& e : entries) {
+            const uint256& _hash = e.tx->GetHash();
             UniValue info(UniValue::VOBJ);
-            entryToJSON(::mempool, info, e);
+            entryToJSON(info, e);
             o.pushKV(_hash.ToString(), info);
         }
         return o;
@@ -633,32 +648,40 @@ static UniValue getmempooldescendants(const JSONRPCRequest& request)
 
     uint256 hash = ParseHashV(request.params[0], "parameter 1");
 
-    LOCK(mempool.cs);
+    std::vector<uint256> descendants;
+    std::vector<MemPoolSnapshot::Entry> entries;
+    {
+        LOCK(mempool.cs);
+
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it == mempool.mapTx.end()) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction not in mempool");
+        }
 
-    CTxMemPool::txiter it = mempool.mapTx.find(hash);
-    if (it == mempool.mapTx.end()) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction not in mempool");
-    }
+        CTxMemPool::setEntries setDescendants;
+        mempool.CalculateDescendants(it, setDescendants);
+        // CTxMemPool::CalculateDescendants will include the given tx
+        setDescendants.erase(it);
 
-    CTxMemPool::setEntries setDescendants;
-    mempool.CalculateDescendants(it, setDescendants);
-    // CTxMemPool::CalculateDescendants will include the given tx
-    setDescendants.erase(it);
+        for (CTxMemPool::txiter descendantIt : setDescendants) {
+            descendants.push_back(descendantIt->GetTx().GetHash());
+            if (fVerbose) entries.push_back(CopyEntry(mempool, descendantIt));
+        }
+    }
 
     if (!fVerbose) {
         UniValue o(UniValue::VARR);
-        for (CTxMemPool::txiter descendantIt : setDescendants) {
-            o.push_back(descendantIt->GetTx().GetHash().ToString());
+        for (const uint256& descendant : descendants) {
+            o.push_back(descendant.ToString());
         }
 
         return o;
     } else {
         UniValue o(UniValue::VOBJ);
-        for (CTxMemPool::txiter descendantIt : setDescendants) {
-            const CTxMemPoolEntry &e = *descendantIt;
-            const uint256& _hash = e.GetTx().GetHash();
+        for (const MemPoolSnapshot::Entry& e : entries) {
+            const uint256& _hash = e.tx->GetHash();
             UniValue info(UniValue::VOBJ);
-            entryToJSON(::mempool, info, e);
+            entryToJSON(info, e);
             o.pushKV(_hash.ToString(), info);
         }
         return o;
@@ -685,19 +708,111 @@ static UniValue getmempoolentry(const JSONRPCRequest& request)
 
     uint256 hash = ParseHashV(request.params[0], "parameter 1");
 
-    LOCK(mempool.cs);
+    MemPoolSnapshot::Entry e;
+    {
+        LOCK(mempool.cs);
 
-    CTxMemPool::txiter it = mempool.mapTx.find(hash);
-    if (it == mempool.mapTx.end()) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction not in mempool");
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it == mempool.mapTx.end()) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction not in mempool");
+        }
+        e = CopyEntry(mempool, it);
     }
 
-    const CTxMemPoolEntry &e = *it;
     UniValue info(UniValue::VOBJ);
-    entryToJSON(::mempool, info, e);
+    entryToJSON(info, e);
     return info;
 }
 
+static UniValue gettxspendingprevout(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"gettxspendingprevout",
+                "\nReturns the transactions spending the given outputs, from the mempool or, with -txospenderindex, the active chain.\n"
+                "While -txospenderindex is still syncing, outputs it has no spender for yet are reported as an error.\n",
+                {
+                    {"outputs", RPCArg::Type::ARR, RPCArg::Optional::NO, "The outputs to look up",
+                        {
+                            {"", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "",
+                                {
+                                    {"txid", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The transaction id"},
+                                    {"vout", RPCArg::Type::NUM, RPCArg::Optional::NO, "The output number"},
+                                },
+                            },
+                        },
+                    },
+                },
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"txid\" : \"hex\",           (string) The transaction id of the output, as given\n"
+            "    \"vout\" : n,                 (numeric) The output number, as given\n"
+            "    \"spendingtxid\" : \"hex\",   (string) The transaction id of the spending transaction, if any\n"
+            "    \"height\" : n,               (numeric) The height of the block containing the spending transaction, if not in the mempool\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("gettxspendingprevout", "\"[{\\\"txid\\\":\\\"mytxid\\\",\\\"vout\\\":0}]\"")
+            + HelpExampleRpc("gettxspendingprevout", "\"[{\\\"txid\\\":\\\"mytxid\\\",\\\"vout\\\":0}]\"")
+                },
+            }.Check(request);
+
+    const UniValue& outputs = request.params[0].get_array();
+    if (outputs.empty()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameter, outputs are missing");
+    }
+
+    std::vector<COutPoint> prevouts;
+    prevouts.reserve(outputs.size());
+    for (unsigned int i = 0; i < outputs.size(); ++i) {
+        const UniValue& o = outputs[i].get_obj();
+        RPCTypeCheckObj(o,
+            {
+                {"txid", UniValueType(UniValue::VSTR)},
+                {"vout", UniValueType(UniValue::VNUM)},
+            }, /* fAllowNull */ false, /* fStrict */ true);
+        const uint256 txid = ParseHashO(o, "txid");
+        const int vout = find_value(o, "vout").get_int();
+        if (vout < 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameter, vout cannot be negative");
+        }
+        prevouts.emplace_back(txid, vout);
+    }
+
+    const bool index_ready = !g_txospender_index || g_txospender_index->BlockUntilSyncedToCurrentChain();
+
+    std::vector<uint256> mempool_spenders(prevouts.size());
+    {
+        LOCK(::mempool.cs);
+        for (size_t i = 0; i < prevouts.size(); ++i) {
+            const CTransaction* spending_tx = ::mempool.GetConflictTx(prevouts[i]);
+            if (spending_tx) mempool_spenders[i] = spending_tx->GetHash();
+        }
+    }
+
+    UniValue result(UniValue::VARR);
+    for (size_t i = 0; i < prevouts.size(); ++i) {
+        const COutPoint& prevout = prevouts[i];
+        UniValue o(UniValue::VOBJ);
+        o.pushKV("txid", prevout.hash.GetHex());
+        o.pushKV("vout", (int64_t)prevout.n);
+
+        uint256 spending_txid;
+        int height;
+        if (!mempool_spenders[i].IsNull()) {
+            o.pushKV("spendingtxid", mempool_spenders[i].GetHex());
+        } else if (g_txospender_index && g_txospender_index->FindSpender(prevout, spending_txid, height)) {
+            o.pushKV("spendingtxid", spending_txid.GetHex());
+            o.pushKV("height", height);
+        } else if (!index_ready) {
+            throw JSONRPCError(RPC_MISC_ERROR, strprintf("No spending transaction found for %s:%d. Blockchain transactions are still in the process of being indexed", prevout.hash.GetHex(), prevout.n));
+        }
+        result.push_back(o);
+    }
+    return result;
+}
+
 static UniValue getblockhash(const JSONRPCRequest& request)
 {
             RPCHelpMan{"getblockhash",
@@ -973,32 +1088,109 @@ static UniValue pruneblockchain(const JSONRPCRequest& request)
     return uint64_t(block->nHeight);
 }
 
+//! Look up a block of the active chain given as either a hash or a height
+static CBlockIndex* ParseHashOrHeight(const UniValue& param) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    CBlockIndex* pindex;
+    if (param.isNum()) {
+        const int height = param.get_int();
+        const int current_tip = ::ChainActive().Height();
+        if (height < 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d is negative", height));
+        }
+        if (height > current_tip) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d after current tip %d", height, current_tip));
+        }
+
+        pindex = ::ChainActive()[height];
+    } else {
+        const uint256 hash(ParseHashV(param, "hash_or_height"));
+        pindex = LookupBlockIndex(hash);
+        if (!pindex) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        }
+        if (!::ChainActive().Contains(pindex)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Block is not in chain %s", Params().NetworkIDString()));
+        }
+    }
+
+    CHECK_NONFATAL(pindex != nullptr);
+    return pindex;
+}
+
 static UniValue gettxoutsetinfo(const JSONRPCRequest& request)
 {
             RPCHelpMan{"gettxoutsetinfo",
                 "\nReturns statistics about the unspent transaction output set.\n"
-                "Note this call may take some time.\n",
-                {},
+                "Note this call may take some time, unless hash_type is 'muhash'.\n",
+                {
+                    {"hash_type", RPCArg::Type::STR, /* default */ "hash_serialized_2", "Which UTXO set hash should be calculated. Options: 'hash_serialized_2' (scans the whole set), 'muhash' (maintained as blocks are connected, returned immediately)."},
+                    {"hash_or_height", RPCArg::Type::NUM, /* default */ "the current best block", "The block hash or height of the UTXO set to return statistics for. Only with hash_type 'muhash', and requires -coinstatsindex.", "", {"", "string or numeric"}},
+                },
                 RPCResult{
             "{\n"
-            "  \"height\":n,     (numeric) The current block height (index)\n"
-            "  \"bestblock\": \"hex\",   (string) The hash of the block at the tip of the chain\n"
-            "  \"transactions\": n,      (numeric) The number of transactions with unspent outputs\n"
+            "  \"height\":n,     (numeric) The block height (index) of the returned statistics\n"
+            "  \"bestblock\": \"hex\",   (string) The hash of the block at which the statistics are taken\n"
+            "  \"transactions\": n,      (numeric) The number of transactions with unspent outputs (only with hash_type 'hash_serialized_2')\n"
             "  \"txouts\": n,            (numeric) The number of unspent transaction outputs\n"
             "  \"bogosize\": n,          (numeric) A meaningless metric for UTXO set size\n"
-            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash\n"
-            "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk\n"
+            "  \"hash_serialized_2\": \"hash\", (string) The serialized hash (only with hash_type 'hash_serialized_2')\n"
+            "  \"muhash\": \"hash\",      (string) The MuHash3072 of the set (only with hash_type 'muhash')\n"
+            "  \"disk_size\": n,         (numeric) The estimated size of the chainstate on disk (not for a specific hash_or_height)\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
             "}\n"
                 },
                 RPCExamples{
                     HelpExampleCli("gettxoutsetinfo", "")
+            + HelpExampleCli("gettxoutsetinfo", "muhash")
+            + HelpExampleCli("gettxoutsetinfo", "muhash 1000")
             + HelpExampleRpc("gettxoutsetinfo", "")
                 },
             }.Check(request);
 
     UniValue ret(UniValue::VOBJ);
 
+    const std::string hash_type = request.params[0].isNull() ? "hash_serialized_2" : request.params[0].get_str();
+    if (!request.params[1].isNull()) {
+        if (hash_type != "muhash") {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Statistics for a specific block are only available with hash_type muhash");
+        }
+        if (!g_coin_stats_index) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Querying specific block heights requires -coinstatsindex");
+        }
+        g_coin_stats_index->BlockUntilSyncedToCurrentChain();
+
+        const CBlockIndex* pindex = WITH_LOCK(cs_main, return ParseHashOrHeight(request.params[1]));
+        CCoinsStats stats;
+        uint256 muhash;
+        if (!g_coin_stats_index->LookUpStats(pindex, stats, muhash)) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, strprintf("Statistics for block %s are not available yet; the coinstatsindex is still syncing", pindex->GetBlockHash().GetHex()));
+        }
+        ret.pushKV("height", (int64_t)stats.nHeight);
+        ret.pushKV("bestblock", stats.hashBlock.GetHex());
+        ret.pushKV("txouts", stats.coins_count);
+        ret.pushKV("bogosize", stats.nBogoSize);
+        ret.pushKV("muhash", muhash.GetHex());
+        ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
+        return ret;
+    }
+    if (hash_type == "muhash") {
+        LOCK(cs_main);
+        const CBlockIndex* tip = ::ChainActive().Tip();
+        const RollingCoinStats& stats = ::ChainstateActive().m_rolling_coin_stats;
+        ret.pushKV("height", (int64_t)tip->nHeight);
+        ret.pushKV("bestblock", tip->GetBlockHash().GetHex());
+        ret.pushKV("txouts", stats.coins_count);
+        ret.pushKV("bogosize", stats.bogo_size);
+        ret.pushKV("muhash", stats.GetHash().GetHex());
+        ret.pushKV("disk_size", (uint64_t)::ChainstateActive().CoinsDB().EstimateSize());
+        ret.pushKV("total_amount", ValueFromAmount(stats.total_amount));
+        return ret;
+    }
+    if (hash_type != "hash_serialized_2") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("%s is not a valid hash_type", hash_type));
+    }
+
     CCoinsStats stats;
     ::ChainstateActive().ForceFlushStateToDisk();
 
@@ -1214,6 +1406,18 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
             "  \"pruneheight\": xxxxxx,        (numeric) lowest-height complete block stored (only present if pruning is enabled)\n"
             "  \"automatic_pruning\": xx,      (boolean) whether automatic pruning is enabled (only present if pruning is enabled)\n"
             "  \"prune_target_size\": xxxxxx,  (numeric) the target size used by pruning (only present if automatic pruning is enabled)\n"
+            "  \"background_validation\": {    (object) progress of the validation of the blocks below the UTXO snapshot the chainstate was loaded from (only present while in progress)\n"
+            "     \"height\": xxxxxx,          (numeric) the height of the last block validated\n"
+            "     \"snapshot_height\": xxxxxx, (numeric) the height of the base of the snapshot\n"
+            "  },\n"
+            "  \"coins_flush\": {              (object) time spent writing the chainstate cache to disk since startup\n"
+            "     \"count\": xxxxxx,           (numeric) the number of full flushes\n"
+            "     \"background\": xxxxxx,      (numeric) how many of them were written in the background (see -backgroundflush)\n"
+            "     \"last_write_time\": xxx,    (numeric) seconds the last completed database write took\n"
+            "     \"last_pause_time\": xxx,    (numeric) seconds validation was held up by the last flush\n"
+            "     \"max_pause_time\": xxx,     (numeric) the longest a flush held up validation, in seconds\n"
+            "     \"total_pause_time\": xxx,   (numeric) seconds validation was held up by flushes in total\n"
+            "  },\n"
             "  \"softforks\": {                (object) status of softforks\n"
             "     \"xxxx\" : {                 (string) name of the softfork\n"
             "        \"type\": \"xxxx\",         (string) one of \"buried\", \"bip9\"\n"
@@ -1276,6 +1480,24 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
         }
     }
 
+    const CBlockIndex* snapshot_base = GetBackgroundValidationTarget();
+    if (snapshot_base) {
+        UniValue background_validation(UniValue::VOBJ);
+        background_validation.pushKV("height", g_ibd_chainstate->m_chain.Height());
+        background_validation.pushKV("snapshot_height", snapshot_base->nHeight);
+        obj.pushKV("background_validation", background_validation);
+    }
+
+    const CoinsFlushStats flush_stats = ::ChainstateActive().GetCoinsFlushStats();
+    UniValue coins_flush(UniValue::VOBJ);
+    coins_flush.pushKV("count", flush_stats.count);
+    coins_flush.pushKV("background", flush_stats.background_count);
+    coins_flush.pushKV("last_write_time", flush_stats.last_write_time * 1e-6);
+    coins_flush.pushKV("last_pause_time", flush_stats.last_pause_time * 1e-6);
+    coins_flush.pushKV("max_pause_time", flush_stats.max_pause_time * 1e-6);
+    coins_flush.pushKV("total_pause_time", flush_stats.total_pause_time * 1e-6);
+    obj.pushKV("coins_flush", coins_flush);
+
     const Consensus::Params& consensusParams = Params().GetConsensus();
     UniValue softforks(UniValue::VOBJ);
     BuriedForkDescPushBack(softforks, "bip34", consensusParams.BIP34Height);
@@ -1757,30 +1979,7 @@ static UniValue getblockstats(const JSONRPCRequest& request)
 
     LOCK(cs_main);
 
-    CBlockIndex* pindex;
-    if (request.params[0].isNum()) {
-        const int height = request.params[0].get_int();
-        const int current_tip = ::ChainActive().Height();
-        if (height < 0) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d is negative", height));
-        }
-        if (height > current_tip) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d after current tip %d", height, current_tip));
-        }
-
-        pindex = ::ChainActive()[height];
-    } else {
-        const uint256 hash(ParseHashV(request.params[0], "hash_or_height"));
-        pindex = LookupBlockIndex(hash);
-        if (!pindex) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-        }
-        if (!::ChainActive().Contains(pindex)) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Block is not in chain %s", Params().NetworkIDString()));
-        }
-    }
-
-    CHECK_NONFATAL(pindex != nullptr);
+    CBlockIndex* pindex = ParseHashOrHeight(request.params[0]);
 
     std::set<std::string> stats;
     if (!request.params[1].isNull()) {
@@ -1975,70 +2174,135 @@ static UniValue savemempool(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+/** Salted hasher for the set of scriptPubKeys a scan looks for */
+class SaltedScriptHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedScriptHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+    size_t operator()(const CScript& script) const noexcept
+    {
+        return CSipHasher(k0, k1).Write(script.data(), script.size()).Finalize();
+    }
+};
+
+using ScriptSet = std::unordered_set<CScript, SaltedScriptHasher>;
+
+/** Number of txid key ranges the UTXO set is split into for a scan */
+static constexpr unsigned int SCAN_PARTITIONS = 64;
+/** Maximum number of threads a single scan reads the UTXO set with */
+static constexpr int MAX_SCAN_THREADS = 8;
+
 //! Search for a given set of pubkey scripts
-bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>& should_abort, int64_t& count, CCoinsViewCursor* cursor, const std::set<CScript>& needles, std::map<COutPoint, Coin>& out_results) {
-    scan_progress = 0;
-    count = 0;
+bool FindScriptPubKey(const std::atomic<bool>& should_abort, std::atomic<int64_t>& count, CCoinsViewCursor* cursor, const ScriptSet& needles, std::map<COutPoint, Coin>& out_results) {
+    int64_t local_count = 0;
     while (cursor->Valid()) {
         COutPoint key;
         Coin coin;
         if (!cursor->GetKey(key) || !cursor->GetValue(coin)) return false;
-        if (++count % 8192 == 0) {
+        if (++local_count % 8192 == 0) {
+            count += 8192;
             if (should_abort) {
                 // allow to abort the scan via the abort reference
                 return false;
             }
         }
-        if (count % 256 == 0) {
-            // update progress reference every 256 item
-            uint32_t high = 0x100 * *key.hash.begin() + *(key.hash.begin() + 1);
-            scan_progress = (int)(high * 100.0 / 65536.0 + 0.5);
-        }
         if (needles.count(coin.out.scriptPubKey)) {
             out_results.emplace(key, coin);
         }
         cursor->Next();
     }
-    scan_progress = 100;
+    count += local_count % 8192;
     return true;
 }
 
-/** RAII object to prevent concurrency issue when scanning the txout set */
+/** Progress and abort flag of a scan in progress */
+struct UTXOSetScan
+{
+    std::atomic<int> progress{0};
+    std::atomic<bool> should_abort{false};
+};
+
 static std::mutex g_utxosetscan;
-static std::atomic<int> g_scan_progress;
-static std::atomic<bool> g_scan_in_progress;
-static std::atomic<bool> g_should_abort_scan;
+static std::set<UTXOSetScan*> g_utxosetscans; // guarded by g_utxosetscan
+
+/** RAII object registering a scan of the txout set, so that it can be reported on and aborted */
 class CoinsViewScanReserver
 {
 private:
-    bool m_could_reserve;
+    UTXOSetScan m_scan;
 public:
-    explicit CoinsViewScanReserver() : m_could_reserve(false) {}
+    explicit CoinsViewScanReserver()
+    {
+        std::lock_guard<std::mutex> lock(g_utxosetscan);
+        g_utxosetscans.insert(&m_scan);
+    }
 
-    bool reserve() {
-        CHECK_NONFATAL(!m_could_reserve);
+    ~CoinsViewScanReserver()
+    {
         std::lock_guard<std::mutex> lock(g_utxosetscan);
-        if (g_scan_in_progress) {
-            return false;
-        }
-        g_scan_in_progress = true;
-        m_could_reserve = true;
-        return true;
+        g_utxosetscans.erase(&m_scan);
     }
 
-    ~CoinsViewScanReserver() {
-        if (m_could_reserve) {
-            std::lock_guard<std::mutex> lock(g_utxosetscan);
-            g_scan_in_progress = false;
+    UTXOSetScan& scan() { return m_scan; }
+};
+
+/**
+ * Scan a snapshot of the coin database for the given scripts. The txid key
+ * space is split into SCAN_PARTITIONS ranges, which worker threads (including
+ * the calling one) claim one at a time.
+ */
+static bool ParallelFindScriptPubKey(UTXOSetScan& scan, int64_t& count, const CCoinsViewDB& coins_db, const std::shared_ptr<const CDBSnapshot>& snapshot, const ScriptSet& needles, std::map<COutPoint, Coin>& out_results)
+{
+    std::atomic<unsigned int> next_partition{0};
+    std::atomic<unsigned int> partitions_done{0};
+    std::atomic<int64_t> scanned{0};
+    std::atomic<bool> failed{false};
+    std::vector<std::map<COutPoint, Coin>> results(SCAN_PARTITIONS);
+
+    auto worker = [&] {
+        unsigned int partition;
+        while (!failed && (partition = next_partition++) < SCAN_PARTITIONS) {
+            try {
+                std::unique_ptr<CCoinsViewCursor> cursor(coins_db.Cursor(snapshot, partition * 256 / SCAN_PARTITIONS, (partition + 1) * 256 / SCAN_PARTITIONS));
+                if (!FindScriptPubKey(scan.should_abort, scanned, cursor.get(), needles, results[partition])) {
+                    failed = true;
+                }
+            } catch (const std::exception& e) {
+                LogPrintf("%s: %s\n", __func__, e.what());
+                failed = true;
+            }
+            scan.progress = ++partitions_done * 100 / SCAN_PARTITIONS;
         }
+    };
+
+    const int n_threads = std::max(1, std::min(GetNumCores(), MAX_SCAN_THREADS));
+    std::vector<std::thread> threads;
+    for (int i = 1; i < n_threads; ++i) {
+        threads.emplace_back(worker);
     }
-};
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    count = scanned;
+    for (auto& partition_results : results) {
+        out_results.insert(partition_results.begin(), partition_results.end());
+    }
+    return !failed;
+}
 
 UniValue scantxoutset(const JSONRPCRequest& request)
 {
             RPCHelpMan{"scantxoutset",
                 "\nEXPERIMENTAL warning: this call may be removed or changed in future releases.\n"
                 "\nScans the unspent transaction output set for entries that match certain output descriptors.\n"
+                "Several scans can run at the same time.\n"
                 "Examples of output descriptors are:\n"
                 "    addr(<address>)                      Outputs whose scriptPubKey corresponds to the specified address (does not include P2PK)\n"
                 "    raw(<hex script>)                    Outputs whose scriptPubKey equals the specified hex scripts\n"
@@ -2094,28 +2358,31 @@ UniValue scantxoutset(const JSONRPCRequest& request)
 
     UniValue result(UniValue::VOBJ);
     if (request.params[0].get_str() == "status") {
-        CoinsViewScanReserver reserver;
-        if (reserver.reserve()) {
+        std::lock_guard<std::mutex> lock(g_utxosetscan);
+        if (g_utxosetscans.empty()) {
             // no scan in progress
             return NullUniValue;
         }
-        result.pushKV("progress", g_scan_progress);
+        int progress = 100;
+        for (const UTXOSetScan* scan : g_utxosetscans) {
+            progress = std::min<int>(progress, scan->progress);
+        }
+        result.pushKV("progress", progress);
         return result;
     } else if (request.params[0].get_str() == "abort") {
-        CoinsViewScanReserver reserver;
-        if (reserver.reserve()) {
-            // reserve was possible which means no scan was running
+        std::lock_guard<std::mutex> lock(g_utxosetscan);
+        if (g_utxosetscans.empty()) {
+            // no scan was running
             return false;
         }
-        // set the abort flag
-        g_should_abort_scan = true;
+        // set the abort flags
+        for (UTXOSetScan* scan : g_utxosetscans) {
+            scan->should_abort = true;
+        }
         return true;
     } else if (request.params[0].get_str() == "start") {
         CoinsViewScanReserver reserver;
-        if (!reserver.reserve()) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Scan already in progress, use action \"abort\" or \"status\"");
-        }
-        std::set<CScript> needles;
+        ScriptSet needles;
         std::map<CScript, std::string> descriptors;
         CAmount total_in = 0;
 
@@ -2134,20 +2401,19 @@ UniValue scantxoutset(const JSONRPCRequest& request)
         UniValue unspents(UniValue::VARR);
         std::vector<CTxOut> input_txos;
         std::map<COutPoint, Coin> coins;
-        g_should_abort_scan = false;
-        g_scan_progress = 0;
         int64_t count = 0;
-        std::unique_ptr<CCoinsViewCursor> pcursor;
+        CCoinsViewDB* coins_db;
+        std::shared_ptr<const CDBSnapshot> snapshot;
         CBlockIndex* tip;
         {
             LOCK(cs_main);
             ::ChainstateActive().ForceFlushStateToDisk();
-            pcursor = std::unique_ptr<CCoinsViewCursor>(::ChainstateActive().CoinsDB().Cursor());
-            CHECK_NONFATAL(pcursor);
+            coins_db = &::ChainstateActive().CoinsDB();
+            snapshot = coins_db->GetSnapshot();
             tip = ::ChainActive().Tip();
             CHECK_NONFATAL(tip);
         }
-        bool res = FindScriptPubKey(g_scan_progress, g_should_abort_scan, count, pcursor.get(), needles, coins);
+        bool res = ParallelFindScriptPubKey(reserver.scan(), count, *coins_db, snapshot, needles, coins);
         result.pushKV("success", res);
         result.pushKV("txouts", count);
         result.pushKV("height", tip->nHeight);
@@ -2253,6 +2519,93 @@ static UniValue getblockfilter(const JSONRPCRequest& request)
     return ret;
 }
 
+/** Maximum number of entries getaddresshistory returns at once */
+static constexpr int MAX_ADDRESS_HISTORY_COUNT = 10000;
+
+UniValue getaddresshistory(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getaddresshistory",
+                "\nReturns the outputs paying to an address or scriptPubKey, and the inputs spending them, by ascending block height.\n"
+                "Requires -addrindex.\n",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address, or the hex-encoded scriptPubKey"},
+                    {"skip", RPCArg::Type::NUM, /* default */ "0", "The number of entries to skip"},
+                    {"count", RPCArg::Type::NUM, /* default */ "100", "The maximum number of entries to return (at most " + std::to_string(MAX_ADDRESS_HISTORY_COUNT) + ")"},
+                },
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"type\" : \"funding|spending\", (string) Whether an output pays to the scriptPubKey, or an input spends from it\n"
+            "    \"height\" : n,                 (numeric) The height of the block containing the transaction\n"
+            "    \"txid\" : \"hex\",             (string) The transaction id\n"
+            "    \"vout\" : n,                   (numeric) The output index (funding only)\n"
+            "    \"vin\" : n,                    (numeric) The input index (spending only)\n"
+            "    \"spent_txid\" : \"hex\",       (string) The transaction id of the output spent (spending only)\n"
+            "    \"spent_vout\" : n,             (numeric) The output index of the output spent (spending only)\n"
+            "    \"amount\" : x.xxx,             (numeric) The amount in " + CURRENCY_UNIT + " of the output\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getaddresshistory", "\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\"")
+            + HelpExampleCli("getaddresshistory", "\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\" 100 100")
+            + HelpExampleRpc("getaddresshistory", "\"1PSSGeFHDnKNxiEyFrD1wcEaHr9hrQDDWc\", 100, 100")
+                },
+            }.Check(request);
+
+    if (!g_addr_index) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is not enabled, use -addrindex");
+    }
+
+    CScript script;
+    const CTxDestination dest = DecodeDestination(request.params[0].get_str());
+    if (IsValidDestination(dest)) {
+        script = GetScriptForDestination(dest);
+    } else if (IsHex(request.params[0].get_str())) {
+        std::vector<unsigned char> data(ParseHex(request.params[0].get_str()));
+        script = CScript(data.begin(), data.end());
+    } else {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address or scriptPubKey");
+    }
+
+    const int skip = request.params[1].isNull() ? 0 : request.params[1].get_int();
+    const int count = request.params[2].isNull() ? 100 : request.params[2].get_int();
+    if (skip < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "skip must be non-negative");
+    }
+    if (count < 1 || count > MAX_ADDRESS_HISTORY_COUNT) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("count must be between 1 and %d", MAX_ADDRESS_HISTORY_COUNT));
+    }
+
+    if (!g_addr_index->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address history is still in the process of being indexed");
+    }
+
+    std::vector<AddrIndex::Entry> entries;
+    if (!g_addr_index->FindEntries(script, skip, count, entries)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read the address index");
+    }
+
+    UniValue ret(UniValue::VARR);
+    for (const AddrIndex::Entry& entry : entries) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("type", entry.spending ? "spending" : "funding");
+        obj.pushKV("height", entry.height);
+        obj.pushKV("txid", entry.txid.GetHex());
+        if (entry.spending) {
+            obj.pushKV("vin", (int64_t)entry.index);
+            obj.pushKV("spent_txid", entry.prevout.hash.GetHex());
+            obj.pushKV("spent_vout", (int64_t)entry.prevout.n);
+        } else {
+            obj.pushKV("vout", (int64_t)entry.index);
+        }
+        obj.pushKV("amount", ValueFromAmount(entry.value));
+        ret.push_back(obj);
+    }
+    return ret;
+}
+
 /**
  * Serialize the UTXO set to a file for loading elsewhere.
  *
@@ -2360,6 +2713,76 @@ UniValue dumptxoutset(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue loadtxoutset(const JSONRPCRequest& request)
+{
+    RPCHelpMan{
+        "loadtxoutset",
+        "\nLoad a UTXO snapshot written by dumptxoutset and make it the active chainstate.\n"
+        "The base block of the snapshot must be in the headers chain, and the snapshot must match\n"
+        "the UTXO set data this node has hardcoded for that height. Blocks after the base are then\n"
+        "downloaded and validated as usual.\n",
+        {
+            {"path",
+                RPCArg::Type::STR,
+                RPCArg::Optional::NO,
+                /* default_val */ "",
+                "path to the snapshot file. If relative, will be prefixed by datadir."},
+        },
+        RPCResult{
+            "{\n"
+            "  \"coins_loaded\": n,    (numeric) the number of coins loaded from the snapshot\n"
+            "  \"base_hash\": \"...\",   (string) the hash of the base of the snapshot\n"
+            "  \"base_height\": n,     (numeric) the height of the base of the snapshot\n"
+            "  \"path\": \"...\"         (string) the absolute path that the snapshot was loaded from\n"
+            "}\n"
+        },
+        RPCExamples{
+            HelpExampleCli("loadtxoutset", "utxo.dat")
+        }
+    }.Check(request);
+
+    // Neither the indexes nor the wallets can be built without the blocks
+    // below the snapshot base.
+    bool have_index = g_txindex != nullptr || g_coin_stats_index != nullptr || g_addr_index != nullptr ||
+                      g_txospender_index != nullptr;
+    ForEachBlockFilterIndex([&have_index](BlockFilterIndex&) { have_index = true; });
+    if (have_index) {
+        throw JSONRPCError(RPC_MISC_ERROR, "loadtxoutset is incompatible with -txindex, -blockfilterindex, -coinstatsindex, -addrindex and -txospenderindex");
+    }
+    CHECK_NONFATAL(g_rpc_node);
+    if (!g_rpc_node->chain_clients.empty()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "loadtxoutset requires -disablewallet");
+    }
+
+    fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    CAutoFile afile{fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION};
+    if (afile.IsNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Couldn't open file " + path.string() + " for reading.");
+    }
+
+    SnapshotMetadata metadata;
+    try {
+        afile >> metadata;
+    } catch (const std::ios_base::failure&) {
+        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Unable to read snapshot metadata from " + path.string());
+    }
+
+    std::string error;
+    if (!ActivateSnapshot(afile, metadata, error)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to load UTXO snapshot: " + error);
+    }
+
+    const CBlockIndex* base = WITH_LOCK(cs_main, return LookupBlockIndex(metadata.m_base_blockhash));
+    CHECK_NONFATAL(base);
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("coins_loaded", metadata.m_coins_count);
+    result.pushKV("base_hash", base->GetBlockHash().ToString());
+    result.pushKV("base_height", base->nHeight);
+    result.pushKV("path", path.string());
+    return result;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
@@ -2377,10 +2800,11 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    {"txid","verbose"} },
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  {"txid","verbose"} },
     { "blockchain",         "getmempoolentry",        &getmempoolentry,        {"txid"} },
+    { "blockchain",         "gettxspendingprevout",   &gettxspendingprevout,   {"outputs"} },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         {} },
     { "blockchain",         "getrawmempool",          &getrawmempool,          {"verbose"} },
     { "blockchain",         "gettxout",               &gettxout,               {"txid","n","include_mempool"} },
-    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {} },
+    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        {"hash_type", "hash_or_height"} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        {"height"} },
     { "blockchain",         "savemempool",            &savemempool,            {} },
     { "blockchain",         "verifychain",            &verifychain,            {"checklevel","nblocks"} },
@@ -2388,6 +2812,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "preciousblock",          &preciousblock,          {"blockhash"} },
     { "blockchain",         "scantxoutset",           &scantxoutset,           {"action", "scanobjects"} },
     { "blockchain",         "getblockfilter",         &getblockfilter,         {"blockhash", "filtertype"} },
+    { "blockchain",         "getaddresshistory",      &getaddresshistory,      {"address", "skip", "count"} },
 
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        {"blockhash"} },
@@ -2397,6 +2822,7 @@ static const CRPCCommand commands[] =
     { "hidden",             "waitforblockheight",     &waitforblockheight,     {"height","timeout"} },
     { "hidden",             "syncwithvalidationinterfacequeue", &syncwithvalidationinterfacequeue, {} },
     { "hidden",             "dumptxoutset",           &dumptxoutset,           {"path"} },
+    { "hidden",             "loadtxoutset",           &loadtxoutset,           {"path"} },
 };
 // clang-format on
 
@@ -123,6 +123,14 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
             "                               When a message type is not listed in this json object, the bytes received are 0.\n"
             "                               Only known message types can appear as keys in the object and all bytes received of unknown message types are listed under '"+NET_MESSAGE_COMMAND_OTHER+"'.\n"
             "       ...\n"
+            "    },\n"
+            "    \"waittime_per_msg\": {\n"
+            "       \"msg\": n,               (numeric) The total time received messages waited to be processed, in microseconds, aggregated by message type\n"
+            "       ...\n"
+            "    },\n"
+            "    \"processtime_per_msg\": {\n"
+            "       \"msg\": n,               (numeric) The total time spent processing received messages, in microseconds, aggregated by message type\n"
+            "       ...\n"
             "    }\n"
             "  }\n"
             "  ,...\n"
@@ -207,6 +215,20 @@ static UniValue getpeerinfo(const JSONRPCRequest& request)
         }
         obj.pushKV("bytesrecv_per_msg", recvPerMsgCmd);
 
+        UniValue waitPerMsgCmd(UniValue::VOBJ);
+        for (const auto& i : stats.mapRecvWaitPerMsgCmd) {
+            if (i.second > 0)
+                waitPerMsgCmd.pushKV(i.first, i.second);
+        }
+        obj.pushKV("waittime_per_msg", waitPerMsgCmd);
+
+        UniValue processPerMsgCmd(UniValue::VOBJ);
+        for (const auto& i : stats.mapRecvProcessPerMsgCmd) {
+            if (i.second > 0)
+                processPerMsgCmd.pushKV(i.first, i.second);
+        }
+        obj.pushKV("processtime_per_msg", processPerMsgCmd);
+
         ret.push_back(obj);
     }
 
@@ -394,6 +416,27 @@ static UniValue getnettotals(const JSONRPCRequest& request)
             "    \"serve_historical_blocks\": true|false,  (boolean) True if serving historical blocks\n"
             "    \"bytes_left_in_cycle\": t,               (numeric) Bytes left in current time cycle\n"
             "    \"time_left_in_cycle\": t                 (numeric) Seconds left in current time cycle\n"
+            "  },\n"
+            "  \"recvbufferpool\":\n"
+            "  {\n"
+            "    \"taken\": n,                (numeric) Number of messages received with the receive buffer pool\n"
+            "    \"reused\": n,               (numeric) Number of them received into a recycled buffer\n"
+            "    \"idle_buffers\": n,         (numeric) Number of buffers kept for reuse\n"
+            "    \"idle_bytes\": n            (numeric) Memory of the buffers kept for reuse\n"
+            "  },\n"
+            "  \"relaytxcache\":\n"
+            "  {\n"
+            "    \"hits\": n,                 (numeric) Number of relayed transactions sent already serialized\n"
+            "    \"misses\": n,               (numeric) Number of relayed transactions serialized for sending\n"
+            "    \"entries\": n,              (numeric) Number of serialized transactions cached\n"
+            "    \"bytes\": n                 (numeric) Memory of the serialized transactions cached\n"
+            "  },\n"
+            "  \"blockservecache\":\n"
+            "  {\n"
+            "    \"hits\": n,                 (numeric) Number of blocks served without reading them from disk\n"
+            "    \"misses\": n,               (numeric) Number of blocks read from disk to be served\n"
+            "    \"entries\": n,              (numeric) Number of blocks cached\n"
+            "    \"bytes\": n                 (numeric) Memory of the blocks cached\n"
             "  }\n"
             "}\n"
                 },
@@ -418,9 +461,136 @@ static UniValue getnettotals(const JSONRPCRequest& request)
     outboundLimit.pushKV("bytes_left_in_cycle", g_rpc_node->connman->GetOutboundTargetBytesLeft());
     outboundLimit.pushKV("time_left_in_cycle", g_rpc_node->connman->GetMaxOutboundTimeLeftInCycle());
     obj.pushKV("uploadtarget", outboundLimit);
+
+    const RecvBufferPool::Stats pool_stats = g_rpc_node->connman->GetRecvBufferPoolStats();
+    UniValue recvBufferPool(UniValue::VOBJ);
+    recvBufferPool.pushKV("taken", pool_stats.taken);
+    recvBufferPool.pushKV("reused", pool_stats.reused);
+    recvBufferPool.pushKV("idle_buffers", (uint64_t)pool_stats.idle_buffers);
+    recvBufferPool.pushKV("idle_bytes", (uint64_t)pool_stats.idle_bytes);
+    obj.pushKV("recvbufferpool", recvBufferPool);
+
+    const RelayTxCacheStats relay_tx_cache_stats = GetRelayTxCacheStats();
+    UniValue relayTxCache(UniValue::VOBJ);
+    relayTxCache.pushKV("hits", relay_tx_cache_stats.hits);
+    relayTxCache.pushKV("misses", relay_tx_cache_stats.misses);
+    relayTxCache.pushKV("entries", (uint64_t)relay_tx_cache_stats.entries);
+    relayTxCache.pushKV("bytes", (uint64_t)relay_tx_cache_stats.bytes);
+    obj.pushKV("relaytxcache", relayTxCache);
+
+    const BlockServeCacheStats block_serve_cache_stats = GetBlockServeCacheStats();
+    UniValue blockServeCache(UniValue::VOBJ);
+    blockServeCache.pushKV("hits", block_serve_cache_stats.hits);
+    blockServeCache.pushKV("misses", block_serve_cache_stats.misses);
+    blockServeCache.pushKV("entries", (uint64_t)block_serve_cache_stats.entries);
+    blockServeCache.pushKV("bytes", (uint64_t)block_serve_cache_stats.bytes);
+    obj.pushKV("blockservecache", blockServeCache);
     return obj;
 }
 
+static UniValue getmessagehandlerinfo(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getmessagehandlerinfo",
+                "\nReturns the utilization of the threads processing p2p messages: the message handler\n"
+                "thread, and the message worker threads enabled with -msgworkers.\n",
+                {},
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"thread\": \"name\",       (string) The thread name\n"
+            "    \"busy_time\": n,          (numeric) Time spent processing messages, in microseconds\n"
+            "    \"utilization\": n,        (numeric) Fraction of the time since the thread was started spent processing messages\n"
+            "    \"messages\": n            (numeric) Number of messages processed, only counted by message worker threads\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getmessagehandlerinfo", "")
+            + HelpExampleRpc("getmessagehandlerinfo", "")
+                },
+            }.Check(request);
+    if(!g_rpc_node->connman)
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+
+    std::vector<CConnman::MessageThreadInfo> info;
+    int64_t uptime;
+    g_rpc_node->connman->GetMessageThreadInfo(info, uptime);
+
+    UniValue ret(UniValue::VARR);
+    for (const CConnman::MessageThreadInfo& thread : info) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("thread", thread.name);
+        obj.pushKV("busy_time", thread.busy_time);
+        obj.pushKV("utilization", uptime > 0 ? std::min(1.0, (double)thread.busy_time / uptime) : 0.0);
+        obj.pushKV("messages", thread.messages);
+        ret.push_back(obj);
+    }
+    return ret;
+}
+
+static UniValue HistogramToJSON(const MessageLatencyStats::Histogram& histogram)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("total", histogram.total);
+    obj.pushKV("p50", histogram.Percentile(0.5));
+    obj.pushKV("p99", histogram.Percentile(0.99));
+    UniValue buckets(UniValue::VARR);
+    for (uint64_t count : histogram.buckets) {
+        buckets.push_back(count);
+    }
+    obj.pushKV("buckets", buckets);
+    return obj;
+}
+
+static UniValue getmessagelatencies(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getmessagelatencies",
+                "\nReturns histograms of how long received messages waited to be processed, and how long\n"
+                "they took to process, by class of peer and message type. Durations are in microseconds.\n"
+                "Bucket 0 counts durations under 1, bucket i > 0 those from 2^(i-1) to under 2^i, and the last\n"
+                "bucket all longer ones.\n",
+                {},
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"peer_class\": \"class\",   (string) inbound, outbound-full-relay, block-relay-only or manual\n"
+            "    \"msg\": \"type\",           (string) The message type, unknown types are counted as '"+NET_MESSAGE_COMMAND_OTHER+"'\n"
+            "    \"count\": n,              (numeric) The number of messages processed\n"
+            "    \"wait\": {                (json object) Time spent in the peer's process queue\n"
+            "      \"total\": n,            (numeric) The sum of the durations\n"
+            "      \"p50\": n,              (numeric) Upper bound of the bucket of the median duration\n"
+            "      \"p99\": n,              (numeric) Upper bound of the bucket of the 99th percentile duration\n"
+            "      \"buckets\": [n, ...]    (json array) The number of durations in each bucket\n"
+            "    },\n"
+            "    \"process\": {             (json object) Time spent processing, in the same format as wait\n"
+            "      ...\n"
+            "    }\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getmessagelatencies", "")
+            + HelpExampleRpc("getmessagelatencies", "")
+                },
+            }.Check(request);
+    if(!g_rpc_node->connman)
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+
+    UniValue ret(UniValue::VARR);
+    for (const MessageLatencyStats::Entry& entry : g_rpc_node->connman->GetMessageLatencyStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("peer_class", MessageLatencyStats::PeerClassName(entry.peer_class));
+        obj.pushKV("msg", entry.command);
+        obj.pushKV("count", entry.process.count);
+        obj.pushKV("wait", HistogramToJSON(entry.wait));
+        obj.pushKV("process", HistogramToJSON(entry.process));
+        ret.push_back(obj);
+    }
+    return ret;
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
@@ -743,6 +913,8 @@ static const CRPCCommand commands[] =
     { "network",            "disconnectnode",         &disconnectnode,         {"address", "nodeid"} },
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       {"node"} },
     { "network",            "getnettotals",           &getnettotals,           {} },
+    { "network",            "getmessagehandlerinfo",  &getmessagehandlerinfo,  {} },
+    { "network",            "getmessagelatencies",    &getmessagelatencies,    {} },
     { "network",            "getnetworkinfo",         &getnetworkinfo,         {} },
     { "network",            "setban",                 &setban,                 {"subnet", "command", "bantime", "absolute"} },
     { "network",            "listbanned",             &listbanned,             {} },
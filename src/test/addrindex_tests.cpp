@@ -0,0 +1,118 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addrindex.h>
+#include <rpc/server.h>
+#include <script/interpreter.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <util/memory.h>
+#include <util/time.h>
+
+#include <boost/test/unit_test.hpp>
+#include <univalue.h>
+
+BOOST_AUTO_TEST_SUITE(addrindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(addrindex_initial_sync, TestChain100Setup)
+{
+    AddrIndex addr_index(1 << 20, true);
+
+    const CScript coinbase_script = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    std::vector<AddrIndex::Entry> entries;
+
+    // Entries should not be found in the index before it is started.
+    BOOST_CHECK(addr_index.FindEntries(coinbase_script, 0, 1000, entries));
+    BOOST_CHECK(entries.empty());
+
+    // BlockUntilSyncedToCurrentChain should return false before the index is started.
+    BOOST_CHECK(!addr_index.BlockUntilSyncedToCurrentChain());
+
+    // getaddresshistory must not return a partial history while the index is syncing.
+    g_addr_index = MakeUnique<AddrIndex>(1 << 20, true);
+    JSONRPCRequest request;
+    request.strMethod = "getaddresshistory";
+    request.params = UniValue(UniValue::VARR);
+    request.params.push_back(HexStr(coinbase_script.begin(), coinbase_script.end()));
+    if (RPCIsInWarmup(nullptr)) SetRPCWarmupFinished();
+    BOOST_CHECK_EXCEPTION(tableRPC.execute(request), UniValue, [](const UniValue& error) {
+        return find_value(error, "message").get_str().find("still in the process of being indexed") != std::string::npos;
+    });
+    g_addr_index.reset();
+
+    addr_index.Start();
+
+    // Allow the index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!addr_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // Check that the index has the coinbase outputs of all blocks but genesis, by height.
+    BOOST_CHECK(addr_index.FindEntries(coinbase_script, 0, 1000, entries));
+    BOOST_REQUIRE_EQUAL(entries.size(), m_coinbase_txns.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        BOOST_CHECK(!entries[i].spending);
+        BOOST_CHECK_EQUAL(entries[i].height, (int)i + 1);
+        BOOST_CHECK(entries[i].txid == m_coinbase_txns[i]->GetHash());
+        BOOST_CHECK_EQUAL(entries[i].index, 0U);
+        BOOST_CHECK_EQUAL(entries[i].value, m_coinbase_txns[i]->vout[0].nValue);
+    }
+
+    // Check pagination.
+    BOOST_CHECK(addr_index.FindEntries(coinbase_script, 10, 5, entries));
+    BOOST_REQUIRE_EQUAL(entries.size(), 5U);
+    BOOST_CHECK_EQUAL(entries[0].height, 11);
+    BOOST_CHECK(addr_index.FindEntries(coinbase_script, 98, 5, entries));
+    BOOST_CHECK_EQUAL(entries.size(), 2U);
+
+    // Spend the first coinbase output to another script in a new block.
+    const CScript dest_script = GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()));
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(m_coinbase_txns[0]->GetHash(), 0);
+    spend.vout.resize(1);
+    spend.vout[0].nValue = 11 * CENT;
+    spend.vout[0].scriptPubKey = dest_script;
+    std::vector<unsigned char> sig;
+    const uint256 sighash = SignatureHash(coinbase_script, spend, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_REQUIRE(coinbaseKey.Sign(sighash, sig));
+    sig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << sig;
+
+    const CBlock& block = CreateAndProcessBlock({spend}, coinbase_script);
+    BOOST_CHECK(addr_index.BlockUntilSyncedToCurrentChain());
+
+    // The new block adds a funding entry from its coinbase and a spending entry.
+    BOOST_CHECK(addr_index.FindEntries(coinbase_script, m_coinbase_txns.size(), 1000, entries));
+    BOOST_REQUIRE_EQUAL(entries.size(), 2U);
+    BOOST_CHECK(!entries[0].spending);
+    BOOST_CHECK(entries[0].txid == block.vtx[0]->GetHash());
+    BOOST_CHECK(entries[1].spending);
+    BOOST_CHECK_EQUAL(entries[1].height, 101);
+    BOOST_CHECK(entries[1].txid == spend.GetHash());
+    BOOST_CHECK_EQUAL(entries[1].index, 0U);
+    BOOST_CHECK(entries[1].prevout == spend.vin[0].prevout);
+    BOOST_CHECK_EQUAL(entries[1].value, m_coinbase_txns[0]->vout[0].nValue);
+
+    BOOST_CHECK(addr_index.FindEntries(dest_script, 0, 1000, entries));
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(!entries[0].spending);
+    BOOST_CHECK_EQUAL(entries[0].height, 101);
+    BOOST_CHECK(entries[0].txid == spend.GetHash());
+    BOOST_CHECK_EQUAL(entries[0].value, 11 * CENT);
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    addr_index.Stop();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    // Rest of shutdown sequence and destructors happen in ~TestingSetup()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,132 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <banman.h>
+#include <netbase.h>
+#include <random.h>
+#include <test/util/setup_common.h>
+#include <util/system.h>
+#include <util/time.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(banman_tests, BasicTestingSetup)
+
+static CNetAddr ResolveIP(const char* ip)
+{
+    CNetAddr addr;
+    LookupHost(ip, addr, false);
+    return addr;
+}
+
+static CSubNet ResolveSubNet(const char* subnet)
+{
+    CSubNet ret;
+    LookupSubNet(subnet, ret);
+    return ret;
+}
+
+BOOST_AUTO_TEST_CASE(subnet_prefix_length)
+{
+    BOOST_CHECK_EQUAL(ResolveSubNet("1.2.3.4").GetPrefixLength(), 128);
+    BOOST_CHECK_EQUAL(ResolveSubNet("1.2.3.0/24").GetPrefixLength(), 96 + 24);
+    BOOST_CHECK_EQUAL(ResolveSubNet("1.2.0.0/255.255.0.0").GetPrefixLength(), 96 + 16);
+    BOOST_CHECK_EQUAL(ResolveSubNet("1.0.3.0/255.0.255.0").GetPrefixLength(), -1);
+    BOOST_CHECK_EQUAL(ResolveSubNet("2a01:4f8::/32").GetPrefixLength(), 32);
+    BOOST_CHECK_EQUAL(ResolveSubNet("::/0").GetPrefixLength(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ban_index)
+{
+    banmap_t banmap;
+    for (const char* subnet : {"1.2.3.4", "1.2.3.0/24", "1.2.0.0/16", "1.0.3.0/255.0.255.0", "2a01:4f8::/32", "2a01:4f8:1::/48", "2a01:4f8:1::1"}) {
+        banmap.emplace(ResolveSubNet(subnet), CBanEntry());
+    }
+    BanIndex index;
+    for (const auto& ban : banmap) {
+        index.Insert(ban);
+    }
+
+    const auto matches = [&](const char* ip) {
+        std::set<std::string> subnets;
+        for (const BanIndex::Ban* ban : index.Match(ResolveIP(ip))) {
+            subnets.insert(ban->first.ToString());
+        }
+        return subnets;
+    };
+    BOOST_CHECK(matches("1.2.3.4") == std::set<std::string>({"1.2.3.4/32", "1.2.3.0/24", "1.2.0.0/16", "1.0.3.0/255.0.255.0"}));
+    BOOST_CHECK(matches("1.2.3.5") == std::set<std::string>({"1.2.3.0/24", "1.2.0.0/16", "1.0.3.0/255.0.255.0"}));
+    BOOST_CHECK(matches("1.2.4.5") == std::set<std::string>({"1.2.0.0/16"}));
+    BOOST_CHECK(matches("1.9.3.5") == std::set<std::string>({"1.0.3.0/255.0.255.0"}));
+    BOOST_CHECK(matches("1.3.2.1").empty());
+    BOOST_CHECK(matches("2a01:4f8:1::1") == std::set<std::string>({"2a01:4f8::/32", "2a01:4f8:1::/48", "2a01:4f8:1::1/128"}));
+    BOOST_CHECK(matches("2a01:4f8:2::1") == std::set<std::string>({"2a01:4f8::/32"}));
+    BOOST_CHECK(matches("2a01:4f9::1").empty());
+    BOOST_CHECK(index.Match(CNetAddr()).empty());
+
+    index.Clear();
+    BOOST_CHECK(matches("1.2.3.4").empty());
+}
+
+BOOST_AUTO_TEST_CASE(ban_index_random)
+{
+    // Random subnets with common prefixes, checked against matching every subnet.
+    FastRandomContext rng(true);
+    const auto random_addr = [&] {
+        struct in_addr ipv4;
+        ipv4.s_addr = htonl(0x0a000000 | rng.randbits(12) << 12 | rng.randbits(12));
+        return CNetAddr(ipv4);
+    };
+    banmap_t banmap;
+    for (int i = 0; i < 1000; ++i) {
+        banmap.emplace(CSubNet(random_addr(), 8 + rng.randrange(25)), CBanEntry());
+    }
+    BanIndex index;
+    for (const auto& ban : banmap) {
+        index.Insert(ban);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        const CNetAddr addr = random_addr();
+        std::set<const BanIndex::Ban*> expected;
+        for (const auto& ban : banmap) {
+            if (ban.first.Match(addr)) expected.insert(&ban);
+        }
+        const std::vector<const BanIndex::Ban*> found = index.Match(addr);
+        BOOST_CHECK_EQUAL(found.size(), expected.size());
+        BOOST_CHECK(std::set<const BanIndex::Ban*>(found.begin(), found.end()) == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(banman_lookup)
+{
+    BanMan banman(GetDataDir() / "banlist.dat", nullptr, DEFAULT_MISBEHAVING_BANTIME);
+    banman.Ban(ResolveSubNet("1.2.3.0/24"), BanReasonNodeMisbehaving);
+    banman.Ban(ResolveSubNet("1.2.0.0/16"), BanReasonManuallyAdded, 1000);
+    banman.Ban(ResolveSubNet("5.0.6.0/255.0.255.0"), BanReasonNodeMisbehaving);
+    BOOST_CHECK(banman.IsBanned(ResolveIP("1.2.3.4")));
+    BOOST_CHECK_EQUAL(banman.IsBannedLevel(ResolveIP("1.2.3.4")), 2);
+    BOOST_CHECK_EQUAL(banman.IsBannedLevel(ResolveIP("5.1.6.1")), 1);
+    BOOST_CHECK(!banman.IsBanned(ResolveIP("1.3.3.4")));
+
+    // Unbanning the wider subnet leaves the narrower one.
+    BOOST_CHECK(banman.Unban(ResolveSubNet("1.2.0.0/16")));
+    BOOST_CHECK_EQUAL(banman.IsBannedLevel(ResolveIP("1.2.3.4")), 1);
+    BOOST_CHECK(!banman.IsBanned(ResolveIP("1.2.4.4")));
+
+    // Expired bans do not match, and are swept.
+    SetMockTime(GetTime() + DEFAULT_MISBEHAVING_BANTIME + 1);
+    BOOST_CHECK(!banman.IsBanned(ResolveIP("1.2.3.4")));
+    banmap_t banmap;
+    banman.GetBanned(banmap);
+    BOOST_CHECK(banmap.empty());
+    BOOST_CHECK(!banman.IsBanned(ResolveIP("5.1.6.1")));
+    SetMockTime(0);
+
+    banman.Ban(ResolveIP("1.2.3.4"), BanReasonNodeMisbehaving);
+    BOOST_CHECK(banman.IsBanned(ResolveIP("1.2.3.4")));
+    banman.ClearBanned();
+    BOOST_CHECK(!banman.IsBanned(ResolveIP("1.2.3.4")));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,7 @@
 #include <coins.h>
 #include <script/standard.h>
 #include <streams.h>
+#include <txdb.h>
 #include <test/util/setup_common.h>
 #include <uint256.h>
 #include <undo.h>
@@ -592,7 +593,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
     InsertCoinsMapEntry(map, value, flags);
     BOOST_CHECK(view.BatchWrite(map, {}));
 }
@@ -713,6 +715,42 @@ BOOST_AUTO_TEST_CASE(ccoins_spend)
     CheckSpendCoins(VALUE1, VALUE2, ABSENT, DIRTY|FRESH, NO_ENTRY   );
 }
 
+static void CheckWarmCoin(CAmount cache_value, CAmount warm_value, CAmount expected_value, char cache_flags, char expected_flags)
+{
+    SingleEntryCacheTest test(ABSENT, cache_value, cache_flags);
+    CTxOut output;
+    if (warm_value != PRUNED) output.nValue = warm_value;
+    test.cache.WarmCoin(OUTPOINT, Coin(std::move(output), 1, false));
+    test.cache.SelfTest();
+
+    CAmount result_value;
+    char result_flags;
+    GetCoinsMapEntry(test.cache.map(), result_value, result_flags);
+    BOOST_CHECK_EQUAL(result_value, expected_value);
+    BOOST_CHECK_EQUAL(result_flags, expected_flags);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_warm)
+{
+    /* Check WarmCoin behavior, inserting a coin read from the backing view
+     * by another thread and checking that it never replaces an existing
+     * entry or marks anything as modified.
+     *
+     *            Cache   Warm    Result  Cache        Result
+     *            Value   Value   Value   Flags        Flags
+     */
+    CheckWarmCoin(ABSENT, VALUE3, VALUE3, NO_ENTRY   , 0          );
+    CheckWarmCoin(ABSENT, PRUNED, ABSENT, NO_ENTRY   , NO_ENTRY   );
+    CheckWarmCoin(PRUNED, VALUE3, PRUNED, 0          , 0          );
+    CheckWarmCoin(PRUNED, VALUE3, PRUNED, FRESH      , FRESH      );
+    CheckWarmCoin(PRUNED, VALUE3, PRUNED, DIRTY      , DIRTY      );
+    CheckWarmCoin(PRUNED, VALUE3, PRUNED, DIRTY|FRESH, DIRTY|FRESH);
+    CheckWarmCoin(VALUE2, VALUE3, VALUE2, 0          , 0          );
+    CheckWarmCoin(VALUE2, VALUE3, VALUE2, FRESH      , FRESH      );
+    CheckWarmCoin(VALUE2, VALUE3, VALUE2, DIRTY      , DIRTY      );
+    CheckWarmCoin(VALUE2, VALUE3, VALUE2, DIRTY|FRESH, DIRTY|FRESH);
+}
+
 static void CheckAddCoinBase(CAmount base_value, CAmount cache_value, CAmount modify_value, CAmount expected_value, char cache_flags, char expected_flags, bool coinbase)
 {
     SingleEntryCacheTest test(base_value, cache_value, cache_flags);
@@ -861,4 +899,101 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_background_flush)
+{
+    CCoinsViewDB db(GetDataDir() / "background_flush", 1 << 20, /* fMemory */ true, /* fWipe */ false);
+    CCoinsViewFlushBuffer buffer(db);
+    CCoinsViewCache cache(&buffer);
+
+    const COutPoint spent_outpoint(InsecureRand256(), 0);
+    const COutPoint unspent_outpoint(InsecureRand256(), 1);
+    const uint256 first_block = InsecureRand256();
+    Coin coin(CTxOut(VALUE1, CScript() << OP_TRUE), 1, false);
+
+    // Give the database a coin that the cache spends below.
+    cache.AddCoin(spent_outpoint, Coin(coin), false);
+    cache.SetBestBlock(first_block);
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(db.HaveCoin(spent_outpoint));
+    BOOST_CHECK(!buffer.IsFlushing());
+
+    const uint256 second_block = InsecureRand256();
+    BOOST_CHECK(cache.SpendCoin(spent_outpoint));
+    cache.AddCoin(unspent_outpoint, Coin(coin), false);
+    cache.SetBestBlock(second_block);
+    const size_t cache_size = cache.GetCacheSize();
+    BOOST_CHECK(buffer.FlushInBackground(cache));
+
+    // The cache is emptied right away, and its coins remain visible through
+    // the buffer whether or not the database has been written yet.
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    BOOST_CHECK(cache.GetBestBlock() == second_block);
+    BOOST_CHECK(buffer.IsFlushing());
+    BOOST_CHECK_EQUAL(buffer.GetCacheSize(), cache_size);
+    BOOST_CHECK(buffer.GetBestBlock() == second_block);
+    BOOST_CHECK(!cache.HaveCoin(spent_outpoint));
+    BOOST_CHECK(cache.HaveCoin(unspent_outpoint));
+
+    BOOST_CHECK(buffer.WaitForFlush());
+    BOOST_CHECK(buffer.FlushDone());
+    BOOST_CHECK(!buffer.IsFlushing());
+    BOOST_CHECK_EQUAL(buffer.GetCacheSize(), 0U);
+    BOOST_CHECK(db.GetBestBlock() == second_block);
+    BOOST_CHECK(!db.HaveCoin(spent_outpoint));
+    BOOST_CHECK(db.HaveCoin(unspent_outpoint));
+
+    // A synchronous flush waits for a pending background write first.
+    const uint256 third_block = InsecureRand256();
+    BOOST_CHECK(cache.SpendCoin(unspent_outpoint));
+    cache.SetBestBlock(third_block);
+    BOOST_CHECK(buffer.FlushInBackground(cache));
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(!buffer.IsFlushing());
+    BOOST_CHECK(db.GetBestBlock() == third_block);
+    BOOST_CHECK(!db.HaveCoin(unspent_outpoint));
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_db_partitioned_cursor)
+{
+    CCoinsViewDB db(GetDataDir() / "partitioned_cursor", 1 << 20, /* fMemory */ true, /* fWipe */ false);
+    CCoinsViewCache cache(&db);
+
+    std::set<COutPoint> outpoints;
+    for (int i = 0; i < 1000; ++i) {
+        const COutPoint outpoint(InsecureRand256(), InsecureRandRange(4));
+        cache.AddCoin(outpoint, Coin(CTxOut(VALUE1, CScript() << OP_TRUE), 1, false), true);
+        outpoints.insert(outpoint);
+    }
+    cache.SetBestBlock(InsecureRand256());
+    BOOST_CHECK(cache.Flush());
+
+    // Coins written after the snapshot is taken are not seen through it.
+    std::shared_ptr<const CDBSnapshot> snapshot = db.GetSnapshot();
+    cache.AddCoin(COutPoint(InsecureRand256(), 0), Coin(CTxOut(VALUE2, CScript() << OP_TRUE), 2, false), false);
+    BOOST_CHECK(cache.SpendCoin(*outpoints.begin()));
+    cache.SetBestBlock(InsecureRand256());
+    BOOST_CHECK(cache.Flush());
+
+    // Disjoint partitions together cover every coin of the snapshot exactly once.
+    std::vector<COutPoint> seen;
+    for (unsigned int begin = 0; begin < 256; begin += 16) {
+        std::unique_ptr<CCoinsViewCursor> cursor(db.Cursor(snapshot, begin, begin + 16));
+        for (; cursor->Valid(); cursor->Next()) {
+            COutPoint outpoint;
+            Coin coin;
+            BOOST_REQUIRE(cursor->GetKey(outpoint));
+            BOOST_REQUIRE(cursor->GetValue(coin));
+            BOOST_CHECK(*outpoint.hash.begin() >= begin && *outpoint.hash.begin() < begin + 16);
+            BOOST_CHECK_EQUAL(coin.out.nValue, VALUE1);
+            seen.push_back(outpoint);
+        }
+    }
+    BOOST_CHECK_EQUAL(seen.size(), outpoints.size());
+    BOOST_CHECK(std::set<COutPoint>(seen.begin(), seen.end()) == outpoints);
+
+    // Empty ranges yield no coins.
+    BOOST_CHECK(!std::unique_ptr<CCoinsViewCursor>(db.Cursor(snapshot, 256, 256))->Valid());
+    BOOST_CHECK(!std::unique_ptr<CCoinsViewCursor>(db.Cursor(snapshot, 7, 7))->Valid());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,85 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/coinstatsindex.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(coinstatsindex_tests)
+
+static void CheckTipStats(const CoinStatsIndex& coin_stats_index)
+{
+    LOCK(cs_main);
+    const CBlockIndex* tip = ::ChainActive().Tip();
+    const RollingCoinStats& rolling = ::ChainstateActive().m_rolling_coin_stats;
+
+    CCoinsStats stats;
+    uint256 muhash;
+    BOOST_REQUIRE(coin_stats_index.LookUpStats(tip, stats, muhash));
+    BOOST_CHECK_EQUAL(stats.nHeight, tip->nHeight);
+    BOOST_CHECK(stats.hashBlock == tip->GetBlockHash());
+    BOOST_CHECK(muhash == rolling.GetHash());
+    BOOST_CHECK_EQUAL(stats.coins_count, rolling.coins_count);
+    BOOST_CHECK_EQUAL(stats.nBogoSize, rolling.bogo_size);
+    BOOST_CHECK_EQUAL(stats.nTotalAmount, rolling.total_amount);
+}
+
+BOOST_FIXTURE_TEST_CASE(coinstatsindex_initial_sync, TestChain100Setup)
+{
+    CoinStatsIndex coin_stats_index(1 << 20, true);
+
+    CCoinsStats stats;
+    uint256 muhash;
+    const CBlockIndex* tip = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+
+    // Stats should not be found in the index before it is started.
+    BOOST_CHECK(!coin_stats_index.LookUpStats(tip, stats, muhash));
+
+    // BlockUntilSyncedToCurrentChain should return false before the index is started.
+    BOOST_CHECK(!coin_stats_index.BlockUntilSyncedToCurrentChain());
+
+    coin_stats_index.Start();
+
+    // Allow the index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!coin_stats_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // The genesis block's outputs are not part of the UTXO set.
+    const CBlockIndex* genesis = WITH_LOCK(cs_main, return ::ChainActive().Genesis());
+    BOOST_REQUIRE(coin_stats_index.LookUpStats(genesis, stats, muhash));
+    BOOST_CHECK_EQUAL(stats.coins_count, 0U);
+    BOOST_CHECK(muhash == RollingCoinStats().GetHash());
+
+    CheckTipStats(coin_stats_index);
+
+    // Check that new blocks make it into the index.
+    CScript coinbase_script_pub_key = GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()));
+    std::vector<CMutableTransaction> no_txns;
+    const CBlock& block = CreateAndProcessBlock(no_txns, coinbase_script_pub_key);
+    BOOST_CHECK(coin_stats_index.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(WITH_LOCK(cs_main, return ::ChainActive().Tip()->GetBlockHash()) == block.GetHash());
+    CheckTipStats(coin_stats_index);
+
+    // Statistics of earlier blocks remain available.
+    BOOST_CHECK(coin_stats_index.LookUpStats(tip, stats, muhash));
+    BOOST_CHECK_EQUAL(stats.nHeight, tip->nHeight);
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    coin_stats_index.Stop();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    // Rest of shutdown sequence and destructors happen in ~TestingSetup()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -9,11 +9,13 @@
 #include <crypto/hkdf_sha256_32.h>
 #include <crypto/hmac_sha256.h>
 #include <crypto/hmac_sha512.h>
+#include <crypto/muhash.h>
 #include <crypto/ripemd160.h>
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
 #include <crypto/sha512.h>
 #include <random.h>
+#include <streams.h>
 #include <util/strencodings.h>
 #include <test/util/setup_common.h>
 
@@ -750,4 +752,82 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+static MuHash3072 FromInt(unsigned char i) {
+    unsigned char tmp[32] = {i, 0};
+    return MuHash3072(tmp, sizeof(tmp));
+}
+
+static uint256 Finalized(const MuHash3072& acc) {
+    uint256 out;
+    acc.Finalize(out);
+    return out;
+}
+
+BOOST_AUTO_TEST_CASE(muhash_tests)
+{
+    // The same elements inserted and removed in any order give the same hash.
+    for (int iter = 0; iter < 10; ++iter) {
+        uint256 res;
+        int table[4];
+        for (int i = 0; i < 4; ++i) {
+            table[i] = InsecureRandBits(3);
+        }
+        for (int order = 0; order < 4; ++order) {
+            MuHash3072 acc;
+            for (int i = 0; i < 4; ++i) {
+                int t = table[i ^ order];
+                if (t & 4) {
+                    acc /= FromInt(t & 3);
+                } else {
+                    acc *= FromInt(t & 3);
+                }
+            }
+            uint256 out = Finalized(acc);
+            if (order == 0) {
+                res = out;
+            } else {
+                BOOST_CHECK(res == out);
+            }
+        }
+    }
+
+    // The empty set hashes to SHA256 of the number one.
+    unsigned char one[Num3072::BYTE_SIZE] = {1};
+    uint256 empty;
+    CSHA256().Write(one, sizeof(one)).Finalize(empty.begin());
+    BOOST_CHECK(Finalized(MuHash3072()) == empty);
+
+    MuHash3072 x = FromInt(InsecureRandBits(4));
+    MuHash3072 y = FromInt(InsecureRandBits(4));
+    MuHash3072 z;
+    z *= x;
+    z *= y;
+    BOOST_CHECK(Finalized(z) != empty);
+    z /= x;
+    z /= y;
+    BOOST_CHECK(Finalized(z) == empty);
+
+    // Insert() and Remove() are multiplication and division by a singleton.
+    unsigned char data[32] = {7};
+    MuHash3072 inserted;
+    inserted.Insert(data, sizeof(data));
+    BOOST_CHECK(Finalized(inserted) == Finalized(MuHash3072(data, sizeof(data))));
+    inserted.Insert(data, sizeof(data)).Remove(data, sizeof(data));
+    BOOST_CHECK(Finalized(inserted) == Finalized(MuHash3072(data, sizeof(data))));
+    inserted.Remove(data, sizeof(data));
+    BOOST_CHECK(Finalized(inserted) == empty);
+
+    // The state, numerator and denominator, survives serialization.
+    MuHash3072 acc = FromInt(1);
+    acc /= FromInt(2);
+    CDataStream ss(SER_DISK, 0);
+    ss << acc;
+    BOOST_CHECK_EQUAL(ss.size(), 2 * Num3072::BYTE_SIZE);
+    MuHash3072 acc2;
+    ss >> acc2;
+    BOOST_CHECK(Finalized(acc) == Finalized(acc2));
+    acc2 *= FromInt(2);
+    BOOST_CHECK(Finalized(acc2) == Finalized(FromInt(1)));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
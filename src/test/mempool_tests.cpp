@@ -10,6 +10,7 @@
 #include <test/util/setup_common.h>
 
 #include <boost/test/unit_test.hpp>
+#include <algorithm>
 #include <vector>
 
 BOOST_FIXTURE_TEST_SUITE(mempool_tests, TestingSetup)
@@ -788,4 +789,180 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTests)
     BOOST_CHECK_EQUAL(descendants, 4ULL);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolEpochTraversalTest)
+{
+    // A lattice of transactions two wide, where each transaction spends both
+    // transactions of the layer above, so every ancestor and descendant is
+    // reachable along many paths but must be counted once.
+    //
+    // [a0] [b0]
+    //  |  X  |
+    // [a1] [b1]
+    //   ...
+    constexpr size_t DEPTH = 20;
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+    std::vector<std::vector<CTransactionRef>> layers;
+    for (size_t depth = 0; depth < DEPTH; ++depth) {
+        std::vector<CTransactionRef> layer;
+        for (size_t i = 0; i < 2; ++i) {
+            CTransactionRef tx = depth == 0 ?
+                make_tx(/* output_values */ {10 * COIN, 10 * COIN + (CAmount)i}) :
+                make_tx(/* output_values */ {COIN, COIN}, /* inputs */ {layers.back()[0], layers.back()[1]}, /* input_indices */ {(uint32_t)i, (uint32_t)i});
+            pool.addUnchecked(entry.Fee(1000LL).FromTx(tx));
+            layer.push_back(tx);
+        }
+        layers.push_back(layer);
+    }
+
+    const auto top = pool.mapTx.find(layers.front()[0]->GetHash());
+    const auto bottom = pool.mapTx.find(layers.back()[0]->GetHash());
+    BOOST_CHECK_EQUAL(top->GetCountWithDescendants(), 2 * DEPTH - 1);
+    BOOST_CHECK_EQUAL(bottom->GetCountWithAncestors(), 2 * DEPTH - 1);
+
+    CTxMemPool::setEntries ancestors;
+    std::string dummy;
+    BOOST_CHECK(pool.CalculateMemPoolAncestors(*bottom, ancestors, 1000, 1000000, 1000, 1000000, dummy, false));
+    BOOST_CHECK_EQUAL(ancestors.size(), 2 * DEPTH - 2);
+    // The limit counts distinct ancestors, plus the transaction itself.
+    ancestors.clear();
+    BOOST_CHECK(pool.CalculateMemPoolAncestors(*bottom, ancestors, 2 * DEPTH - 1, 1000000, 1000, 1000000, dummy, false));
+    ancestors.clear();
+    BOOST_CHECK(!pool.CalculateMemPoolAncestors(*bottom, ancestors, 2 * DEPTH - 2, 1000000, 1000, 1000000, dummy, false));
+
+    CTxMemPool::setEntries descendants;
+    pool.CalculateDescendants(top, descendants);
+    BOOST_CHECK_EQUAL(descendants.size(), 2 * DEPTH - 1);
+    // Entries already in the set are not walked again.
+    descendants.clear();
+    descendants.insert(pool.mapTx.find(layers[1][0]->GetHash()));
+    descendants.insert(pool.mapTx.find(layers[1][1]->GetHash()));
+    pool.CalculateDescendants(top, descendants);
+    BOOST_CHECK_EQUAL(descendants.size(), 3U);
+
+    // Mine the top layer, then re-add it as in a reorg, which walks the
+    // descendants of the re-added transactions to restore their state.
+    std::vector<CTransactionRef> block(layers.front().begin(), layers.front().end());
+    pool.removeForBlock(block, 1);
+    BOOST_CHECK_EQUAL(pool.size(), 2 * DEPTH - 2);
+    std::vector<uint256> reorged;
+    for (const CTransactionRef& tx : block) {
+        pool.addUnchecked(entry.Fee(1000LL).FromTx(tx));
+        reorged.push_back(tx->GetHash());
+    }
+    pool.UpdateTransactionsFromBlock(reorged);
+    BOOST_CHECK_EQUAL(pool.mapTx.find(layers.front()[1]->GetHash())->GetCountWithDescendants(), 2 * DEPTH - 1);
+    BOOST_CHECK_EQUAL(pool.mapTx.find(layers.back()[1]->GetHash())->GetCountWithAncestors(), 2 * DEPTH - 1);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolLinksTest)
+{
+    // One parent with several children, and a grandchild spending all of
+    // them. Links are stored on the entries themselves, sorted by txid.
+    constexpr size_t CHILDREN = 8;
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+    CTransactionRef parent = make_tx(/* output_values */ std::vector<CAmount>(CHILDREN, COIN));
+    pool.addUnchecked(entry.Fee(1000LL).FromTx(parent));
+    std::vector<CTransactionRef> children;
+    std::vector<uint32_t> indices;
+    for (size_t i = 0; i < CHILDREN; ++i) {
+        children.push_back(make_tx(/* output_values */ {COIN - 1000}, /* inputs */ {parent}, /* input_indices */ {(uint32_t)i}));
+        pool.addUnchecked(entry.Fee(1000LL).FromTx(children.back()));
+        indices.push_back(0);
+    }
+    CTransactionRef grandchild = make_tx(/* output_values */ {COIN}, std::vector<CTransactionRef>(children), std::move(indices));
+    pool.addUnchecked(entry.Fee(1000LL).FromTx(grandchild));
+
+    const auto is_sorted = [](const CTxMemPool::LinkedEntries& links) {
+        return std::is_sorted(links.begin(), links.end(), CTxMemPool::CompareIteratorByHash());
+    };
+    const auto parent_it = pool.mapTx.find(parent->GetHash());
+    const auto grandchild_it = pool.mapTx.find(grandchild->GetHash());
+    BOOST_CHECK(pool.GetMemPoolParents(parent_it).empty());
+    BOOST_CHECK_EQUAL(pool.GetMemPoolChildren(parent_it).size(), CHILDREN);
+    BOOST_CHECK(is_sorted(pool.GetMemPoolChildren(parent_it)));
+    BOOST_CHECK_EQUAL(pool.GetMemPoolParents(grandchild_it).size(), CHILDREN);
+    BOOST_CHECK(is_sorted(pool.GetMemPoolParents(grandchild_it)));
+    BOOST_CHECK(pool.GetMemPoolChildren(grandchild_it).empty());
+    for (const CTransactionRef& child : children) {
+        const auto child_it = pool.mapTx.find(child->GetHash());
+        BOOST_CHECK(*pool.GetMemPoolParents(child_it).begin() == parent_it);
+        BOOST_CHECK(*pool.GetMemPoolChildren(child_it).begin() == grandchild_it);
+    }
+
+    // Removing the children unlinks them from both sides and releases the
+    // link storage of the parent.
+    for (const CTransactionRef& child : children) {
+        pool.removeRecursive(*child, REMOVAL_REASON_DUMMY);
+    }
+    BOOST_CHECK_EQUAL(pool.size(), 1U);
+    BOOST_CHECK(pool.GetMemPoolChildren(parent_it).empty());
+    BOOST_CHECK_EQUAL(parent_it->m_children.capacity(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolSnapshotTest)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    // A parent signalling BIP125 and a child that does not, which is
+    // replaceable through its parent, next to an unrelated transaction.
+    CMutableTransaction parent_mtx;
+    parent_mtx.vin.resize(1);
+    parent_mtx.vin[0].nSequence = 0;
+    parent_mtx.vout.resize(1);
+    parent_mtx.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    parent_mtx.vout[0].nValue = 10 * COIN;
+    CTransactionRef parent = MakeTransactionRef(parent_mtx);
+    CTransactionRef child = make_tx(/* output_values */ {COIN}, /* inputs */ {parent});
+    CTransactionRef other = make_tx(/* output_values */ {2 * COIN});
+    pool.addUnchecked(entry.Fee(1000LL).FromTx(child));
+    pool.addUnchecked(entry.Fee(1000LL).FromTx(other));
+    pool.addUnchecked(entry.Fee(1000LL).FromTx(parent));
+    pool.UpdateTransactionsFromBlock({parent->GetHash()});
+
+    const std::shared_ptr<const MemPoolSnapshot> snapshot = pool.GetSnapshot();
+    BOOST_CHECK_EQUAL(snapshot->entries.size(), 3U);
+    // Readers share the snapshot until the mempool changes.
+    BOOST_CHECK(pool.GetSnapshot() == snapshot);
+
+    const MemPoolSnapshot::Entry* parent_entry = snapshot->Find(parent->GetHash());
+    const MemPoolSnapshot::Entry* child_entry = snapshot->Find(child->GetHash());
+    const MemPoolSnapshot::Entry* other_entry = snapshot->Find(other->GetHash());
+    BOOST_REQUIRE(parent_entry && child_entry && other_entry);
+    BOOST_CHECK(snapshot->Find(uint256S("01")) == nullptr);
+    BOOST_CHECK(parent_entry < child_entry);
+    BOOST_CHECK(parent_entry->spentby == std::vector<uint256>{child->GetHash()});
+    BOOST_CHECK(child_entry->depends == std::vector<uint256>{parent->GetHash()});
+    BOOST_CHECK_EQUAL(child_entry->count_with_ancestors, 2U);
+    BOOST_CHECK(parent_entry->bip125_replaceable);
+    BOOST_CHECK(child_entry->bip125_replaceable);
+    BOOST_CHECK(!other_entry->bip125_replaceable);
+
+    // A change publishes a new snapshot, while the old one stays intact for
+    // the readers still holding it.
+    pool.PrioritiseTransaction(other->GetHash(), 5000);
+    const std::shared_ptr<const MemPoolSnapshot> prioritised = pool.GetSnapshot();
+    BOOST_CHECK(prioritised != snapshot);
+    BOOST_CHECK_EQUAL(prioritised->Find(other->GetHash())->modified_fee, 6000);
+    BOOST_CHECK_EQUAL(other_entry->modified_fee, 1000);
+
+    pool.removeRecursive(*parent, REMOVAL_REASON_DUMMY);
+    const std::shared_ptr<const MemPoolSnapshot> removed = pool.GetSnapshot();
+    BOOST_CHECK_EQUAL(removed->entries.size(), 1U);
+    BOOST_CHECK_EQUAL(snapshot->entries.size(), 3U);
+    BOOST_CHECK_EQUAL(prioritised->entries.size(), 3U);
+
+    // The mempool does not keep a snapshot, and the transactions in it,
+    // alive once no reader holds it.
+    pool.PrioritiseTransaction(other->GetHash(), 5000);
+    std::weak_ptr<const MemPoolSnapshot> released = pool.GetSnapshot();
+    BOOST_CHECK(released.expired());
+    BOOST_CHECK_EQUAL(pool.GetSnapshot()->Find(other->GetHash())->modified_fee, 11000);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
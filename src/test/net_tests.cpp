@@ -12,12 +12,17 @@
 #include <streams.h>
 #include <net.h>
 #include <netbase.h>
+#include <netmessagemaker.h>
 #include <chainparams.h>
 #include <util/memory.h>
 #include <util/system.h>
 
 #include <memory>
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 class CAddrManSerializationMock : public CAddrMan
 {
 public:
@@ -76,6 +81,27 @@ static CDataStream AddrmanToStream(CAddrManSerializationMock& _addrman)
     return CDataStream(vchData, SER_DISK, CLIENT_VERSION);
 }
 
+#ifdef USE_EPOLL
+struct ConnmanTestMsg : public CConnman {
+    using CConnman::CConnman;
+    using CConnman::AddSocketEvents;
+    using CConnman::SocketHandler;
+    using CConnman::m_epoll_fd;
+    using CConnman::m_socket_work_pending;
+
+    void AddNode(CNode& node)
+    {
+        LOCK(cs_vNodes);
+        vNodes.push_back(&node);
+    }
+    void ClearNodes()
+    {
+        LOCK(cs_vNodes);
+        vNodes.clear();
+    }
+};
+#endif // USE_EPOLL
+
 BOOST_FIXTURE_TEST_SUITE(net_tests, BasicTestingSetup)
 
 BOOST_AUTO_TEST_CASE(cnode_listen_port)
@@ -316,4 +342,220 @@ BOOST_AUTO_TEST_CASE(PoissonNextSend)
     g_mock_deterministic_tests = false;
 }
 
+BOOST_AUTO_TEST_CASE(recv_buffer_pool)
+{
+    auto pool = std::make_shared<RecvBufferPool>(200 * 1024);
+    CDataStream stream(SER_NETWORK, INIT_PROTO_VERSION);
+
+    // Small messages are not pooled, and nothing is taken from an empty pool.
+    BOOST_CHECK(!RecvBufferPool::IsPooled(100));
+    BOOST_CHECK(RecvBufferPool::IsPooled(10000));
+    BOOST_CHECK_EQUAL(pool->Take(10000, stream), 0U);
+
+    // A medium buffer given back is grown to its class size, and reused for any medium message.
+    stream.resize(10000);
+    pool->Give(std::move(stream));
+    RecvBufferPool::Stats stats = pool->GetStats();
+    BOOST_CHECK_EQUAL(stats.idle_buffers, 1U);
+    BOOST_CHECK(stats.idle_bytes >= 64 * 1024);
+    CDataStream reused(SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK(pool->Take(60000, reused) >= 64 * 1024);
+    BOOST_CHECK(reused.empty());
+    BOOST_CHECK_EQUAL(reused.GetVersion(), PROTOCOL_VERSION);
+    stats = pool->GetStats();
+    BOOST_CHECK_EQUAL(stats.taken, 2U);
+    BOOST_CHECK_EQUAL(stats.reused, 1U);
+    BOOST_CHECK_EQUAL(stats.idle_buffers, 0U);
+    BOOST_CHECK_EQUAL(stats.idle_bytes, 0U);
+
+    // A large buffer is only reused for messages that fit in it.
+    CDataStream large(SER_NETWORK, INIT_PROTO_VERSION);
+    large.resize(100000);
+    pool->Give(std::move(large));
+    BOOST_CHECK_EQUAL(pool->Take(150000, stream), 0U);
+    BOOST_CHECK(pool->Take(90000, stream) >= 100000);
+
+    // Buffers beyond the idle memory limit are freed.
+    CDataStream too_large(SER_NETWORK, INIT_PROTO_VERSION);
+    too_large.resize(300 * 1024);
+    pool->Give(std::move(too_large));
+    BOOST_CHECK_EQUAL(pool->GetStats().idle_buffers, 0U);
+
+    // A peer takes no more pooled memory than its limit, until it gives buffers back.
+    for (int i = 0; i < 2; ++i) {
+        CDataStream buffer(SER_NETWORK, INIT_PROTO_VERSION);
+        buffer.resize(1000);
+        pool->Give(std::move(buffer));
+    }
+    RecvBufferAccount account(pool, 65 * 1024);
+    CDataStream first(SER_NETWORK, INIT_PROTO_VERSION), second(SER_NETWORK, INIT_PROTO_VERSION);
+    const size_t charged = account.Take(2000, first);
+    BOOST_CHECK(charged >= 64 * 1024);
+    BOOST_CHECK_EQUAL(account.Take(2000, second), 0U);
+    account.Give(std::move(first), charged);
+    BOOST_CHECK(account.Take(2000, second) >= 64 * 1024);
+}
+
+BOOST_AUTO_TEST_CASE(recv_buffer_pool_deserializer)
+{
+    auto pool = std::make_shared<RecvBufferPool>();
+    V1TransportDeserializer deserializer(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION, std::make_shared<RecvBufferAccount>(pool, MAX_RECV_POOL_PEER_BYTES));
+
+    const std::vector<unsigned char> payload(5000, 0x42);
+    CMessageHeader hdr(Params().MessageStart(), NetMsgType::TX, payload.size());
+    const uint256 hash = Hash(payload.begin(), payload.end());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CDataStream wire(SER_NETWORK, INIT_PROTO_VERSION);
+    wire << hdr;
+    wire.write((const char*)payload.data(), payload.size());
+
+    for (int i = 0; i < 3; ++i) {
+        BOOST_CHECK_EQUAL(deserializer.Read(wire.data(), CMessageHeader::HEADER_SIZE), (int)CMessageHeader::HEADER_SIZE);
+        BOOST_CHECK_EQUAL(deserializer.Read(wire.data() + CMessageHeader::HEADER_SIZE, payload.size()), (int)payload.size());
+        BOOST_REQUIRE(deserializer.Complete());
+        CNetMessage msg = deserializer.GetMessage(Params().MessageStart(), 0);
+        BOOST_CHECK(msg.m_valid_checksum);
+        BOOST_CHECK(std::equal(msg.m_recv.begin(), msg.m_recv.end(), payload.begin()));
+    }
+
+    // The buffer of the first message is reused by the next ones.
+    const RecvBufferPool::Stats stats = pool->GetStats();
+    BOOST_CHECK_EQUAL(stats.taken, 3U);
+    BOOST_CHECK_EQUAL(stats.reused, 2U);
+    BOOST_CHECK_EQUAL(stats.idle_buffers, 1U);
+}
+
+#ifndef WIN32
+/** Read exactly the given number of bytes sent to a peer from the other end of its socket. */
+static std::vector<unsigned char> ReadSent(SOCKET socket, size_t size)
+{
+    std::vector<unsigned char> data(size);
+    size_t read = 0;
+    while (read < size) {
+        ssize_t n = recv(socket, data.data() + read, size - read, 0);
+        BOOST_REQUIRE(n > 0);
+        read += n;
+    }
+    return data;
+}
+
+BOOST_AUTO_TEST_CASE(PushMessage_shared_payload)
+{
+    auto connman = MakeUnique<CConnman>(0x1337, 0x1337);
+    CConnman::Options options;
+    options.nSendBufferMaxSize = 1000 * DEFAULT_MAXSENDBUFFER;
+    connman->Init(options);
+
+    int fds_a[2], fds_b[2];
+    BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds_a) == 0);
+    BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds_b) == 0);
+    CNode node_a(0, NODE_NETWORK, 0, fds_a[0], CAddress(), 0, 0, CAddress(), "", false);
+    CNode node_b(1, NODE_NETWORK, 0, fds_b[0], CAddress(), 0, 0, CAddress(), "", false);
+
+    const CNetMsgMaker msg_maker(INIT_PROTO_VERSION);
+    const std::vector<unsigned char> payload(1000, 0x42);
+
+    // A shared message is sent to each peer as the message serialized for one peer would be.
+    const CSharedNetMsg msg(msg_maker.Make(NetMsgType::TX, payload));
+    connman->PushMessage(&node_a, msg);
+    connman->PushMessage(&node_b, msg);
+    connman->PushMessage(&node_a, msg_maker.Make(NetMsgType::TX, payload));
+    const size_t msg_size = CMessageHeader::HEADER_SIZE + msg.data->size();
+    const std::vector<unsigned char> sent = ReadSent(fds_a[1], msg_size);
+    BOOST_CHECK(ReadSent(fds_a[1], msg_size) == sent);
+    BOOST_CHECK(ReadSent(fds_b[1], msg_size) == sent);
+    BOOST_CHECK(std::equal(msg.data->begin(), msg.data->end(), sent.begin() + CMessageHeader::HEADER_SIZE));
+
+    // A payload too large to be sent right away is queued to both peers without being copied.
+    const CSharedNetMsg large_msg(msg_maker.Make(NetMsgType::BLOCK, std::vector<unsigned char>(MAX_PROTOCOL_MESSAGE_LENGTH - 100)));
+    connman->PushMessage(&node_a, large_msg);
+    connman->PushMessage(&node_b, large_msg);
+    {
+        LOCK2(node_a.cs_vSend, node_b.cs_vSend);
+        BOOST_REQUIRE(!node_a.vSendMsg.empty() && !node_b.vSendMsg.empty());
+        BOOST_CHECK(node_a.vSendMsg.back() == large_msg.data);
+        BOOST_CHECK(node_b.vSendMsg.back() == large_msg.data);
+        BOOST_CHECK(node_a.fPauseSend);
+    }
+
+    close(fds_a[1]);
+    close(fds_b[1]);
+}
+#endif // WIN32
+
+#ifdef USE_EPOLL
+BOOST_AUTO_TEST_CASE(socket_handler_waits_for_stalled_peer)
+{
+    ConnmanTestMsg connman(0x1337, 0x1337);
+    connman.Init(CConnman::Options{});
+    connman.m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    BOOST_REQUIRE(connman.m_epoll_fd != -1);
+
+    int fds[2];
+    BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    BOOST_REQUIRE(SetSocketNonBlocking(fds[0], true));
+    CNode node(0, NODE_NETWORK, 0, fds[0], CAddress(), 0, 0, CAddress(), "", false);
+    connman.AddSocketEvents(fds[0]);
+    connman.AddNode(node);
+
+    // The peer sends us something, but reads nothing of a message too large
+    // for the socket buffer, so receiving is held off until it does.
+    BOOST_REQUIRE(write(fds[1], "x", 1) == 1);
+    const CNetMsgMaker msg_maker(INIT_PROTO_VERSION);
+    connman.PushMessage(&node, msg_maker.Make(NetMsgType::BLOCK, std::vector<unsigned char>(MAX_PROTOCOL_MESSAGE_LENGTH - 100)));
+    BOOST_REQUIRE(WITH_LOCK(node.cs_vSend, return !node.vSendMsg.empty()));
+
+    // Neither receiving nor sending can make progress, so the socket handler
+    // must wait for the next event rather than come straight back.
+    connman.SocketHandler();
+    BOOST_CHECK(!connman.m_socket_work_pending);
+    const int64_t start = GetTimeMillis();
+    connman.SocketHandler();
+    BOOST_CHECK_GE(GetTimeMillis() - start, 40);
+
+    connman.ClearNodes();
+    close(fds[1]);
+}
+#endif // USE_EPOLL
+
+BOOST_AUTO_TEST_CASE(message_latency_stats)
+{
+    MessageLatencyStats stats;
+    BOOST_CHECK(stats.GetStats().empty());
+
+    // 0us falls in bucket 0, 1us in bucket 1, [2, 4) us in bucket 2 and so on.
+    stats.Record(MessageLatencyStats::INBOUND, NetMsgType::PING, 0, 1);
+    stats.Record(MessageLatencyStats::INBOUND, NetMsgType::PING, 3, 2);
+    stats.Record(MessageLatencyStats::INBOUND, NetMsgType::PING, -5, 1000);
+    stats.Record(MessageLatencyStats::INBOUND, NetMsgType::PING, 0, std::numeric_limits<int64_t>::max() / 2);
+    stats.Record(MessageLatencyStats::MANUAL, "unknown", 7, 7);
+
+    std::vector<MessageLatencyStats::Entry> entries = stats.GetStats();
+    BOOST_REQUIRE_EQUAL(entries.size(), 2U);
+
+    const MessageLatencyStats::Entry& ping = entries[0];
+    BOOST_CHECK_EQUAL(ping.peer_class, MessageLatencyStats::INBOUND);
+    BOOST_CHECK_EQUAL(ping.command, NetMsgType::PING);
+    BOOST_CHECK_EQUAL(ping.wait.count, 4U);
+    BOOST_CHECK_EQUAL(ping.wait.total, 3);
+    BOOST_CHECK_EQUAL(ping.wait.buckets[0], 3U);
+    BOOST_CHECK_EQUAL(ping.wait.buckets[2], 1U);
+    BOOST_CHECK_EQUAL(ping.wait.Percentile(0.5), 1);
+    BOOST_CHECK_EQUAL(ping.wait.Percentile(0.99), 4);
+    BOOST_CHECK_EQUAL(ping.process.buckets[1], 1U);
+    BOOST_CHECK_EQUAL(ping.process.buckets[2], 1U);
+    BOOST_CHECK_EQUAL(ping.process.buckets[10], 1U);
+    BOOST_CHECK_EQUAL(ping.process.buckets[MessageLatencyStats::NUM_BUCKETS - 1], 1U);
+    BOOST_CHECK_EQUAL(ping.process.Percentile(0.5), 4);
+    BOOST_CHECK_EQUAL(ping.process.Percentile(1), int64_t{1} << (MessageLatencyStats::NUM_BUCKETS - 1));
+
+    const MessageLatencyStats::Entry& other = entries[1];
+    BOOST_CHECK_EQUAL(other.peer_class, MessageLatencyStats::MANUAL);
+    BOOST_CHECK_EQUAL(other.command, NET_MESSAGE_COMMAND_OTHER);
+    BOOST_CHECK_EQUAL(other.process.total, 7);
+    BOOST_CHECK_EQUAL(other.process.buckets[3], 1U);
+
+    BOOST_CHECK_EQUAL(MessageLatencyStats::Histogram().Percentile(0.5), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
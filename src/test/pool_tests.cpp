@@ -0,0 +1,95 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <memusage.h>
+#include <support/allocators/pool.h>
+#include <test/util/setup_common.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(basic_allocating)
+{
+    PoolResource<8, 8> resource;
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // first chunk is already allocated
+    void* block = resource.Allocate(8, 8);
+    BOOST_CHECK(block != nullptr);
+
+    // a deallocated block is handed out again for the same size
+    resource.Deallocate(block, 8, 8);
+    void* b = resource.Allocate(8, 8);
+    BOOST_CHECK_EQUAL(b, block);
+    resource.Deallocate(b, 8, 8);
+
+    // zero-sized allocations use the smallest freelist
+    void* zero = resource.Allocate(0, 1);
+    BOOST_CHECK_EQUAL(zero, block);
+    resource.Deallocate(zero, 0, 1);
+
+    // blocks larger than MAX_BLOCK_SIZE_BYTES are served by operator new
+    void* large = resource.Allocate(16, 8);
+    BOOST_CHECK(large != nullptr);
+    resource.Deallocate(large, 16, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(allocate_any_byte)
+{
+    PoolResource<128, 8> resource(1024);
+
+    // allocate every size from 1 to 128 bytes, and check that the memory is
+    // usable and does not overlap
+    std::vector<std::pair<uint8_t*, size_t>> blocks;
+    for (size_t num_bytes = 1; num_bytes <= 128; ++num_bytes) {
+        uint8_t* p = static_cast<uint8_t*>(resource.Allocate(num_bytes, 1));
+        for (size_t i = 0; i < num_bytes; ++i) {
+            p[i] = static_cast<uint8_t>(num_bytes);
+        }
+        blocks.emplace_back(p, num_bytes);
+    }
+    for (const auto& block : blocks) {
+        for (size_t i = 0; i < block.second; ++i) {
+            BOOST_CHECK_EQUAL(block.first[i], static_cast<uint8_t>(block.second));
+        }
+        resource.Deallocate(block.first, block.second, 1);
+    }
+
+    // 128 blocks of up to 128 bytes do not fit into a 1024 byte chunk
+    BOOST_CHECK(resource.NumAllocatedChunks() > 1);
+    BOOST_CHECK_EQUAL(resource.ChunkSizeBytes(), 1024U);
+}
+
+BOOST_AUTO_TEST_CASE(memusage_test)
+{
+    typedef std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, PoolAllocator<std::pair<const int, int>, sizeof(std::pair<const int, int>) + sizeof(void*) * 4, alignof(void*)>> Map;
+    Map::allocator_type::ResourceType resource(1024);
+    Map map{0, Map::hasher{}, Map::key_equal{}, &resource};
+
+    size_t max_usage = memusage::DynamicUsage(map);
+    for (int i = 0; i < 1000; ++i) {
+        map[i] = i;
+        BOOST_CHECK_EQUAL(map.at(i), i);
+        max_usage = std::max(max_usage, memusage::DynamicUsage(map));
+    }
+    BOOST_CHECK(resource.NumAllocatedChunks() > 1);
+    BOOST_CHECK(max_usage >= resource.NumAllocatedChunks() * resource.ChunkSizeBytes());
+
+    // memory stays with the resource after erasing, and is reused by new nodes
+    const size_t chunks = resource.NumAllocatedChunks();
+    map.clear();
+    for (int i = 0; i < 1000; ++i) {
+        map[i] = i;
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), chunks);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
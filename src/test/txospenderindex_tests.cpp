@@ -0,0 +1,103 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/txospenderindex.h>
+#include <rpc/server.h>
+#include <script/interpreter.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <util/memory.h>
+#include <util/time.h>
+
+#include <boost/test/unit_test.hpp>
+#include <univalue.h>
+
+BOOST_AUTO_TEST_SUITE(txospenderindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(txospenderindex_initial_sync, TestChain100Setup)
+{
+    TxoSpenderIndex txospender_index(1 << 20, true);
+
+    const CScript coinbase_script = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    // Spend the first coinbase outputs as they mature, starting before the index is started.
+    std::vector<CMutableTransaction> spends(3);
+    for (size_t i = 0; i < spends.size(); ++i) {
+        spends[i].nVersion = 1;
+        spends[i].vin.resize(1);
+        spends[i].vin[0].prevout = COutPoint(m_coinbase_txns[i]->GetHash(), 0);
+        spends[i].vout.resize(1);
+        spends[i].vout[0].nValue = 11 * CENT;
+        spends[i].vout[0].scriptPubKey = coinbase_script;
+        std::vector<unsigned char> sig;
+        const uint256 sighash = SignatureHash(coinbase_script, spends[i], 0, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_REQUIRE(coinbaseKey.Sign(sighash, sig));
+        sig.push_back((unsigned char)SIGHASH_ALL);
+        spends[i].vin[0].scriptSig << sig;
+    }
+    CreateAndProcessBlock({spends[0]}, coinbase_script);
+    CreateAndProcessBlock({spends[1]}, coinbase_script);
+
+    uint256 txid;
+    int height;
+
+    // Spenders should not be found in the index before it is started.
+    BOOST_CHECK(!txospender_index.FindSpender(spends[0].vin[0].prevout, txid, height));
+
+    // BlockUntilSyncedToCurrentChain should return false before the index is started.
+    BOOST_CHECK(!txospender_index.BlockUntilSyncedToCurrentChain());
+
+    // gettxspendingprevout must not report an output as unspent while the index is syncing.
+    g_txospender_index = MakeUnique<TxoSpenderIndex>(1 << 20, true);
+    JSONRPCRequest request;
+    request.strMethod = "gettxspendingprevout";
+    UniValue output(UniValue::VOBJ);
+    output.pushKV("txid", spends[0].vin[0].prevout.hash.GetHex());
+    output.pushKV("vout", 0);
+    UniValue outputs(UniValue::VARR);
+    outputs.push_back(output);
+    request.params = UniValue(UniValue::VARR);
+    request.params.push_back(outputs);
+    if (RPCIsInWarmup(nullptr)) SetRPCWarmupFinished();
+    BOOST_CHECK_EXCEPTION(tableRPC.execute(request), UniValue, [](const UniValue& error) {
+        return find_value(error, "message").get_str().find("still in the process of being indexed") != std::string::npos;
+    });
+    g_txospender_index.reset();
+
+    txospender_index.Start();
+
+    // Allow the index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!txospender_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // Check that the index has the spends made before it started.
+    for (size_t i = 0; i < 2; ++i) {
+        BOOST_CHECK(txospender_index.FindSpender(spends[i].vin[0].prevout, txid, height));
+        BOOST_CHECK(txid == spends[i].GetHash());
+        BOOST_CHECK_EQUAL(height, 101 + (int)i);
+    }
+    BOOST_CHECK(!txospender_index.FindSpender(spends[2].vin[0].prevout, txid, height));
+    BOOST_CHECK(!txospender_index.FindSpender(COutPoint(spends[0].GetHash(), 0), txid, height));
+
+    // Check that spends in new blocks make it into the index.
+    CreateAndProcessBlock({spends[2]}, coinbase_script);
+    BOOST_CHECK(txospender_index.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(txospender_index.FindSpender(spends[2].vin[0].prevout, txid, height));
+    BOOST_CHECK(txid == spends[2].GetHash());
+    BOOST_CHECK_EQUAL(height, 103);
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    txospender_index.Stop();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    // Rest of shutdown sequence and destructors happen in ~TestingSetup()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
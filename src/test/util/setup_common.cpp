@@ -130,6 +130,13 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
     }
     g_parallel_script_checks = true;
 
+    // Start coin prefetch threads so ConnectTip exercises the prefetch path.
+    constexpr int prefetch_threads = 2;
+    for (int i = 0; i < prefetch_threads; ++i) {
+        threadGroup.create_thread([i]() { return ThreadCoinPrefetch(i); });
+    }
+    g_parallel_coin_prefetch = true;
+
     m_node.mempool = &::mempool;
     m_node.mempool->setSanityCheck(1.0);
     m_node.banman = MakeUnique<BanMan>(GetDataDir() / "banlist.dat", nullptr, DEFAULT_MISBEHAVING_BANTIME);
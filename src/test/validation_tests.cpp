@@ -3,7 +3,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chainparams.h>
+#include <consensus/validation.h>
 #include <net.h>
+#include <node/rollingcoinstats.h>
+#include <script/interpreter.h>
 #include <validation.h>
 
 #include <test/util/setup_common.h>
@@ -74,4 +77,102 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+static void CheckRollingCoinStats()
+{
+    LOCK(cs_main);
+    ::ChainstateActive().ForceFlushStateToDisk();
+    RollingCoinStats scanned;
+    BOOST_REQUIRE(ComputeRollingCoinStats(&::ChainstateActive().CoinsDB(), scanned, [] { return false; }));
+    const RollingCoinStats& rolling = ::ChainstateActive().m_rolling_coin_stats;
+    BOOST_CHECK(rolling.GetHash() == scanned.GetHash());
+    BOOST_CHECK_EQUAL(rolling.coins_count, scanned.coins_count);
+    BOOST_CHECK_EQUAL(rolling.bogo_size, scanned.bogo_size);
+    BOOST_CHECK_EQUAL(rolling.total_amount, scanned.total_amount);
+}
+
+BOOST_FIXTURE_TEST_CASE(rolling_coin_stats, TestChain100Setup)
+{
+    CheckRollingCoinStats();
+    const uint256 hash_before = WITH_LOCK(cs_main, return ::ChainstateActive().m_rolling_coin_stats.GetHash());
+
+    // Spend a coinbase output, and the output of that spend in the same block.
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    std::vector<CMutableTransaction> spends(2);
+    for (int i = 0; i < 2; i++) {
+        spends[i].nVersion = 1;
+        spends[i].vin.resize(1);
+        spends[i].vin[0].prevout.hash = i == 0 ? m_coinbase_txns[0]->GetHash() : spends[0].GetHash();
+        spends[i].vin[0].prevout.n = 0;
+        spends[i].vout.resize(1);
+        spends[i].vout[0].nValue = (11 - i) * CENT;
+        spends[i].vout[0].scriptPubKey = scriptPubKey;
+
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, spends[i], 0, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        spends[i].vin[0].scriptSig << vchSig;
+    }
+    const CBlock block = CreateAndProcessBlock(spends, scriptPubKey);
+    BOOST_CHECK(WITH_LOCK(cs_main, return ::ChainActive().Tip()->GetBlockHash()) == block.GetHash());
+    CheckRollingCoinStats();
+
+    // Disconnecting the block restores the previous set.
+    BlockValidationState state;
+    CBlockIndex* tip = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    BOOST_CHECK(InvalidateBlock(state, Params(), tip));
+    CheckRollingCoinStats();
+    BOOST_CHECK(WITH_LOCK(cs_main, return ::ChainstateActive().m_rolling_coin_stats.GetHash()) == hash_before);
+}
+
+BOOST_FIXTURE_TEST_CASE(read_raw_block_from_finalized_file, TestChain100Setup)
+{
+    // Cap the block file, so the next block is written to a new one and the first is finalized.
+    CBlockIndex* old_tip = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    const int old_file = WITH_LOCK(cs_main, return old_tip->GetBlockPos().nFile);
+    GetBlockFileInfo(old_file)->nSize = MAX_BLOCKFILE_SIZE;
+    CreateAndProcessBlock({}, CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG);
+    CBlockIndex* new_tip = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return new_tip->GetBlockPos().nFile), old_file + 1);
+
+    // Blocks of the finalized file are read from its memory map, the new tip with stdio.
+    for (const CBlockIndex* pindex : {old_tip->pprev, old_tip, new_tip}) {
+        CBlock block;
+        BOOST_REQUIRE(ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+        std::vector<uint8_t> raw;
+        BOOST_REQUIRE(ReadRawBlockFromDisk(raw, pindex, Params().MessageStart()));
+        CDataStream expected(SER_NETWORK, PROTOCOL_VERSION);
+        expected << block;
+        BOOST_CHECK(raw == std::vector<uint8_t>(expected.begin(), expected.end()));
+    }
+
+    // Positions outside of the block file are rejected.
+    FlatFilePos pos = WITH_LOCK(cs_main, return old_tip->GetBlockPos());
+    std::vector<uint8_t> raw;
+    BOOST_CHECK(!ReadRawBlockFromDisk(raw, FlatFilePos(pos.nFile, 4), Params().MessageStart()));
+    BOOST_CHECK(!ReadRawBlockFromDisk(raw, FlatFilePos(pos.nFile, MAX_BLOCKFILE_SIZE + 1), Params().MessageStart()));
+}
+
+BOOST_FIXTURE_TEST_CASE(verifydb_parallel_checks, TestChain100Setup)
+{
+    LOCK(cs_main);
+    CCoinsViewCache& coins = ::ChainstateActive().CoinsTip();
+    for (int level = 0; level <= 4; ++level) {
+        BOOST_CHECK(CVerifyDB().VerifyDB(Params(), &coins, level, 0));
+    }
+    BOOST_CHECK(CVerifyDB().VerifyDB(Params(), &coins, 4, 10));
+
+    // A block that cannot be read is reported, wherever it is in the window
+    // of blocks being checked ahead.
+    CBlockIndex* pindex = ::ChainActive()[50];
+    const unsigned int data_pos = pindex->nDataPos;
+    pindex->nDataPos = 1;
+    BOOST_CHECK(!CVerifyDB().VerifyDB(Params(), &coins, 1, 0));
+    BOOST_CHECK(!CVerifyDB().VerifyDB(Params(), &coins, 4, 0));
+    BOOST_CHECK(CVerifyDB().VerifyDB(Params(), &coins, 4, 40));
+    pindex->nDataPos = data_pos;
+    BOOST_CHECK(CVerifyDB().VerifyDB(Params(), &coins, 4, 0));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,12 +5,14 @@
 
 #include <txdb.h>
 
+#include <node/rollingcoinstats.h>
 #include <pow.h>
 #include <random.h>
 #include <shutdown.h>
 #include <ui_interface.h>
 #include <uint256.h>
 #include <util/system.h>
+#include <util/time.h>
 #include <util/translation.h>
 #include <util/vector.h>
 
@@ -28,6 +30,7 @@ static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_ROLLING_STATS = 'M';
 
 namespace {
 
@@ -81,6 +84,12 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    bool ret = WriteCoins(mapCoins, hashBlock);
+    mapCoins.clear();
+    return ret;
+}
+
+bool CCoinsViewDB::WriteCoins(const CCoinsMap& mapCoins, const uint256& hashBlock) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
@@ -105,7 +114,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, Vector(hashBlock, old_tip));
 
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end(); ++it) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             CoinEntry entry(&it->first);
             if (it->second.coin.IsSpent())
@@ -115,8 +124,6 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -141,11 +148,125 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     return ret;
 }
 
+bool CCoinsViewDB::WriteRollingCoinStats(const uint256& block_hash, const RollingCoinStats& stats)
+{
+    const uint8_t slot = m_rolling_stats_slot;
+    if (!db.Write(std::make_pair(DB_ROLLING_STATS, slot), std::make_pair(block_hash, stats))) return false;
+    m_rolling_stats_slot = !slot;
+    return true;
+}
+
+bool CCoinsViewDB::ReadRollingCoinStats(const uint256& block_hash, RollingCoinStats& stats)
+{
+    for (const uint8_t slot : {0, 1}) {
+        std::pair<uint256, RollingCoinStats> entry;
+        if (db.Read(std::make_pair(DB_ROLLING_STATS, slot), entry) && entry.first == block_hash) {
+            stats = entry.second;
+            m_rolling_stats_slot = !slot;
+            return true;
+        }
+    }
+    return false;
+}
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
+CCoinsViewFlushBuffer::CCoinsViewFlushBuffer(CCoinsViewDB& db) : CCoinsViewCache(&db), m_db(db) {}
+
+CCoinsViewFlushBuffer::~CCoinsViewFlushBuffer()
+{
+    WaitForFlush();
+}
+
+bool CCoinsViewFlushBuffer::GetCoin(const COutPoint& outpoint, Coin& coin) const
+{
+    {
+        LOCK(m_mutex);
+        if (m_flushing) {
+            // Entries in the buffer are newer than the database, which may
+            // or may not have been updated with them yet.
+            CCoinsMap::const_iterator it = cacheCoins.find(outpoint);
+            if (it != cacheCoins.end()) {
+                coin = it->second.coin;
+                return !coin.IsSpent();
+            }
+        }
+    }
+    return m_db.GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewFlushBuffer::HaveCoin(const COutPoint& outpoint) const
+{
+    Coin coin;
+    return GetCoin(outpoint, coin);
+}
+
+uint256 CCoinsViewFlushBuffer::GetBestBlock() const
+{
+    {
+        LOCK(m_mutex);
+        if (m_flushing) return hashBlock;
+    }
+    return m_db.GetBestBlock();
+}
+
+bool CCoinsViewFlushBuffer::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
+{
+    // The database must be up to date before mapCoins is written on top of it.
+    bool ret = WaitForFlush();
+    return m_db.BatchWrite(mapCoins, hashBlock) && ret;
+}
+
+size_t CCoinsViewFlushBuffer::EstimateSize() const
+{
+    return m_db.EstimateSize();
+}
+
+bool CCoinsViewFlushBuffer::FlushInBackground(CCoinsViewCache& cache)
+{
+    bool ret = WaitForFlush();
+    {
+        LOCK(m_mutex);
+        cache.MoveEntriesTo(*this);
+        m_flushing = true;
+    }
+    m_flush_done = false;
+    // The entries are not modified until WaitForFlush() joins this thread,
+    // so readers only need m_mutex to know whether they are still there.
+    m_thread = std::thread(&TraceThread<std::function<void()>>, "coinsflush", [this] {
+        const int64_t start = GetTimeMicros();
+        bool ok = false;
+        try {
+            ok = m_db.WriteCoins(cacheCoins, hashBlock);
+        } catch (const std::runtime_error& e) {
+            LogPrintf("Error writing to coin database in the background: %s\n", e.what());
+        }
+        m_last_write_time = GetTimeMicros() - start;
+        m_flush_ok = ok;
+        m_flush_done = true;
+    });
+    return ret;
+}
+
+bool CCoinsViewFlushBuffer::WaitForFlush()
+{
+    if (m_thread.joinable()) m_thread.join();
+    LOCK(m_mutex);
+    if (!m_flushing) return true;
+    ClearCache();
+    m_flushing = false;
+    return m_flush_ok;
+}
+
+bool CCoinsViewFlushBuffer::IsFlushing() const
+{
+    LOCK(m_mutex);
+    return m_flushing;
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
 }
 
@@ -176,16 +297,37 @@ CCoinsViewCursor *CCoinsViewDB::Cursor() const
        that restriction.  */
     i->pcursor->Seek(DB_COIN);
     // Cache key of first record
-    if (i->pcursor->Valid()) {
-        CoinEntry entry(&i->keyTmp.second);
-        i->pcursor->GetKey(entry);
-        i->keyTmp.first = entry.key;
+    i->CacheKey();
+    return i;
+}
+
+CCoinsViewCursor *CCoinsViewDB::Cursor(std::shared_ptr<const CDBSnapshot> snapshot, unsigned int begin_byte, unsigned int end_byte) const
+{
+    assert(begin_byte <= end_byte && end_byte <= 256);
+    CDBIterator* it = db.NewIterator(*snapshot);
+    CCoinsViewDBCursor *i = new CCoinsViewDBCursor(std::move(snapshot), it, GetBestBlock(), end_byte);
+    // Coin keys are DB_COIN followed by the serialized txid, whose first byte begin_byte is.
+    if (begin_byte < 256) {
+        i->pcursor->Seek(std::make_pair(DB_COIN, static_cast<uint8_t>(begin_byte)));
+        i->CacheKey();
     } else {
-        i->keyTmp.first = 0; // Make sure Valid() and GetKey() return false
+        i->keyTmp.first = 0;
     }
     return i;
 }
 
+void CCoinsViewDBCursor::CacheKey()
+{
+    CoinEntry entry(&keyTmp.second);
+    if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
+        keyTmp.first = 0; // Make sure Valid() and GetKey() return false
+    } else if (entry.key == DB_COIN && *keyTmp.second.hash.begin() >= m_end_byte) {
+        keyTmp.first = 0; // Past the end of the requested range
+    } else {
+        keyTmp.first = entry.key;
+    }
+}
+
 bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
 {
     // Return cached key
@@ -214,12 +356,7 @@ bool CCoinsViewDBCursor::Valid() const
 void CCoinsViewDBCursor::Next()
 {
     pcursor->Next();
-    CoinEntry entry(&keyTmp.second);
-    if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
-        keyTmp.first = 0; // Invalidate cached key after last record so that Valid() and GetKey() return false
-    } else {
-        keyTmp.first = entry.key;
-    }
+    CacheKey();
 }
 
 bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
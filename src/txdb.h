@@ -10,14 +10,18 @@
 #include <dbwrapper.h>
 #include <chain.h>
 #include <primitives/block.h>
+#include <sync.h>
 
+#include <atomic>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 class CBlockIndex;
 class CCoinsViewDBCursor;
+struct RollingCoinStats;
 class uint256;
 
 //! No need to periodic flush if at least this much space still available.
@@ -38,6 +42,12 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxTxIndexCache = 1024;
 //! Max memory allocated to all block filter index caches combined in MiB.
 static const int64_t max_filter_index_cache = 1024;
+//! Max memory allocated to the coin statistics index cache in MiB.
+static const int64_t max_coinstats_index_cache = 8;
+//! Max memory allocated to the address index cache in MiB.
+static const int64_t max_addr_index_cache = 1024;
+//! Max memory allocated to the spent output index cache in MiB.
+static const int64_t max_txospender_index_cache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
@@ -46,6 +56,8 @@ class CCoinsViewDB final : public CCoinsView
 {
 protected:
     CDBWrapper db;
+    //! Which of the two entries WriteRollingCoinStats() replaces next.
+    uint8_t m_rolling_stats_slot{0};
 public:
     /**
      * @param[in] ldb_path    Location in the filesystem where leveldb data will be stored.
@@ -59,11 +71,88 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
 
+    //! Take a snapshot of the coin database to iterate over with Cursor(snapshot, ...).
+    std::shared_ptr<const CDBSnapshot> GetSnapshot() const { return db.GetSnapshot(); }
+
+    /**
+     * Iterate over the coins of a snapshot whose txid starts with a byte in
+     * [begin_byte, end_byte), so that disjoint partitions of the set can be
+     * read in parallel. The cursor keeps the snapshot alive.
+     */
+    CCoinsViewCursor *Cursor(std::shared_ptr<const CDBSnapshot> snapshot, unsigned int begin_byte, unsigned int end_byte) const;
+
+    //! Like BatchWrite(), but leaves mapCoins untouched so it can be read concurrently.
+    bool WriteCoins(const CCoinsMap& mapCoins, const uint256& hashBlock);
+
+    /**
+     * Store the rolling statistics of the UTXO set as of block_hash. The two
+     * most recent writes are kept, so that whichever of their blocks the coins
+     * on disk end up at after a crash has its statistics available.
+     */
+    bool WriteRollingCoinStats(const uint256& block_hash, const RollingCoinStats& stats);
+    //! Read the rolling statistics of the UTXO set as of block_hash, if stored.
+    //! The next write then keeps this entry.
+    bool ReadRollingCoinStats(const uint256& block_hash, RollingCoinStats& stats);
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
 };
 
+/**
+ * Layer between the coins cache and CCoinsViewDB that lets the cache be
+ * written to disk without stalling validation. FlushInBackground() takes over
+ * the entries of a cache, which stay readable through this view while a
+ * background thread writes them to the database.
+ */
+class CCoinsViewFlushBuffer final : public CCoinsViewCache
+{
+private:
+    CCoinsViewDB& m_db;
+
+    //! Guards releasing the entries being written against readers.
+    mutable Mutex m_mutex;
+    //! Whether the entries of this cache are being (or have been) written by m_thread.
+    bool m_flushing GUARDED_BY(m_mutex){false};
+
+    std::thread m_thread;
+    std::atomic<bool> m_flush_done{true};
+    std::atomic<bool> m_flush_ok{true};
+    //! Duration of the last background write (microseconds).
+    std::atomic<int64_t> m_last_write_time{0};
+
+public:
+    explicit CCoinsViewFlushBuffer(CCoinsViewDB& db);
+    ~CCoinsViewFlushBuffer();
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    uint256 GetBestBlock() const override;
+    //! Waits for a background write before writing mapCoins to the database.
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    size_t EstimateSize() const override;
+
+    /**
+     * Take over the entries of cache (see CCoinsViewCache::MoveEntriesTo)
+     * and start writing them to the database in the background. A previous
+     * background write is waited for first. Returns false if that one failed.
+     */
+    bool FlushInBackground(CCoinsViewCache& cache);
+
+    /**
+     * Wait for the background write, if any, and release its entries.
+     * Returns false if it failed.
+     */
+    bool WaitForFlush();
+
+    //! Whether there are entries that WaitForFlush() has not released yet.
+    bool IsFlushing() const;
+    //! Whether WaitForFlush() would return without blocking.
+    bool FlushDone() const { return m_flush_done; }
+    //! Duration of the last background write (microseconds).
+    int64_t LastWriteTime() const { return m_last_write_time; }
+};
+
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
 class CCoinsViewDBCursor: public CCoinsViewCursor
 {
@@ -80,8 +169,16 @@ public:
 private:
     CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256 &hashBlockIn):
         CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn) {}
+    CCoinsViewDBCursor(std::shared_ptr<const CDBSnapshot> snapshot, CDBIterator* pcursorIn, const uint256 &hashBlockIn, unsigned int end_byte):
+        CCoinsViewCursor(hashBlockIn), m_snapshot(std::move(snapshot)), pcursor(pcursorIn), m_end_byte(end_byte) {}
+    //! Cache the key of the current record, or invalidate the cursor past the last one.
+    void CacheKey();
+    //! Declared before pcursor so that it is released after the iterator.
+    std::shared_ptr<const CDBSnapshot> m_snapshot;
     std::unique_ptr<CDBIterator> pcursor;
     std::pair<char, COutPoint> keyTmp;
+    //! The cursor ends before the first coin whose txid starts with this byte.
+    unsigned int m_end_byte{256};
 
     friend class CCoinsViewDB;
 };
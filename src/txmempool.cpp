@@ -16,14 +16,16 @@
 #include <reverse_iterator.h>
 #include <util/system.h>
 #include <util/moneystr.h>
+#include <util/rbf.h>
 #include <util/time.h>
 #include <validationinterface.h>
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                                  int64_t _nTime, unsigned int _entryHeight,
                                  bool _spendsCoinbase, int64_t _sigOpsCost, LockPoints lp)
-    : tx(_tx), nFee(_nFee), nTxWeight(GetTransactionWeight(*tx)), nUsageSize(RecursiveDynamicUsage(tx)), nTime(_nTime), entryHeight(_entryHeight),
-    spendsCoinbase(_spendsCoinbase), sigOpCost(_sigOpsCost), lockPoints(lp)
+    : tx(_tx), nFee(_nFee), nTime(_nTime), sigOpCost(_sigOpsCost), lockPoints(lp),
+    nTxWeight(GetTransactionWeight(*tx)), nUsageSize(RecursiveDynamicUsage(tx)), entryHeight(_entryHeight),
+    spendsCoinbase(_spendsCoinbase)
 {
     nCountWithDescendants = 1;
     nSizeWithDescendants = GetTxSize();
@@ -59,34 +61,41 @@ size_t CTxMemPoolEntry::GetTxSize() const
 // descendants.
 void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendants, const std::set<uint256> &setExclude)
 {
-    setEntries stageEntries, setAllDescendants;
-    stageEntries = GetMemPoolChildren(updateIt);
+    const EpochGuard epoch(*this);
+    std::vector<txiter>& stageEntries = m_walk_stage;
+    std::vector<txiter>& allDescendants = m_walk_found;
+    stageEntries.clear();
+    allDescendants.clear();
+    for (txiter child : GetMemPoolChildren(updateIt)) {
+        visited(child);
+        stageEntries.push_back(child);
+    }
 
     while (!stageEntries.empty()) {
-        const txiter cit = *stageEntries.begin();
-        setAllDescendants.insert(cit);
-        stageEntries.erase(cit);
-        const setEntries &setChildren = GetMemPoolChildren(cit);
+        const txiter cit = stageEntries.back();
+        stageEntries.pop_back();
+        allDescendants.push_back(cit);
+        const LinkedEntries setChildren = GetMemPoolChildren(cit);
         for (txiter childEntry : setChildren) {
             cacheMap::iterator cacheIt = cachedDescendants.find(childEntry);
             if (cacheIt != cachedDescendants.end()) {
                 // We've already calculated this one, just add the entries for this set
                 // but don't traverse again.
                 for (txiter cacheEntry : cacheIt->second) {
-                    setAllDescendants.insert(cacheEntry);
+                    if (!visited(cacheEntry)) allDescendants.push_back(cacheEntry);
                 }
-            } else if (!setAllDescendants.count(childEntry)) {
+            } else if (!visited(childEntry)) {
                 // Schedule for later processing
-                stageEntries.insert(childEntry);
+                stageEntries.push_back(childEntry);
             }
         }
     }
-    // setAllDescendants now contains all in-mempool descendants of updateIt.
+    // allDescendants now contains all in-mempool descendants of updateIt.
     // Update and add to cached descendant map
     int64_t modifySize = 0;
     CAmount modifyFee = 0;
     int64_t modifyCount = 0;
-    for (txiter cit : setAllDescendants) {
+    for (txiter cit : allDescendants) {
         if (!setExclude.count(cit->GetTx().GetHash())) {
             modifySize += cit->GetTxSize();
             modifyFee += cit->GetModifiedFee();
@@ -107,6 +116,7 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendan
 void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashesToUpdate)
 {
     AssertLockHeld(cs);
+    InvalidateSnapshot();
     // For each entry in vHashesToUpdate, store the set of in-mempool, but not
     // in-vHashesToUpdate transactions, so that we don't have to recalculate
     // descendants when we come across a previously seen entry.
@@ -149,7 +159,9 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
 
 bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string &errString, bool fSearchForParents /* = true */) const
 {
-    setEntries parentHashes;
+    const EpochGuard epoch(*this);
+    std::vector<txiter>& parentHashes = m_walk_stage;
+    parentHashes.clear();
     const CTransaction &tx = entry.GetTx();
 
     if (fSearchForParents) {
@@ -158,8 +170,8 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         // iterate mapTx to find parents.
         for (unsigned int i = 0; i < tx.vin.size(); i++) {
             Optional<txiter> piter = GetIter(tx.vin[i].prevout.hash);
-            if (piter) {
-                parentHashes.insert(*piter);
+            if (piter && !visited(*piter)) {
+                parentHashes.push_back(*piter);
                 if (parentHashes.size() + 1 > limitAncestorCount) {
                     errString = strprintf("too many unconfirmed parents [limit: %u]", limitAncestorCount);
                     return false;
@@ -170,16 +182,19 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         // If we're not searching for parents, we require this to be an
         // entry in the mempool already.
         txiter it = mapTx.iterator_to(entry);
-        parentHashes = GetMemPoolParents(it);
+        for (txiter parent : GetMemPoolParents(it)) {
+            visited(parent);
+            parentHashes.push_back(parent);
+        }
     }
 
     size_t totalSizeWithAncestors = entry.GetTxSize();
 
     while (!parentHashes.empty()) {
-        txiter stageit = *parentHashes.begin();
+        txiter stageit = parentHashes.back();
 
         setAncestors.insert(stageit);
-        parentHashes.erase(stageit);
+        parentHashes.pop_back();
         totalSizeWithAncestors += stageit->GetTxSize();
 
         if (stageit->GetSizeWithDescendants() + entry.GetTxSize() > limitDescendantSize) {
@@ -193,11 +208,11 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
             return false;
         }
 
-        const setEntries & setMemPoolParents = GetMemPoolParents(stageit);
+        const LinkedEntries setMemPoolParents = GetMemPoolParents(stageit);
         for (txiter phash : setMemPoolParents) {
             // If this is a new ancestor, add it.
-            if (setAncestors.count(phash) == 0) {
-                parentHashes.insert(phash);
+            if (!visited(phash)) {
+                parentHashes.push_back(phash);
             }
             if (parentHashes.size() + setAncestors.size() + 1 > limitAncestorCount) {
                 errString = strprintf("too many unconfirmed ancestors [limit: %u]", limitAncestorCount);
@@ -211,9 +226,8 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
 
 void CTxMemPool::UpdateAncestorsOf(bool add, txiter it, setEntries &setAncestors)
 {
-    setEntries parentIters = GetMemPoolParents(it);
     // add or remove this tx as a child of each parent
-    for (txiter piter : parentIters) {
+    for (txiter piter : GetMemPoolParents(it)) {
         UpdateChild(piter, it, add);
     }
     const int64_t updateCount = (add ? 1 : -1);
@@ -240,8 +254,7 @@ void CTxMemPool::UpdateEntryForAncestors(txiter it, const setEntries &setAncesto
 
 void CTxMemPool::UpdateChildrenForRemoval(txiter it)
 {
-    const setEntries &setMemPoolChildren = GetMemPoolChildren(it);
-    for (txiter updateIt : setMemPoolChildren) {
+    for (txiter updateIt : GetMemPoolChildren(it)) {
         UpdateParent(updateIt, it, false);
     }
 }
@@ -255,7 +268,7 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
         // updateDescendants should be true whenever we're not recursively
         // removing a tx and all its descendants, eg when a transaction is
         // confirmed in a block.
-        // Here we only update statistics and not data in mapLinks (which
+        // Here we only update statistics and not the parent and child links (which
         // we need to preserve until we're finished with all operations that
         // need to traverse the mempool).
         for (txiter removeIt : entriesToRemove) {
@@ -280,16 +293,16 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
         // should be a bit faster.
         // However, if we happen to be in the middle of processing a reorg, then
         // the mempool can be in an inconsistent state.  In this case, the set
-        // of ancestors reachable via mapLinks will be the same as the set of
+        // of ancestors reachable via the links will be the same as the set of
         // ancestors whose packages include this transaction, because when we
         // add a new transaction to the mempool in addUnchecked(), we assume it
         // has no children, and in the case of a reorg where that assumption is
         // false, the in-mempool children aren't linked to the in-block tx's
         // until UpdateTransactionsFromBlock() is called.
         // So if we're being called during a reorg, ie before
-        // UpdateTransactionsFromBlock() has been called, then mapLinks[] will
+        // UpdateTransactionsFromBlock() has been called, then the links will
         // differ from the set of mempool parents we'd calculate by searching,
-        // and it's important that we use the mapLinks[] notion of ancestor
+        // and it's important that we use the links' notion of ancestor
         // transactions as the set of things to update for removal.
         CalculateMemPoolAncestors(entry, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
         // Note that UpdateAncestorsOf severs the child links that point to
@@ -324,6 +337,18 @@ void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee,
     assert(int(nSigOpCostWithAncestors) >= 0);
 }
 
+CTxMemPool::EpochGuard::EpochGuard(const CTxMemPool& in) : pool(in)
+{
+    assert(!pool.m_has_epoch_guard);
+    ++pool.m_epoch;
+    pool.m_has_epoch_guard = true;
+}
+
+CTxMemPool::EpochGuard::~EpochGuard()
+{
+    pool.m_has_epoch_guard = false;
+}
+
 CTxMemPool::CTxMemPool(CBlockPolicyEstimator* estimator)
     : nTransactionsUpdated(0), minerPolicyEstimator(estimator)
 {
@@ -358,7 +383,6 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAnces
     // Used by AcceptToMemoryPool(), which DOES do
     // all the appropriate checks.
     indexed_transaction_set::iterator newit = mapTx.insert(entry).first;
-    mapLinks.insert(make_pair(newit, TxLinks()));
 
     // Update transaction for any feeDelta created by PrioritiseTransaction
     // TODO: refactor so that the fee delta is calculated before inserting
@@ -395,6 +419,7 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAnces
     UpdateEntryForAncestors(newit, setAncestors);
 
     nTransactionsUpdated++;
+    InvalidateSnapshot();
     totalTxSize += entry.GetTxSize();
     if (minerPolicyEstimator) {minerPolicyEstimator->processTransaction(entry, validFeeEstimate);}
 
@@ -425,10 +450,10 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 
     totalTxSize -= it->GetTxSize();
     cachedInnerUsage -= it->DynamicMemoryUsage();
-    cachedInnerUsage -= memusage::DynamicUsage(mapLinks[it].parents) + memusage::DynamicUsage(mapLinks[it].children);
-    mapLinks.erase(it);
+    cachedInnerUsage -= memusage::DynamicUsage(it->m_parents) + memusage::DynamicUsage(it->m_children);
     mapTx.erase(it);
     nTransactionsUpdated++;
+    InvalidateSnapshot();
     if (minerPolicyEstimator) {minerPolicyEstimator->removeTx(hash, false);}
 }
 
@@ -440,22 +465,24 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 // can save time by not iterating over those entries.
 void CTxMemPool::CalculateDescendants(txiter entryit, setEntries& setDescendants) const
 {
-    setEntries stage;
-    if (setDescendants.count(entryit) == 0) {
-        stage.insert(entryit);
+    const EpochGuard epoch(*this);
+    std::vector<txiter>& stage = m_walk_stage;
+    stage.clear();
+    if (setDescendants.insert(entryit).second) {
+        visited(entryit);
+        stage.push_back(entryit);
     }
     // Traverse down the children of entry, only adding children that are not
     // accounted for in setDescendants already (because those children have either
     // already been walked, or will be walked in this iteration).
     while (!stage.empty()) {
-        txiter it = *stage.begin();
-        setDescendants.insert(it);
-        stage.erase(it);
+        txiter it = stage.back();
+        stage.pop_back();
 
-        const setEntries &setChildren = GetMemPoolChildren(it);
+        const LinkedEntries setChildren = GetMemPoolChildren(it);
         for (txiter childiter : setChildren) {
-            if (!setDescendants.count(childiter)) {
-                stage.insert(childiter);
+            if (!visited(childiter) && setDescendants.insert(childiter).second) {
+                stage.push_back(childiter);
             }
         }
     }
@@ -579,7 +606,7 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
 
 void CTxMemPool::_clear()
 {
-    mapLinks.clear();
+    InvalidateSnapshot();
     mapTx.clear();
     mapNextTx.clear();
     totalTxSize = 0;
@@ -628,10 +655,7 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
         checkTotal += it->GetTxSize();
         innerUsage += it->DynamicMemoryUsage();
         const CTransaction& tx = it->GetTx();
-        txlinksMap::const_iterator linksiter = mapLinks.find(it);
-        assert(linksiter != mapLinks.end());
-        const TxLinks &links = linksiter->second;
-        innerUsage += memusage::DynamicUsage(links.parents) + memusage::DynamicUsage(links.children);
+        innerUsage += memusage::DynamicUsage(it->m_parents) + memusage::DynamicUsage(it->m_children);
         bool fDependsWait = false;
         setEntries setParentCheck;
         for (const CTxIn &txin : tx.vin) {
@@ -652,7 +676,9 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
             assert(it3->second == &tx);
             i++;
         }
-        assert(setParentCheck == GetMemPoolParents(it));
+        const LinkedEntries parents = GetMemPoolParents(it);
+        assert(setParentCheck.size() == parents.size());
+        assert(std::equal(setParentCheck.begin(), setParentCheck.end(), parents.begin()));
         // Verify ancestor state is correct.
         setEntries setAncestors;
         uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
@@ -685,7 +711,9 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
                 child_sizes += childit->GetTxSize();
             }
         }
-        assert(setChildrenCheck == GetMemPoolChildren(it));
+        const LinkedEntries children = GetMemPoolChildren(it);
+        assert(setChildrenCheck.size() == children.size());
+        assert(std::equal(setChildrenCheck.begin(), setChildrenCheck.end(), children.begin()));
         // Also check to make sure size is greater than sum with immediate children.
         // just a sanity check, not definitive that this calc is correct...
         assert(it->GetSizeWithDescendants() >= child_sizes + it->GetTxSize());
@@ -766,6 +794,110 @@ std::vector<CTxMemPool::indexed_transaction_set::const_iterator> CTxMemPool::Get
     return iters;
 }
 
+namespace {
+//! Orders snapshot entries like DepthAndScoreComparator orders mapTx entries
+bool CompareSnapshotEntryByDepthAndScore(const MemPoolSnapshot::Entry& a, const MemPoolSnapshot::Entry& b)
+{
+    if (a.count_with_ancestors != b.count_with_ancestors) {
+        return a.count_with_ancestors < b.count_with_ancestors;
+    }
+    // Same as CompareTxMemPoolEntryByScore
+    double f1 = (double)a.fee * b.vsize;
+    double f2 = (double)b.fee * a.vsize;
+    if (f1 == f2) {
+        return b.tx->GetHash() < a.tx->GetHash();
+    }
+    return f1 > f2;
+}
+} // namespace
+
+const MemPoolSnapshot::Entry* MemPoolSnapshot::Find(const uint256& txid) const
+{
+    auto it = std::lower_bound(by_txid.begin(), by_txid.end(), txid, [](const std::pair<uint256, size_t>& a, const uint256& b) {
+        return a.first < b;
+    });
+    if (it == by_txid.end() || it->first != txid) return nullptr;
+    return &entries[it->second];
+}
+
+MemPoolSnapshot::Entry CTxMemPool::GetSnapshotEntry(txiter it) const
+{
+    AssertLockHeld(cs);
+    MemPoolSnapshot::Entry entry;
+    entry.tx = it->GetSharedTx();
+    entry.fee = it->GetFee();
+    entry.modified_fee = it->GetModifiedFee();
+    entry.vsize = it->GetTxSize();
+    entry.weight = it->GetTxWeight();
+    entry.time = it->GetTime();
+    entry.height = it->GetHeight();
+    entry.count_with_descendants = it->GetCountWithDescendants();
+    entry.size_with_descendants = it->GetSizeWithDescendants();
+    entry.mod_fees_with_descendants = it->GetModFeesWithDescendants();
+    entry.count_with_ancestors = it->GetCountWithAncestors();
+    entry.size_with_ancestors = it->GetSizeWithAncestors();
+    entry.mod_fees_with_ancestors = it->GetModFeesWithAncestors();
+    entry.depends.reserve(it->m_parents.size());
+    for (const CTxMemPoolEntry* parent : it->m_parents) {
+        entry.depends.push_back(parent->GetTx().GetHash());
+    }
+    entry.spentby.reserve(it->m_children.size());
+    for (const CTxMemPoolEntry* child : it->m_children) {
+        entry.spentby.push_back(child->GetTx().GetHash());
+    }
+    return entry;
+}
+
+std::shared_ptr<const MemPoolSnapshot> CTxMemPool::GetCachedSnapshot() const
+{
+    LOCK(m_snapshot_mutex);
+    std::shared_ptr<const MemPoolSnapshot> cached = m_snapshot.lock();
+    if (cached && cached->sequence == m_snapshot_sequence) return cached;
+    return nullptr;
+}
+
+std::shared_ptr<const MemPoolSnapshot> CTxMemPool::GetSnapshot() const
+{
+    if (std::shared_ptr<const MemPoolSnapshot> cached = GetCachedSnapshot()) return cached;
+
+    auto snapshot = std::make_shared<MemPoolSnapshot>();
+    std::vector<MemPoolSnapshot::Entry>& entries = snapshot->entries;
+    {
+        LOCK(cs);
+        // Another reader may have published one while this one waited for cs.
+        if (std::shared_ptr<const MemPoolSnapshot> cached = GetCachedSnapshot()) return cached;
+        snapshot->sequence = m_snapshot_sequence;
+        entries.reserve(mapTx.size());
+        for (txiter it = mapTx.begin(); it != mapTx.end(); ++it) {
+            entries.push_back(GetSnapshotEntry(it));
+        }
+    }
+
+    // The rest only works on the copy, so writers can go ahead meanwhile.
+    std::sort(entries.begin(), entries.end(), CompareSnapshotEntryByDepthAndScore);
+    snapshot->by_txid.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        snapshot->by_txid.emplace_back(entries[i].tx->GetHash(), i);
+    }
+    std::sort(snapshot->by_txid.begin(), snapshot->by_txid.end());
+    // Parents come first, so their replaceability is known by the time a
+    // child looks at it, which saves walking all ancestors like IsRBFOptIn().
+    for (MemPoolSnapshot::Entry& entry : entries) {
+        entry.bip125_replaceable = SignalsOptInRBF(*entry.tx) ||
+            std::any_of(entry.depends.begin(), entry.depends.end(), [&](const uint256& parent) {
+                const MemPoolSnapshot::Entry* parent_entry = snapshot->Find(parent);
+                return parent_entry && parent_entry->bip125_replaceable;
+            });
+    }
+
+    // Publish, unless a concurrent reader already published a copy at least as new.
+    LOCK(m_snapshot_mutex);
+    std::shared_ptr<const MemPoolSnapshot> published = m_snapshot.lock();
+    if (published && published->sequence >= snapshot->sequence) return published;
+    m_snapshot = snapshot;
+    return snapshot;
+}
+
 void CTxMemPool::queryHashes(std::vector<uint256>& vtxid) const
 {
     LOCK(cs);
@@ -840,6 +972,7 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
                 mapTx.modify(descendantIt, update_ancestor_state(0, nFeeDelta, 0, 0));
             }
             ++nTransactionsUpdated;
+            InvalidateSnapshot();
         }
     }
     LogPrintf("PrioritiseTransaction: %s feerate += %s\n", hash.ToString(), FormatMoney(nFeeDelta));
@@ -912,8 +1045,9 @@ bool CCoinsViewMemPool::GetCoin(const COutPoint &outpoint, Coin &coin) const {
 
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
-    // Estimate the overhead of mapTx to be 12 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    // Estimate the overhead of mapTx to be 12 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented:
+    // 2 for the hashed index and 3 for each ordered index per node, plus about one bucket per entry.
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
@@ -950,40 +1084,44 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, bool validFeeEstimat
     return addUnchecked(entry, setAncestors, validFeeEstimate);
 }
 
-void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
+void CTxMemPool::UpdateLinks(CTxMemPoolEntry::Links& links, const CTxMemPoolEntry& link, bool add)
 {
-    setEntries s;
-    if (add && mapLinks[entry].children.insert(child).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && mapLinks[entry].children.erase(child)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    auto by_txid = [](const CTxMemPoolEntry* a, const CTxMemPoolEntry* b) {
+        return a->GetTx().GetHash() < b->GetTx().GetHash();
+    };
+    auto pos = std::lower_bound(links.begin(), links.end(), &link, by_txid);
+    const bool present = pos != links.end() && *pos == &link;
+    if (add == present) return;
+    cachedInnerUsage -= memusage::DynamicUsage(links);
+    if (add) {
+        links.insert(pos, &link);
+    } else {
+        links.erase(pos);
+        if (links.empty()) links.shrink_to_fit();
     }
+    cachedInnerUsage += memusage::DynamicUsage(links);
+}
+
+void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
+{
+    UpdateLinks(entry->m_children, *child, add);
 }
 
 void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
 {
-    setEntries s;
-    if (add && mapLinks[entry].parents.insert(parent).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && mapLinks[entry].parents.erase(parent)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
-    }
+    UpdateLinks(entry->m_parents, *parent, add);
 }
 
-const CTxMemPool::setEntries & CTxMemPool::GetMemPoolParents(txiter entry) const
+CTxMemPool::LinkedEntries CTxMemPool::GetMemPoolParents(txiter entry) const
 {
     assert (entry != mapTx.end());
-    txlinksMap::const_iterator it = mapLinks.find(entry);
-    assert(it != mapLinks.end());
-    return it->second.parents;
+    return LinkedEntries(mapTx, entry->m_parents);
 }
 
-const CTxMemPool::setEntries & CTxMemPool::GetMemPoolChildren(txiter entry) const
+CTxMemPool::LinkedEntries CTxMemPool::GetMemPoolChildren(txiter entry) const
 {
     assert (entry != mapTx.end());
-    txlinksMap::const_iterator it = mapLinks.find(entry);
-    assert(it != mapLinks.end());
-    return it->second.children;
+    return LinkedEntries(mapTx, entry->m_children);
 }
 
 CFeeRate CTxMemPool::GetMinFee(size_t sizelimit) const {
@@ -1071,7 +1209,7 @@ uint64_t CTxMemPool::CalculateDescendantMaximum(txiter entry) const {
         txiter candidate = candidates.back();
         candidates.pop_back();
         if (!counted.insert(candidate).second) continue;
-        const setEntries& parents = GetMemPoolParents(candidate);
+        const LinkedEntries parents = GetMemPoolParents(candidate);
         if (parents.size() == 0) {
             maximum = std::max(maximum, candidate->GetCountWithDescendants());
         } else {
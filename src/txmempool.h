@@ -6,8 +6,11 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <algorithm>
 #include <atomic>
+#include <iterator>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <utility>
@@ -64,14 +67,16 @@ struct LockPoints
 
 class CTxMemPoolEntry
 {
+public:
+    //! In-mempool parents or children of an entry, kept sorted by txid
+    typedef std::vector<const CTxMemPoolEntry*> Links;
+
 private:
+    // Members are ordered by alignment so the entry (which every mapTx node
+    // embeds) carries no padding between them.
     const CTransactionRef tx;
     const CAmount nFee;             //!< Cached to avoid expensive parent-transaction lookups
-    const size_t nTxWeight;         //!< ... and avoid recomputing tx weight (also used for GetTxSize())
-    const size_t nUsageSize;        //!< ... and total memory usage
     const int64_t nTime;            //!< Local time when entering the mempool
-    const unsigned int entryHeight; //!< Chain height when entering the mempool
-    const bool spendsCoinbase;      //!< keep track of transactions that spend a coinbase
     const int64_t sigOpCost;        //!< Total sigop cost
     int64_t feeDelta;          //!< Used for determining the priority of the transaction for mining in a block
     LockPoints lockPoints;     //!< Track the height and time at which tx was final
@@ -89,6 +94,11 @@ private:
     CAmount nModFeesWithAncestors;
     int64_t nSigOpCostWithAncestors;
 
+    const uint32_t nTxWeight;       //!< Cached to avoid recomputing tx weight (also used for GetTxSize())
+    const uint32_t nUsageSize;      //!< ... and total memory usage
+    const unsigned int entryHeight; //!< Chain height when entering the mempool
+    const bool spendsCoinbase;      //!< keep track of transactions that spend a coinbase
+
 public:
     CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                     int64_t _nTime, unsigned int _entryHeight,
@@ -129,6 +139,9 @@ public:
     int64_t GetSigOpCostWithAncestors() const { return nSigOpCostWithAncestors; }
 
     mutable size_t vTxHashesIdx; //!< Index in mempool's vTxHashes
+    mutable uint64_t m_epoch{0}; //!< Epoch of the last traversal that visited this entry, see CTxMemPool::visited()
+    mutable Links m_parents;     //!< In-mempool parents, managed by CTxMemPool
+    mutable Links m_children;    //!< In-mempool children, managed by CTxMemPool
 };
 
 // Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
@@ -342,6 +355,43 @@ struct TxMempoolInfo
     int64_t nFeeDelta;
 };
 
+/**
+ * An immutable copy of the mempool's entries, taken under CTxMemPool::cs and
+ * read without it. See CTxMemPool::GetSnapshot().
+ */
+struct MemPoolSnapshot
+{
+    struct Entry
+    {
+        CTransactionRef tx;
+        CAmount fee;
+        CAmount modified_fee;
+        size_t vsize;
+        size_t weight;
+        std::chrono::seconds time;
+        unsigned int height;
+        uint64_t count_with_descendants;
+        uint64_t size_with_descendants;
+        CAmount mod_fees_with_descendants;
+        uint64_t count_with_ancestors;
+        uint64_t size_with_ancestors;
+        CAmount mod_fees_with_ancestors;
+        std::vector<uint256> depends; //!< In-mempool parents, sorted by txid
+        std::vector<uint256> spentby; //!< In-mempool children, sorted by txid
+        bool bip125_replaceable{false}; //!< Whether the tx or any in-mempool ancestor signals BIP125
+    };
+
+    //! Value of the mempool's snapshot sequence when the copy was taken
+    uint64_t sequence{0};
+    //! Entries in depth and score order, so parents come before their children
+    std::vector<Entry> entries;
+    //! (txid, index into entries), sorted by txid
+    std::vector<std::pair<uint256, size_t>> by_txid;
+
+    /** Returns the entry for txid, or nullptr if it was not in the mempool */
+    const Entry* Find(const uint256& txid) const;
+};
+
 /** Reason why a transaction was removed from the mempool,
  * this is passed to the notification signal.
  */
@@ -395,8 +445,9 @@ public:
  *
  * In order for the feerate sort to remain correct, we must update transactions
  * in the mempool when new descendants arrive.  To facilitate this, we track
- * the set of in-mempool direct parents and direct children in mapLinks.  Within
- * each CTxMemPoolEntry, we track the size and fees of all descendants.
+ * the in-mempool direct parents and direct children on each CTxMemPoolEntry.
+ * Within each CTxMemPoolEntry, we also track the size and fees of all
+ * descendants.
  *
  * Usually when a new transaction is added to the mempool, it has no in-mempool
  * children (because any such children would be an orphan).  So in
@@ -428,7 +479,7 @@ public:
  * state, to account for in-mempool, out-of-block descendants for all the
  * in-block transactions by calling UpdateTransactionsFromBlock().  Note that
  * until this is called, the mempool state is not consistent, and in particular
- * mapLinks may not be correct (and therefore functions like
+ * the parent and child links may not be correct (and therefore functions like
  * CalculateMemPoolAncestors() and CalculateDescendants() that rely
  * on them to walk the mempool are not generally safe to use).
  *
@@ -528,25 +579,75 @@ public:
     };
     typedef std::set<txiter, CompareIteratorByHash> setEntries;
 
-    const setEntries & GetMemPoolParents(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
-    const setEntries & GetMemPoolChildren(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
-    uint64_t CalculateDescendantMaximum(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
-private:
-    typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
+    /**
+     * The in-mempool parents or children of an entry, iterated as txiters in
+     * txid order. Only valid while the entry stays in the mempool and the
+     * links are not modified.
+     */
+    class LinkedEntries
+    {
+    public:
+        class const_iterator
+        {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef txiter value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const txiter* pointer;
+            typedef txiter reference;
+
+            const_iterator(const indexed_transaction_set& map, CTxMemPoolEntry::Links::const_iterator it) : m_map(&map), m_it(it) {}
+            txiter operator*() const { return m_map->iterator_to(**m_it); }
+            const_iterator& operator++() { ++m_it; return *this; }
+            const_iterator operator++(int) { const_iterator ret = *this; ++m_it; return ret; }
+            bool operator==(const const_iterator& other) const { return m_it == other.m_it; }
+            bool operator!=(const const_iterator& other) const { return m_it != other.m_it; }
+
+        private:
+            const indexed_transaction_set* m_map;
+            CTxMemPoolEntry::Links::const_iterator m_it;
+        };
+
+        LinkedEntries(const indexed_transaction_set& map, const CTxMemPoolEntry::Links& links) : m_map(map), m_links(links) {}
+        const_iterator begin() const { return const_iterator(m_map, m_links.begin()); }
+        const_iterator end() const { return const_iterator(m_map, m_links.end()); }
+        size_t size() const { return m_links.size(); }
+        bool empty() const { return m_links.empty(); }
 
-    struct TxLinks {
-        setEntries parents;
-        setEntries children;
+    private:
+        const indexed_transaction_set& m_map;
+        const CTxMemPoolEntry::Links& m_links;
     };
 
-    typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
-    txlinksMap mapLinks;
+    LinkedEntries GetMemPoolParents(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    LinkedEntries GetMemPoolChildren(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    uint64_t CalculateDescendantMaximum(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+private:
+    typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
+    //! Add or remove link in links, keeping cachedInnerUsage in step with its capacity
+    void UpdateLinks(CTxMemPoolEntry::Links& links, const CTxMemPoolEntry& link, bool add);
 
     std::vector<indexed_transaction_set::const_iterator> GetSortedDepthAndScore() const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    mutable uint64_t m_epoch{0};
+    mutable bool m_has_epoch_guard{false};
+
+    //! Bumped under cs by every change a snapshot would show
+    std::atomic<uint64_t> m_snapshot_sequence{1};
+    //! May be taken under cs, but cs is never taken while holding it
+    mutable Mutex m_snapshot_mutex;
+    //! Latest snapshot, for as long as some reader still holds it
+    mutable std::weak_ptr<const MemPoolSnapshot> m_snapshot GUARDED_BY(m_snapshot_mutex);
+    void InvalidateSnapshot() EXCLUSIVE_LOCKS_REQUIRED(cs) { ++m_snapshot_sequence; }
+    /** Returns the latest snapshot if it is still held and up to date, otherwise nullptr */
+    std::shared_ptr<const MemPoolSnapshot> GetCachedSnapshot() const LOCKS_EXCLUDED(m_snapshot_mutex);
+    //! Scratch space for traversals, which the EpochGuard keeps from nesting
+    mutable std::vector<txiter> m_walk_stage GUARDED_BY(cs);
+    mutable std::vector<txiter> m_walk_found GUARDED_BY(cs);
+
 public:
     indirectmap<COutPoint, const CTransaction*> mapNextTx GUARDED_BY(cs);
     std::map<uint256, CAmount> mapDeltas;
@@ -583,6 +684,15 @@ public:
     void _clear() EXCLUSIVE_LOCKS_REQUIRED(cs); //lock free
     bool CompareDepthAndScore(const uint256& hasha, const uint256& hashb);
     void queryHashes(std::vector<uint256>& vtxid) const;
+    /**
+     * Return a consistent, immutable view of all entries. Readers share the
+     * latest snapshot without taking cs while it is up to date and one of
+     * them still holds it. Otherwise only copying the entries holds cs; they
+     * are ordered and their BIP125 flags worked out after releasing it.
+     */
+    std::shared_ptr<const MemPoolSnapshot> GetSnapshot() const;
+    /** Copy one entry for a snapshot. bip125_replaceable is left to the caller. */
+    MemPoolSnapshot::Entry GetSnapshotEntry(txiter it) const EXCLUSIVE_LOCKS_REQUIRED(cs);
     bool isSpent(const COutPoint& outpoint) const;
     unsigned int GetTransactionsUpdated() const;
     void AddTransactionsUpdated(unsigned int n);
@@ -634,7 +744,7 @@ public:
      *  limitDescendantSize = max size of descendants any ancestor can have
      *  errString = populated with error reason if any limits are hit
      *  fSearchForParents = whether to search a tx's vin for in-mempool parents, or
-     *    look up parents from mapLinks. Must be true for entries not in the mempool
+     *    look up parents from the entry's links. Must be true for entries not in the mempool
      */
     bool CalculateMemPoolAncestors(const CTxMemPoolEntry& entry, setEntries& setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string& errString, bool fSearchForParents = true) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
@@ -643,6 +753,34 @@ public:
      *  already in it.  */
     void CalculateDescendants(txiter it, setEntries& setDescendants) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    /**
+     * Starts a new epoch for a graph traversal over the mempool for as long
+     * as it is in scope. Walking ancestors or descendants visits an entry
+     * once per epoch, which is tracked by a counter on the entry rather than
+     * by a set of visited entries, so walks do not allocate. Traversals do
+     * not nest.
+     */
+    class EpochGuard
+    {
+        const CTxMemPool& pool;
+
+    public:
+        explicit EpochGuard(const CTxMemPool& in);
+        ~EpochGuard();
+    };
+
+    /**
+     * Mark an entry as visited in the current epoch. Returns whether it was
+     * visited already. Requires an EpochGuard to be in scope.
+     */
+    bool visited(txiter it) const EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        assert(m_has_epoch_guard);
+        const bool ret = it->m_epoch >= m_epoch;
+        it->m_epoch = std::max(it->m_epoch, m_epoch);
+        return ret;
+    }
+
     /** The minimum fee to get into the mempool, which may itself not be enough
       *  for larger-sized transactions.
       *  The incrementalRelayFee policy variable is used to bound the time it
@@ -14,12 +14,15 @@
 #include <consensus/tx_check.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <core_memusage.h>
 #include <cuckoocache.h>
 #include <flatfile.h>
 #include <hash.h>
 #include <index/txindex.h>
 #include <logging.h>
 #include <logging/timer.h>
+#include <node/coinstats.h>
+#include <node/utxo_snapshot.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
@@ -31,6 +34,8 @@
 #include <script/script.h>
 #include <script/sigcache.h>
 #include <shutdown.h>
+#include <streams.h>
+#include <threadinterrupt.h>
 #include <timedata.h>
 #include <tinyformat.h>
 #include <txdb.h>
@@ -47,11 +52,25 @@
 #include <validationinterface.h>
 #include <warnings.h>
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <list>
 #include <string>
+#include <thread>
+#include <unordered_set>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #if defined(NDEBUG)
 # error "Bitcoin cannot be compiled without assertions."
 #endif
@@ -82,6 +101,7 @@ BlockManager g_blockman;
 } // anon namespace
 
 std::unique_ptr<CChainState> g_chainstate;
+std::unique_ptr<CChainState> g_ibd_chainstate;
 
 CChainState& ChainstateActive() {
     assert(g_chainstate);
@@ -110,6 +130,8 @@ Mutex g_best_block_mutex;
 std::condition_variable g_best_block_cv;
 uint256 g_best_block;
 bool g_parallel_script_checks{false};
+bool g_parallel_coin_prefetch{false};
+bool g_background_coins_flush{DEFAULT_BACKGROUND_FLUSH};
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fHavePruned = false;
@@ -1110,6 +1132,92 @@ bool GetTransaction(const uint256& hash, CTransactionRef& txOut, const Consensus
 // CBlock and CBlockIndex
 //
 
+#ifndef WIN32
+namespace {
+/** A read-only memory map of a finalized block file, which is never written again. */
+class MappedBlockFile
+{
+public:
+    const uint8_t* data{nullptr};
+    size_t size{0};
+
+    explicit MappedBlockFile(const fs::path& path)
+    {
+        const int fd = open(path.string().c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (addr != MAP_FAILED) {
+                data = static_cast<const uint8_t*>(addr);
+                size = st.st_size;
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedBlockFile()
+    {
+        if (data) munmap(const_cast<uint8_t*>(data), size);
+    }
+
+    MappedBlockFile(const MappedBlockFile&) = delete;
+    MappedBlockFile& operator=(const MappedBlockFile&) = delete;
+};
+
+/**
+ * Maximum number of block files kept mapped. This only costs address space,
+ * but up to MAX_BLOCKFILE_SIZE of it per file, so 32-bit builds do not map
+ * block files at all.
+ */
+static constexpr size_t MAX_MAPPED_BLOCK_FILES = 64;
+
+Mutex g_mapped_block_files_mutex;
+/** Maps of finalized block files, most recently used first */
+std::list<std::pair<int, std::shared_ptr<const MappedBlockFile>>> g_mapped_block_files GUARDED_BY(g_mapped_block_files_mutex);
+} // namespace
+
+/**
+ * Get a memory map of a block file, if it is finalized. Blocks are then read
+ * from the page cache without opening the file and copying it through stdio.
+ */
+static std::shared_ptr<const MappedBlockFile> GetMappedBlockFile(int nFile)
+{
+    if (sizeof(void*) < 8) return nullptr;
+    {
+        LOCK(cs_LastBlockFile);
+        if (nFile < 0 || nFile >= nLastBlockFile) return nullptr;
+    }
+
+    LOCK(g_mapped_block_files_mutex);
+    for (auto it = g_mapped_block_files.begin(); it != g_mapped_block_files.end(); ++it) {
+        if (it->first == nFile) {
+            g_mapped_block_files.splice(g_mapped_block_files.begin(), g_mapped_block_files, it);
+            return it->second;
+        }
+    }
+
+    auto mapped = std::make_shared<const MappedBlockFile>(BlockFileSeq().FileName(FlatFilePos(nFile, 0)));
+    if (!mapped->data) return nullptr;
+    g_mapped_block_files.emplace_front(nFile, mapped);
+    if (g_mapped_block_files.size() > MAX_MAPPED_BLOCK_FILES) {
+        g_mapped_block_files.pop_back();
+    }
+    return mapped;
+}
+#endif
+
+/** Drop the memory map of a block file, or of all of them if nFile is negative. */
+static void UnmapBlockFile(int nFile)
+{
+#ifndef WIN32
+    LOCK(g_mapped_block_files_mutex);
+    g_mapped_block_files.remove_if([nFile](const std::pair<int, std::shared_ptr<const MappedBlockFile>>& entry) {
+        return nFile < 0 || entry.first == nFile;
+    });
+#endif
+}
+
 static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
@@ -1173,6 +1281,31 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
 
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start)
 {
+#ifndef WIN32
+    if (std::shared_ptr<const MappedBlockFile> mapped = GetMappedBlockFile(pos.nFile)) {
+        const size_t header_size = CMessageHeader::MESSAGE_START_SIZE + sizeof(uint32_t);
+        if (pos.nPos < header_size || pos.nPos > mapped->size) {
+            return error("%s: Block position out of range of block file for %s", __func__, pos.ToString());
+        }
+        const uint8_t* header = mapped->data + pos.nPos - header_size;
+        if (memcmp(header, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
+            return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
+                    HexStr(header, header + CMessageHeader::MESSAGE_START_SIZE),
+                    HexStr(message_start, message_start + CMessageHeader::MESSAGE_START_SIZE));
+        }
+        const uint32_t blk_size = ReadLE32(header + CMessageHeader::MESSAGE_START_SIZE);
+        if (blk_size > MAX_SIZE) {
+            return error("%s: Block data is larger than maximum deserialization size for %s: %s versus %s", __func__, pos.ToString(),
+                    blk_size, MAX_SIZE);
+        }
+        if (blk_size > mapped->size - pos.nPos) {
+            return error("%s: Read from block file failed: end of data for %s", __func__, pos.ToString());
+        }
+        block.assign(mapped->data + pos.nPos, mapped->data + pos.nPos + blk_size);
+        return true;
+    }
+#endif
+
     FlatFilePos hpos = pos;
     hpos.nPos -= 8; // Seek back 8 bytes for meta header
     CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
@@ -1236,7 +1369,8 @@ CoinsViews::CoinsViews(
     bool in_memory,
     bool should_wipe) : m_dbview(
                             GetDataDir() / ldb_name, cache_size_bytes, in_memory, should_wipe),
-                        m_catcherview(&m_dbview) {}
+                        m_flushbuffer(m_dbview),
+                        m_catcherview(&m_flushbuffer) {}
 
 void CoinsViews::InitCache()
 {
@@ -1245,7 +1379,8 @@ void CoinsViews::InitCache()
 
 // NOTE: for now m_blockman is set to a global, but this will be changed
 // in a future commit.
-CChainState::CChainState() : m_blockman(g_blockman) {}
+CChainState::CChainState(const uint256& from_snapshot_blockhash)
+    : m_blockman(g_blockman), m_from_snapshot_blockhash(from_snapshot_blockhash) {}
 
 
 void CChainState::InitCoinsDB(
@@ -1254,6 +1389,7 @@ void CChainState::InitCoinsDB(
     bool should_wipe,
     std::string leveldb_name)
 {
+    m_coinsdb_cache_size_bytes = cache_size_bytes;
     m_coins_views = MakeUnique<CoinsViews>(
         leveldb_name, cache_size_bytes, in_memory, should_wipe);
 }
@@ -1262,6 +1398,37 @@ void CChainState::InitCoinsCache()
 {
     assert(m_coins_views != nullptr);
     m_coins_views->InitCache();
+    m_coinstip_cache_size_bytes = nCoinCacheUsage;
+}
+
+bool CChainState::LoadRollingCoinStats()
+{
+    AssertLockHeld(cs_main);
+    const uint256 best_block = CoinsDB().GetBestBlock();
+    if (best_block.IsNull()) {
+        m_rolling_coin_stats = RollingCoinStats();
+        return true;
+    }
+    if (CoinsDB().ReadRollingCoinStats(best_block, m_rolling_coin_stats)) return true;
+
+    LogPrintf("Computing the rolling UTXO set hash at %s, this may take a while\n", best_block.ToString());
+    const int64_t start = GetTimeMillis();
+    if (!ComputeRollingCoinStats(&CoinsDB(), m_rolling_coin_stats, [] { return ShutdownRequested(); })) {
+        return false;
+    }
+    LogPrintf("Computed the rolling UTXO set hash over %d coins in %dms\n", m_rolling_coin_stats.coins_count, GetTimeMillis() - start);
+    return true;
+}
+
+void CChainState::ResizeCoinsCache(size_t coinstip_size)
+{
+    AssertLockHeld(cs_main);
+    m_coinstip_cache_size_bytes = coinstip_size;
+
+    BlockValidationState state;
+    if (!FlushStateToDisk(Params(), state, FlushStateMode::IF_NEEDED)) {
+        LogPrintf("%s: failed to flush state (%s)\n", __func__, FormatStateMessage(state));
+    }
 }
 
 // Note that though this is marked const, we may end up modifying `m_cached_finished_ibd`, which
@@ -1772,6 +1939,55 @@ void ThreadScriptCheck(int worker_num) {
     scriptcheckqueue.Thread();
 }
 
+/**
+ * Closure representing one block input to be read from the coins database
+ * ahead of ConnectBlock. The result is stored in a slot owned by the caller,
+ * which must outlive the check.
+ */
+class CCoinPrefetch
+{
+public:
+    struct Slot {
+        COutPoint outpoint;
+        Coin coin;
+        bool found{false};
+    };
+
+private:
+    const CCoinsView* m_view{nullptr};
+    Slot* m_slot{nullptr};
+
+public:
+    CCoinPrefetch() {}
+    CCoinPrefetch(const CCoinsView* view, Slot* slot) : m_view(view), m_slot(slot) {}
+
+    bool operator()()
+    {
+        try {
+            m_slot->found = m_view->GetCoin(m_slot->outpoint, m_slot->coin);
+        } catch (const std::exception&) {
+            // Leave the input to ConnectBlock, which reads it again through
+            // CCoinsViewErrorCatcher and handles the failure there.
+            m_slot->found = false;
+        }
+        // Prefetching is best-effort; never abort the remaining batch.
+        return true;
+    }
+
+    void swap(CCoinPrefetch& check)
+    {
+        std::swap(m_view, check.m_view);
+        std::swap(m_slot, check.m_slot);
+    }
+};
+
+static CCheckQueue<CCoinPrefetch> coinprefetchqueue(16);
+
+void ThreadCoinPrefetch(int worker_num) {
+    util::ThreadRename(strprintf("prefetch.%i", worker_num));
+    coinprefetchqueue.Thread();
+}
+
 VersionBitsCache versionbitscache GUARDED_BY(cs_main);
 
 int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Params& params)
@@ -2195,14 +2411,22 @@ bool CChainState::FlushStateToDisk(
     LOCK(cs_main);
     assert(this->CanFlushToDisk());
     static int64_t nLastWrite = 0;
-    static int64_t nLastFlush = 0;
     std::set<int> setFilesToPrune;
     bool full_flush_completed = false;
 
     const size_t coins_count = CoinsTip().GetCacheSize();
     const size_t coins_mem_usage = CoinsTip().DynamicMemoryUsage();
+    CCoinsViewFlushBuffer& flush_buffer = m_coins_views->m_flushbuffer;
 
     try {
+    // Release the coins of a completed background flush.
+    if (flush_buffer.FlushDone() && flush_buffer.IsFlushing()) {
+        if (!flush_buffer.WaitForFlush()) {
+            return AbortNode(state, "Failed to write to coin database");
+        }
+        m_coins_flush_stats.last_write_time = flush_buffer.LastWriteTime();
+        LogPrint(BCLog::BENCH, "Background coins flush completed in %.2fms\n", m_coins_flush_stats.last_write_time * MILLI);
+    }
     {
         bool fFlushForPrune = false;
         bool fDoFullFlush = false;
@@ -2231,12 +2455,19 @@ bool CChainState::FlushStateToDisk(
         if (nLastWrite == 0) {
             nLastWrite = nNow;
         }
-        if (nLastFlush == 0) {
-            nLastFlush = nNow;
+        if (m_last_flush == 0) {
+            m_last_flush = nNow;
         }
+        // Only the active chainstate may use the unused mempool space.
+        const bool is_active = this == g_chainstate.get();
         int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
         int64_t cacheSize = CoinsTip().DynamicMemoryUsage();
-        int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
+        int64_t nTotalSpace = m_coinstip_cache_size_bytes + (is_active ? std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0) : 0);
+        if (g_background_coins_flush) {
+            // The cache shares its space with the coins of the previous flush
+            // while those are being written.
+            nTotalSpace /= 2;
+        }
         // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now (not in the middle of a block processing).
         bool fCacheLarge = mode == FlushStateMode::PERIODIC && cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
         // The cache is over the limit, we have to write now.
@@ -2244,7 +2475,7 @@ bool CChainState::FlushStateToDisk(
         // It's been a while since we wrote the block index to disk. Do this frequently, so we don't need to redownload after a crash.
         bool fPeriodicWrite = mode == FlushStateMode::PERIODIC && nNow > nLastWrite + (int64_t)DATABASE_WRITE_INTERVAL * 1000000;
         // It's been very long since we flushed the cache. Do this infrequently, to optimize cache usage.
-        bool fPeriodicFlush = mode == FlushStateMode::PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
+        bool fPeriodicFlush = mode == FlushStateMode::PERIODIC && nNow > m_last_flush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
         // Combine all conditions that result in a full cache flush.
         fDoFullFlush = (mode == FlushStateMode::ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
         // Write blocks and block index to disk.
@@ -2301,14 +2532,36 @@ bool CChainState::FlushStateToDisk(
             if (!CheckDiskSpace(GetDataDir(), 48 * 2 * 2 * CoinsTip().GetCacheSize())) {
                 return AbortNode(state, "Disk space is too low!", _("Error: Disk space is too low!").translated, CClientUIInterface::MSG_NOPREFIX);
             }
-            // Flush the chainstate (which may refer to block index entries).
-            if (!CoinsTip().Flush())
+            // Keyed by block, so that the statistics can be matched with the coins on disk.
+            if (!CoinsDB().WriteRollingCoinStats(CoinsTip().GetBestBlock(), m_rolling_coin_stats))
                 return AbortNode(state, "Failed to write to coin database");
-            nLastFlush = nNow;
+            // Routine flushes are written in the background if enabled. Others
+            // need the coins on disk right away: for shutdown, for readers of
+            // the database, or because the pruned blocks cannot be replayed.
+            const bool background = g_background_coins_flush && !fFlushForPrune &&
+                (mode == FlushStateMode::IF_NEEDED || mode == FlushStateMode::PERIODIC);
+            const int64_t pause_start = GetTimeMicros();
+            // Flush the chainstate (which may refer to block index entries).
+            if (background) {
+                if (!flush_buffer.FlushInBackground(CoinsTip()))
+                    return AbortNode(state, "Failed to write to coin database");
+                ++m_coins_flush_stats.background_count;
+            } else {
+                if (!CoinsTip().Flush())
+                    return AbortNode(state, "Failed to write to coin database");
+            }
+            const int64_t pause_time = GetTimeMicros() - pause_start;
+            if (!background) m_coins_flush_stats.last_write_time = pause_time;
+            ++m_coins_flush_stats.count;
+            m_coins_flush_stats.last_pause_time = pause_time;
+            m_coins_flush_stats.max_pause_time = std::max(m_coins_flush_stats.max_pause_time, pause_time);
+            m_coins_flush_stats.total_pause_time += pause_time;
+            LogPrint(BCLog::BENCH, "Coins flush%s held up validation for %.2fms\n", background ? " (background)" : "", pause_time * MILLI);
+            m_last_flush = nNow;
             full_flush_completed = true;
         }
     }
-    if (full_flush_completed) {
+    if (full_flush_completed && this == g_chainstate.get()) {
         // Update best block in wallet (so we can detect restored wallets).
         GetMainSignals().ChainStateFlushed(m_chain.GetLocator());
     }
@@ -2429,6 +2682,7 @@ bool CChainState::DisconnectTip(BlockValidationState& state, const CChainParams&
         assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
         if (DisconnectBlock(block, pindexDelete, view) != DISCONNECT_OK)
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
+        m_rolling_coin_stats.ApplyChanges(view);
         bool flushed = view.Flush();
         assert(flushed);
     }
@@ -2459,12 +2713,302 @@ bool CChainState::DisconnectTip(BlockValidationState& state, const CChainParams&
     return true;
 }
 
+/** Maximum number of threads reading blocks ahead of the thread applying them. */
+static constexpr int MAX_BLOCK_READ_THREADS = 16;
+/** Number of blocks each read-ahead thread may read ahead of the consumer. */
+static constexpr size_t BLOCK_READ_AHEAD_PER_THREAD = 4;
+/** Maximum number of blocks ActivateBestChain lines up for reading ahead at once. */
+static constexpr int MAX_BLOCK_READ_AHEAD = 1024;
+
+static int GetBlockReadThreads()
+{
+    return std::max(1, std::min(GetNumCores(), MAX_BLOCK_READ_THREADS));
+}
+
+/**
+ * Reads a list of blocks, and optionally checks them, on worker threads,
+ * while the calling thread consumes them in list order. Workers run at most a
+ * window of blocks ahead of the consumer, which bounds the memory used by
+ * blocks in flight. The block positions are taken up front, as the consumer
+ * usually holds cs_main.
+ */
+class BlockCheckPipeline
+{
+public:
+    /** Checks a block that was read, returning an error message on failure. */
+    using CheckFn = std::function<std::string(const CBlockIndex*, const CBlock&)>;
+
+    BlockCheckPipeline(std::vector<CBlockIndex*> blocks, const Consensus::Params& params, CheckFn check, int threads) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+        : m_blocks(std::move(blocks)), m_params(params), m_check(std::move(check)), m_slots(threads * BLOCK_READ_AHEAD_PER_THREAD)
+    {
+        m_positions.reserve(m_blocks.size());
+        for (const CBlockIndex* pindex : m_blocks) {
+            m_positions.push_back(pindex->GetBlockPos());
+        }
+        for (int i = 0; i < threads; ++i) {
+            m_threads.emplace_back([this] { Run(); });
+        }
+    }
+
+    ~BlockCheckPipeline() { Stop(); }
+
+    /** Stop reading ahead and wait for the worker threads to exit. */
+    void Stop()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+        m_threads.clear();
+    }
+
+    size_t size() const { return m_blocks.size(); }
+    CBlockIndex* operator[](size_t i) const { return m_blocks[i]; }
+
+    /** Time spent reading, checking, and waiting for blocks in the consumer, in microseconds. */
+    int64_t ReadTime() const { return m_time_read; }
+    int64_t CheckTime() const { return m_time_check; }
+    int64_t WaitTime() const { return m_time_wait; }
+
+    /** Wait for the i-th block, which must be consumed in order. Returns false and sets error if it could not be read or checked. */
+    bool Take(size_t i, CBlock& block, std::string& error)
+    {
+        const int64_t time_start = GetTimeMicros();
+        Slot& slot = m_slots[i % m_slots.size()];
+        {
+            WAIT_LOCK(m_mutex, lock);
+            assert(i == m_consumed);
+            m_cv.wait(lock, [&] { return slot.done; });
+            block = std::move(slot.block);
+            error = std::move(slot.error);
+            slot.block.SetNull();
+            slot.done = false;
+            ++m_consumed;
+        }
+        m_cv.notify_all();
+        m_time_wait += GetTimeMicros() - time_start;
+        return error.empty();
+    }
+
+private:
+    struct Slot {
+        CBlock block;
+        std::string error;
+        bool done{false};
+    };
+
+    std::string ReadAndCheck(size_t i, CBlock& block)
+    {
+        const CBlockIndex* pindex = m_blocks[i];
+        const int64_t time_start = GetTimeMicros();
+        const bool read = ReadBlockFromDisk(block, m_positions[i], m_params) && block.GetHash() == pindex->GetBlockHash();
+        const int64_t time_read = GetTimeMicros();
+        m_time_read += time_read - time_start;
+        if (!read) {
+            return strprintf("ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+        }
+        if (!m_check) return {};
+        std::string error = m_check(pindex, block);
+        m_time_check += GetTimeMicros() - time_read;
+        return error;
+    }
+
+    void Run()
+    {
+        while (true) {
+            size_t i;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cv.wait(lock, [&] { return m_stop || m_next >= m_blocks.size() || m_next < m_consumed + m_slots.size(); });
+                if (m_stop || m_next >= m_blocks.size()) return;
+                i = m_next++;
+            }
+            CBlock block;
+            std::string error;
+            try {
+                error = ReadAndCheck(i, block);
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+            {
+                LOCK(m_mutex);
+                Slot& slot = m_slots[i % m_slots.size()];
+                slot.block = std::move(block);
+                slot.error = std::move(error);
+                slot.done = true;
+            }
+            m_cv.notify_all();
+        }
+    }
+
+    const std::vector<CBlockIndex*> m_blocks;
+    std::vector<FlatFilePos> m_positions;
+    const Consensus::Params& m_params;
+    const CheckFn m_check;
+    std::vector<Slot> m_slots;
+    std::vector<std::thread> m_threads;
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    size_t m_next GUARDED_BY(m_mutex){0};
+    size_t m_consumed GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::atomic<int64_t> m_time_read{0};
+    std::atomic<int64_t> m_time_check{0};
+    int64_t m_time_wait{0};
+};
+
+/** Runs CheckBlock on a block read by a BlockCheckPipeline. A passing block is marked as checked, so ConnectBlock does not check it again. */
+static std::string CheckBlockForPipeline(const CBlockIndex* pindex, const CBlock& block, const Consensus::Params& params)
+{
+    BlockValidationState state;
+    if (!CheckBlock(block, state, params)) {
+        return strprintf("found bad block at %d, hash=%s (%s)", pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
+    }
+    return {};
+}
+
+static int64_t nTimeReadAheadRead = 0;
+static int64_t nTimeReadAheadCheck = 0;
+static int64_t nTimeReadAheadWait = 0;
+static uint64_t nReadAheadBlocks = 0;
+
+/**
+ * Reads and checks the blocks ActivateBestChain is about to connect on worker
+ * threads, so that reading them from disk overlaps with connecting their
+ * predecessors. This is what makes -reindex-chainstate and connecting blocks
+ * that were downloaded out of order mostly CPU-bound.
+ */
+class BlockReadAhead
+{
+public:
+    explicit BlockReadAhead(const Consensus::Params& params) : m_params(params) {}
+
+    ~BlockReadAhead() { Reset(); }
+
+    /**
+     * Get pindex, the next block to connect towards pindexMostWork. Returns
+     * nullptr if the block was not or could not be read ahead, in which case
+     * ConnectTip reads it itself and reports any failure.
+     */
+    std::shared_ptr<const CBlock> Take(CBlockIndex* pindex, CBlockIndex* pindexMostWork) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+    {
+        if (!m_pipeline || m_next >= m_pipeline->size() || (*m_pipeline)[m_next] != pindex) {
+            Reset();
+            // Only read ahead if more blocks are to be connected after this one.
+            if (pindexMostWork->nHeight <= pindex->nHeight || pindexMostWork->GetAncestor(pindex->nHeight) != pindex) return nullptr;
+            std::vector<CBlockIndex*> blocks;
+            for (CBlockIndex* pindexIter = pindexMostWork->GetAncestor(std::min(pindexMostWork->nHeight, pindex->nHeight + MAX_BLOCK_READ_AHEAD - 1)); pindexIter != pindex->pprev; pindexIter = pindexIter->pprev) {
+                blocks.push_back(pindexIter);
+            }
+            std::reverse(blocks.begin(), blocks.end());
+            const Consensus::Params& params = m_params;
+            const int threads = std::min<int>(GetBlockReadThreads(), blocks.size());
+            m_pipeline = MakeUnique<BlockCheckPipeline>(std::move(blocks), m_params, [&params](const CBlockIndex* block_index, const CBlock& block) {
+                return CheckBlockForPipeline(block_index, block, params);
+            }, threads);
+        }
+        auto block = std::make_shared<CBlock>();
+        std::string error;
+        if (!m_pipeline->Take(m_next++, *block, error)) {
+            LogPrint(BCLog::BENCH, "Reading block ahead failed: %s\n", error);
+            return nullptr;
+        }
+        ++nReadAheadBlocks;
+        return block;
+    }
+
+private:
+    void Reset()
+    {
+        if (!m_pipeline) return;
+        m_pipeline->Stop();
+        nTimeReadAheadRead += m_pipeline->ReadTime();
+        nTimeReadAheadCheck += m_pipeline->CheckTime();
+        nTimeReadAheadWait += m_pipeline->WaitTime();
+        LogPrint(BCLog::BENCH, "- Read ahead %u of %u blocks: read %.2fms, check %.2fms, wait %.2fms [%u blocks, %.2fs, %.2fs, %.2fs]\n",
+            m_next, m_pipeline->size(), m_pipeline->ReadTime() * MILLI, m_pipeline->CheckTime() * MILLI, m_pipeline->WaitTime() * MILLI,
+            nReadAheadBlocks, nTimeReadAheadRead * MICRO, nTimeReadAheadCheck * MICRO, nTimeReadAheadWait * MICRO);
+        m_pipeline.reset();
+        m_next = 0;
+    }
+
+    const Consensus::Params& m_params;
+    std::unique_ptr<BlockCheckPipeline> m_pipeline;
+    size_t m_next{0};
+};
+
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
 static int64_t nTimePostConnect = 0;
 
+static uint64_t nPrefetchCached = 0;
+static uint64_t nPrefetchHits = 0;
+static uint64_t nPrefetchMisses = 0;
+
+void CChainState::PrefetchBlockInputs(const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+    CCoinsViewCache& cache = CoinsTip();
+
+    // Outputs created within this block are not in the database yet, so
+    // there is no point in looking them up.
+    std::unordered_set<uint256, SaltedTxidHasher> block_txids;
+    block_txids.reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        block_txids.insert(tx->GetHash());
+    }
+
+    std::vector<CCoinPrefetch::Slot> slots;
+    unsigned int cached = 0;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (block_txids.count(txin.prevout.hash)) continue;
+            if (cache.HaveCoinInCache(txin.prevout)) {
+                ++cached;
+                continue;
+            }
+            slots.emplace_back();
+            slots.back().outpoint = txin.prevout;
+        }
+    }
+    nPrefetchCached += cached;
+    if (slots.empty()) return;
+
+    {
+        // Read through the flush buffer: while a background flush is in
+        // progress the database alone is not up to date. It is only changed
+        // under cs_main, which we hold, so the worker threads read a
+        // consistent state.
+        CCheckQueueControl<CCoinPrefetch> control(&coinprefetchqueue);
+        std::vector<CCoinPrefetch> vChecks;
+        vChecks.reserve(slots.size());
+        for (CCoinPrefetch::Slot& slot : slots) {
+            vChecks.emplace_back(&m_coins_views->m_flushbuffer, &slot);
+        }
+        control.Add(vChecks);
+        control.Wait();
+    }
+
+    unsigned int hits = 0;
+    for (CCoinPrefetch::Slot& slot : slots) {
+        if (slot.found && cache.WarmCoin(slot.outpoint, std::move(slot.coin))) ++hits;
+    }
+    const unsigned int misses = slots.size() - hits;
+    nPrefetchHits += hits;
+    nPrefetchMisses += misses;
+    const uint64_t total = nPrefetchHits + nPrefetchMisses;
+    LogPrint(BCLog::BENCH, "    - Prefetch: %u inputs (%u cached, %u fetched, %u missed) [hit rate %.1f%% (%u/%u)]\n",
+        cached + slots.size(), cached, hits, misses, total ? 100.0 * nPrefetchHits / total : 0.0, nPrefetchHits, total);
+}
+
 struct PerBlockConnectTrace {
     CBlockIndex* pindex = nullptr;
     std::shared_ptr<const CBlock> pblock;
@@ -2552,6 +3096,12 @@ bool CChainState::ConnectTip(BlockValidationState& state, const CChainParams& ch
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    if (g_parallel_coin_prefetch) {
+        PrefetchBlockInputs(blockConnecting);
+        int64_t nTime2a = GetTimeMicros(); nTimePrefetch += nTime2a - nTime2;
+        LogPrint(BCLog::BENCH, "  - Prefetch inputs: %.2fms [%.2fs]\n", (nTime2a - nTime2) * MILLI, nTimePrefetch * MICRO);
+        nTime2 = nTime2a;
+    }
     {
         CCoinsViewCache view(&CoinsTip());
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
@@ -2561,6 +3111,7 @@ bool CChainState::ConnectTip(BlockValidationState& state, const CChainParams& ch
                 InvalidBlockFound(pindexNew, state);
             return error("%s: ConnectBlock %s failed, %s", __func__, pindexNew->GetBlockHash().ToString(), FormatStateMessage(state));
         }
+        m_rolling_coin_stats.ApplyChanges(view);
         nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
         LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime3 - nTime2) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
         bool flushed = view.Flush();
@@ -2588,6 +3139,35 @@ bool CChainState::ConnectTip(BlockValidationState& state, const CChainParams& ch
     return true;
 }
 
+bool CChainState::ConnectBackgroundTip(BlockValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew)
+{
+    AssertLockHeld(cs_main);
+    assert(pindexNew->pprev == m_chain.Tip());
+
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindexNew, chainparams.GetConsensus()))
+        return AbortNode(state, "Failed to read block");
+    if (g_parallel_coin_prefetch) {
+        PrefetchBlockInputs(block);
+    }
+    {
+        CCoinsViewCache view(&CoinsTip());
+        if (!ConnectBlock(block, state, pindexNew, view, chainparams)) {
+            if (state.IsInvalid())
+                InvalidBlockFound(pindexNew, state);
+            return error("%s: ConnectBlock %s failed, %s", __func__, pindexNew->GetBlockHash().ToString(), FormatStateMessage(state));
+        }
+        m_rolling_coin_stats.ApplyChanges(view);
+        bool flushed = view.Flush();
+        assert(flushed);
+    }
+    pindexNew->nStatus &= ~BLOCK_ASSUMED_VALID;
+    setDirtyBlockIndex.insert(pindexNew);
+    m_chain.SetTip(pindexNew);
+
+    return FlushStateToDisk(chainparams, state, FlushStateMode::IF_NEEDED);
+}
+
 /**
  * Return the tip of the chain with the most work in it, that isn't
  * known to be invalid (it's however far from certain to be valid).
@@ -2665,7 +3245,7 @@ void CChainState::PruneBlockIndexCandidates() {
  *
  * @returns true unless a system error occurred
  */
-bool CChainState::ActivateBestChainStep(BlockValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace)
+bool CChainState::ActivateBestChainStep(BlockValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace, BlockReadAhead& read_ahead)
 {
     AssertLockHeld(cs_main);
 
@@ -2709,7 +3289,8 @@ bool CChainState::ActivateBestChainStep(BlockValidationState& state, const CChai
 
         // Connect new blocks.
         for (CBlockIndex *pindexConnect : reverse_iterate(vpindexToConnect)) {
-            if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
+            std::shared_ptr<const CBlock> pblockConnect = pindexConnect == pindexMostWork ? pblock : read_ahead.Take(pindexConnect, pindexMostWork);
+            if (!ConnectTip(state, chainparams, pindexConnect, pblockConnect, connectTrace, disconnectpool)) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
                     if (state.GetResult() != BlockValidationResult::BLOCK_MUTATED) {
@@ -2799,6 +3380,7 @@ bool CChainState::ActivateBestChain(BlockValidationState &state, const CChainPar
     CBlockIndex *pindexMostWork = nullptr;
     CBlockIndex *pindexNewTip = nullptr;
     int nStopAtHeight = gArgs.GetArg("-stopatheight", DEFAULT_STOPATHEIGHT);
+    BlockReadAhead read_ahead(chainparams.GetConsensus());
     do {
         boost::this_thread::interruption_point();
 
@@ -2830,7 +3412,7 @@ bool CChainState::ActivateBestChain(BlockValidationState &state, const CChainPar
 
                 bool fInvalidFound = false;
                 std::shared_ptr<const CBlock> nullBlockPtr;
-                if (!ActivateBestChainStep(state, chainparams, pindexMostWork, pblock && pblock->GetHash() == pindexMostWork->GetBlockHash() ? pblock : nullBlockPtr, fInvalidFound, connectTrace)) {
+                if (!ActivateBestChainStep(state, chainparams, pindexMostWork, pblock && pblock->GetHash() == pindexMostWork->GetBlockHash() ? pblock : nullBlockPtr, fInvalidFound, connectTrace, read_ahead)) {
                     // A system error occurred
                     return false;
                 }
@@ -3108,7 +3690,8 @@ CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block)
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
+    CBlockIndex* pindexNew = m_block_index_arena.Allocate();
+    *pindexNew = CBlockIndex(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -3136,8 +3719,12 @@ CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block)
 /** Mark a block as having its data received and checked (up to BLOCK_VALID_TRANSACTIONS). */
 void CChainState::ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pindexNew, const FlatFilePos& pos, const Consensus::Params& consensusParams)
 {
+    // A block below the base of a snapshot chainstate is already linked and
+    // in the active chain, with a placeholder nChainTx (see ActivateSnapshot).
+    // Its data is only needed for background validation.
+    const bool assumed_valid = pindexNew->nStatus & BLOCK_ASSUMED_VALID;
     pindexNew->nTx = block.vtx.size();
-    pindexNew->nChainTx = 0;
+    if (!assumed_valid) pindexNew->nChainTx = 0;
     pindexNew->nFile = pos.nFile;
     pindexNew->nDataPos = pos.nPos;
     pindexNew->nUndoPos = 0;
@@ -3148,6 +3735,8 @@ void CChainState::ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pi
     pindexNew->RaiseValidity(BLOCK_VALID_TRANSACTIONS);
     setDirtyBlockIndex.insert(pindexNew);
 
+    if (assumed_valid) return;
+
     if (pindexNew->pprev == nullptr || pindexNew->pprev->HaveTxsDownloaded()) {
         // If pindexNew is the genesis block or all parents are BLOCK_VALID_TRANSACTIONS.
         std::deque<CBlockIndex*> queue;
@@ -3872,6 +4461,7 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         FlatFilePos pos(*it, 0);
+        UnmapBlockFile(*it);
         fs::remove(BlockFileSeq().FileName(pos));
         fs::remove(UndoFileSeq().FileName(pos));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -3889,6 +4479,10 @@ static void FindFilesToPruneManual(std::set<int>& setFilesToPrune, int nManualPr
 
     // last block to prune is the lesser of (user-specified height, MIN_BLOCKS_TO_KEEP from the tip)
     unsigned int nLastBlockWeCanPrune = std::min((unsigned)nManualPruneHeight, ::ChainActive().Tip()->nHeight - MIN_BLOCKS_TO_KEEP);
+    // Keep the blocks the background chainstate has yet to connect.
+    if (g_ibd_chainstate) {
+        nLastBlockWeCanPrune = std::min<unsigned int>(nLastBlockWeCanPrune, std::max(g_ibd_chainstate->m_chain.Height(), 0));
+    }
     int count=0;
     for (int fileNumber = 0; fileNumber < nLastBlockFile; fileNumber++) {
         if (vinfoBlockFile[fileNumber].nSize == 0 || vinfoBlockFile[fileNumber].nHeightLast > nLastBlockWeCanPrune)
@@ -3937,6 +4531,10 @@ static void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfte
     }
 
     unsigned int nLastBlockWeCanPrune = ::ChainActive().Tip()->nHeight - MIN_BLOCKS_TO_KEEP;
+    // Keep the blocks the background chainstate has yet to connect.
+    if (g_ibd_chainstate) {
+        nLastBlockWeCanPrune = std::min<unsigned int>(nLastBlockWeCanPrune, std::max(g_ibd_chainstate->m_chain.Height(), 0));
+    }
     uint64_t nCurrentUsage = CalculateCurrentUsage();
     // We don't check to prune until after we've allocated new space for files
     // So we should leave a buffer under our target to account for another allocation
@@ -4019,7 +4617,7 @@ CBlockIndex * BlockManager::InsertBlockIndex(const uint256& hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
+    CBlockIndex* pindexNew = m_block_index_arena.Allocate();
     mi = m_block_index.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
@@ -4029,9 +4627,10 @@ CBlockIndex * BlockManager::InsertBlockIndex(const uint256& hash)
 bool BlockManager::LoadBlockIndex(
     const Consensus::Params& consensus_params,
     CBlockTreeDB& blocktree,
-    std::set<CBlockIndex*, CBlockIndexWorkComparator>& block_index_candidates)
+    std::set<CBlockIndex*, CBlockIndexWorkComparator>& block_index_candidates,
+    bool entries_loaded)
 {
-    if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }))
+    if (!entries_loaded && !blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }))
         return false;
 
     // Calculate nChainWork
@@ -4085,17 +4684,151 @@ void BlockManager::Unload() {
     m_failed_blocks.clear();
     m_blocks_unlinked.clear();
 
-    for (const BlockMap::value_type& entry : m_block_index) {
-        delete entry.second;
+    m_block_index.clear();
+    m_block_index_arena.Clear();
+}
+
+/** Magic and version at the start of a block index snapshot */
+static constexpr uint32_t BLOCK_INDEX_SNAPSHOT_VERSION = 1;
+
+static fs::path GetBlockIndexSnapshotPath()
+{
+    return GetDataDir() / "blocks" / "index.snapshot";
+}
+
+/**
+ * The last block file, and its info, as last written to the block tree
+ * database. Any block written since the snapshot was taken changes them.
+ */
+static std::vector<unsigned char> GetLastBlockFileState(CBlockTreeDB& blocktree)
+{
+    int last_file = 0;
+    CBlockFileInfo info;
+    blocktree.ReadLastBlockFile(last_file);
+    blocktree.ReadBlockFileInfo(last_file, info);
+    std::vector<unsigned char> state;
+    CVectorWriter(SER_DISK, CLIENT_VERSION, state, 0, last_file, info);
+    return state;
+}
+
+bool WriteBlockIndexSnapshot(const CChainParams& chainparams)
+{
+    AssertLockHeld(cs_main);
+    int64_t start = GetTimeMillis();
+
+    // A snapshot holds the block tree database state it was taken at, the block
+    // index entries, and a checksum of all that.
+    std::vector<unsigned char> data;
+    CVectorWriter writer(SER_DISK, CLIENT_VERSION, data, 0);
+    writer << chainparams.MessageStart() << BLOCK_INDEX_SNAPSHOT_VERSION << GetLastBlockFileState(*pblocktree);
+    writer << (uint64_t)g_blockman.m_block_index.size();
+    for (const auto& entry : g_blockman.m_block_index) {
+        writer << entry.first << CDiskBlockIndex(entry.second);
+    }
+    writer << Hash(data.begin(), data.end());
+
+    const fs::path path = GetBlockIndexSnapshotPath();
+    const fs::path path_tmp = path.string() + ".new";
+    FILE* file = fsbridge::fopen(path_tmp, "wb");
+    if (!file) {
+        return error("%s: Failed to create %s", __func__, path_tmp.string());
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size() && FileCommit(file);
+    ok &= fclose(file) == 0;
+    if (!ok || !RenameOver(path_tmp, path)) {
+        fs::remove(path_tmp);
+        return error("%s: Failed to write %s", __func__, path.string());
     }
+    LogPrintf("Wrote %u block index entries to %s  %dms\n", g_blockman.m_block_index.size(), path.string(), GetTimeMillis() - start);
+    return true;
+}
 
-    m_block_index.clear();
+/**
+ * Load the block index entries from a snapshot written at the last shutdown,
+ * if there is one and the block tree database was not changed since. The
+ * snapshot is removed, so that it is not loaded again once stale.
+ */
+static bool LoadBlockIndexSnapshot(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const fs::path path = GetBlockIndexSnapshotPath();
+    if (!fs::exists(path)) return false;
+    int64_t start = GetTimeMillis();
+
+    std::vector<unsigned char> data;
+    {
+        FILE* file = fsbridge::fopen(path, "rb");
+        if (file) {
+            data.resize(fs::file_size(path));
+            if (fread(data.data(), 1, data.size(), file) != data.size()) data.clear();
+            fclose(file);
+        }
+    }
+    fs::remove(path);
+    if (data.size() < sizeof(uint256) ||
+        Hash(data.begin(), data.end() - sizeof(uint256)) != uint256(std::vector<unsigned char>(data.end() - sizeof(uint256), data.end()))) {
+        LogPrintf("%s: Ignoring corrupt block index snapshot\n", __func__);
+        return false;
+    }
+
+    try {
+        VectorReader reader(SER_DISK, CLIENT_VERSION, data, 0);
+        CMessageHeader::MessageStartChars message_start;
+        uint32_t version;
+        std::vector<unsigned char> last_file_state;
+        uint64_t count;
+        reader >> message_start >> version >> last_file_state >> count;
+        if (memcmp(message_start, chainparams.MessageStart(), sizeof(message_start)) || version != BLOCK_INDEX_SNAPSHOT_VERSION) {
+            LogPrintf("%s: Ignoring block index snapshot of another network or version\n", __func__);
+            return false;
+        }
+        if (last_file_state != GetLastBlockFileState(*pblocktree)) {
+            LogPrintf("%s: Ignoring block index snapshot older than the block tree database\n", __func__);
+            return false;
+        }
+
+        g_blockman.m_block_index.reserve(count);
+        for (uint64_t i = 0; i < count; ++i) {
+            uint256 hash;
+            CDiskBlockIndex diskindex;
+            reader >> hash >> diskindex;
+            // The hash was checked against the header when the entry was first
+            // loaded, and the snapshot checksum covers it since.
+            CBlockIndex* pindexNew = g_blockman.InsertBlockIndex(hash);
+            pindexNew->pprev          = g_blockman.InsertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nTx            = diskindex.nTx;
+
+            if (!CheckProofOfWork(hash, pindexNew->nBits, chainparams.GetConsensus())) {
+                throw std::runtime_error(strprintf("CheckProofOfWork failed: %s", pindexNew->ToString()));
+            }
+        }
+        if (g_blockman.m_block_index.size() != count) {
+            throw std::runtime_error("entries missing");
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("%s: Ignoring invalid block index snapshot: %s\n", __func__, e.what());
+        g_blockman.Unload();
+        return false;
+    }
+
+    LogPrintf("Loaded %u block index entries from %s  %dms\n", g_blockman.m_block_index.size(), path.string(), GetTimeMillis() - start);
+    return true;
 }
 
 bool static LoadBlockIndexDB(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
+    const bool entries_loaded = LoadBlockIndexSnapshot(chainparams);
     if (!g_blockman.LoadBlockIndex(
-            chainparams.GetConsensus(), *pblocktree, ::ChainstateActive().setBlockIndexCandidates))
+            chainparams.GetConsensus(), *pblocktree, ::ChainstateActive().setBlockIndexCandidates, entries_loaded))
         return false;
 
     // Load block file info
@@ -4194,57 +4927,77 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
     if (nCheckDepth <= 0 || nCheckDepth > ::ChainActive().Height())
         nCheckDepth = ::ChainActive().Height();
     nCheckLevel = std::max(0, std::min(4, nCheckLevel));
-    LogPrintf("Verifying last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
-    CCoinsViewCache coins(coinsview);
+    const int n_threads = GetBlockReadThreads();
+    LogPrintf("Verifying last %i blocks at level %i using %d threads\n", nCheckDepth, nCheckLevel, n_threads);
+
+    // Collect the blocks to check, from the tip backwards.
     CBlockIndex* pindex;
+    std::vector<CBlockIndex*> blocks;
+    for (pindex = ::ChainActive().Tip(); pindex && pindex->pprev; pindex = pindex->pprev) {
+        if (pindex->nHeight <= ::ChainActive().Height()-nCheckDepth)
+            break;
+        if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            // If pruning, only go back as far as we have data.
+            LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
+            break;
+        }
+        if (pindex->nStatus & BLOCK_ASSUMED_VALID) {
+            // Blocks below the base of a UTXO snapshot have never been downloaded.
+            LogPrintf("VerifyDB(): block verification stopping at height %d (snapshot base)\n", pindex->nHeight);
+            break;
+        }
+        blocks.push_back(pindex);
+    }
+
+    // Check levels 0 to 2 only look at a single block, so the worker threads
+    // run them ahead of this thread, which disconnects the blocks in order.
+    // check level 0: read from disk
+    const Consensus::Params& consensus_params = chainparams.GetConsensus();
+    BlockCheckPipeline checks(std::move(blocks), consensus_params, [nCheckLevel, &consensus_params](const CBlockIndex* block_index, const CBlock& block) -> std::string {
+        // check level 1: verify block validity
+        if (nCheckLevel >= 1) {
+            std::string error = CheckBlockForPipeline(block_index, block, consensus_params);
+            if (!error.empty()) return error;
+        }
+        // check level 2: verify undo validity
+        if (nCheckLevel >= 2 && !block_index->GetUndoPos().IsNull()) {
+            CBlockUndo undo;
+            if (!UndoReadFromDisk(undo, block_index))
+                return strprintf("found bad undo data at %d, hash=%s", block_index->nHeight, block_index->GetBlockHash().ToString());
+        }
+        return {};
+    }, n_threads);
+
+    CCoinsViewCache coins(coinsview);
     CBlockIndex* pindexFailure = nullptr;
     int nGoodTransactions = 0;
     BlockValidationState state;
     int reportDone = 0;
     LogPrintf("[0%%]..."); /* Continued */
-    for (pindex = ::ChainActive().Tip(); pindex && pindex->pprev; pindex = pindex->pprev) {
+    for (size_t i = 0; i < checks.size(); ++i) {
         boost::this_thread::interruption_point();
-        const int percentageDone = std::max(1, std::min(99, (int)(((double)(::ChainActive().Height() - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100))));
+        CBlockIndex* pindex_check = checks[i];
+        const int percentageDone = std::max(1, std::min(99, (int)(((double)(::ChainActive().Height() - pindex_check->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100))));
         if (reportDone < percentageDone/10) {
             // report every 10% step
             LogPrintf("[%d%%]...", percentageDone); /* Continued */
             reportDone = percentageDone/10;
         }
         uiInterface.ShowProgress(_("Verifying blocks...").translated, percentageDone, false);
-        if (pindex->nHeight <= ::ChainActive().Height()-nCheckDepth)
-            break;
-        if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
-            // If pruning, only go back as far as we have data.
-            LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
-            break;
-        }
         CBlock block;
-        // check level 0: read from disk
-        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
-            return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-        // check level 1: verify block validity
-        if (nCheckLevel >= 1 && !CheckBlock(block, state, chainparams.GetConsensus()))
-            return error("%s: *** found bad block at %d, hash=%s (%s)\n", __func__,
-                         pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
-        // check level 2: verify undo validity
-        if (nCheckLevel >= 2 && pindex) {
-            CBlockUndo undo;
-            if (!pindex->GetUndoPos().IsNull()) {
-                if (!UndoReadFromDisk(undo, pindex)) {
-                    return error("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
-                }
-            }
-        }
+        std::string check_error;
+        if (!checks.Take(i, block, check_error))
+            return error("VerifyDB(): *** %s", check_error);
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
         if (nCheckLevel >= 3 && (coins.DynamicMemoryUsage() + ::ChainstateActive().CoinsTip().DynamicMemoryUsage()) <= nCoinCacheUsage) {
-            assert(coins.GetBestBlock() == pindex->GetBlockHash());
-            DisconnectResult res = ::ChainstateActive().DisconnectBlock(block, pindex, coins);
+            assert(coins.GetBestBlock() == pindex_check->GetBlockHash());
+            DisconnectResult res = ::ChainstateActive().DisconnectBlock(block, pindex_check, coins);
             if (res == DISCONNECT_FAILED) {
-                return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+                return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex_check->nHeight, pindex_check->GetBlockHash().ToString());
             }
             if (res == DISCONNECT_UNCLEAN) {
                 nGoodTransactions = 0;
-                pindexFailure = pindex;
+                pindexFailure = pindex_check;
             } else {
                 nGoodTransactions += block.vtx.size();
             }
@@ -4258,10 +5011,16 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
     // store block count as we move pindex at check level >= 4
     int block_count = ::ChainActive().Height() - pindex->nHeight;
 
-    // check level 4: try reconnecting blocks
+    // check level 4: try reconnecting blocks, reading them ahead on the worker threads
     if (nCheckLevel >= 4) {
-        while (pindex != ::ChainActive().Tip()) {
+        std::vector<CBlockIndex*> reconnect;
+        for (CBlockIndex* pindex_next = ::ChainActive().Next(pindex); pindex_next; pindex_next = ::ChainActive().Next(pindex_next)) {
+            reconnect.push_back(pindex_next);
+        }
+        BlockCheckPipeline reads(std::move(reconnect), consensus_params, nullptr, n_threads);
+        for (size_t i = 0; i < reads.size(); ++i) {
             boost::this_thread::interruption_point();
+            pindex = reads[i];
             const int percentageDone = std::max(1, std::min(99, 100 - (int)(((double)(::ChainActive().Height() - pindex->nHeight)) / (double)nCheckDepth * 50)));
             if (reportDone < percentageDone/10) {
                 // report every 10% step
@@ -4269,10 +5028,10 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
                 reportDone = percentageDone/10;
             }
             uiInterface.ShowProgress(_("Verifying blocks...").translated, percentageDone, false);
-            pindex = ::ChainActive().Next(pindex);
             CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
-                return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+            std::string read_error;
+            if (!reads.Take(i, block, read_error))
+                return error("VerifyDB(): *** %s", read_error);
             if (!::ChainstateActive().ConnectBlock(block, state, pindex, coins, chainparams))
                 return error("VerifyDB(): *** found unconnectable block at %d, hash=%s (%s)", pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
         }
@@ -4285,14 +5044,9 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
 }
 
 /** Apply the effects of a block on the utxo cache, ignoring that it may already have been applied. */
-bool CChainState::RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs, const CChainParams& params)
+bool CChainState::RollforwardBlock(const CBlockIndex* pindex, const CBlock& block, CCoinsViewCache& inputs)
 {
     // TODO: merge with ConnectBlock
-    CBlock block;
-    if (!ReadBlockFromDisk(block, pindex, params.GetConsensus())) {
-        return error("ReplayBlock(): ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-    }
-
     for (const CTransactionRef& tx : block.vtx) {
         if (!tx->IsCoinBase()) {
             for (const CTxIn &txin : tx->vin) {
@@ -4357,14 +5111,35 @@ bool CChainState::ReplayBlocks(const CChainParams& params)
         pindexOld = pindexOld->pprev;
     }
 
-    // Roll forward from the forking point to the new tip.
+    // Roll forward from the forking point to the new tip. The blocks are read
+    // and checked on worker threads ahead of applying them to the cache.
     int nForkHeight = pindexFork ? pindexFork->nHeight : 0;
+    std::vector<CBlockIndex*> blocks;
     for (int nHeight = nForkHeight + 1; nHeight <= pindexNew->nHeight; ++nHeight) {
-        const CBlockIndex* pindex = pindexNew->GetAncestor(nHeight);
-        LogPrintf("Rolling forward %s (%i)\n", pindex->GetBlockHash().ToString(), nHeight);
-        uiInterface.ShowProgress(_("Replaying blocks...").translated, (int) ((nHeight - nForkHeight) * 100.0 / (pindexNew->nHeight - nForkHeight)) , false);
-        if (!RollforwardBlock(pindex, cache, params)) return false;
+        blocks.push_back(const_cast<CBlockIndex*>(pindexNew->GetAncestor(nHeight)));
+    }
+    const Consensus::Params& consensus_params = params.GetConsensus();
+    const int64_t time_start = GetTimeMicros();
+    int64_t time_apply = 0;
+    BlockCheckPipeline replay(std::move(blocks), consensus_params, [&consensus_params](const CBlockIndex* block_index, const CBlock& block) {
+        return CheckBlockForPipeline(block_index, block, consensus_params);
+    }, GetBlockReadThreads());
+    for (size_t i = 0; i < replay.size(); ++i) {
+        const CBlockIndex* pindex = replay[i];
+        LogPrintf("Rolling forward %s (%i)\n", pindex->GetBlockHash().ToString(), pindex->nHeight);
+        uiInterface.ShowProgress(_("Replaying blocks...").translated, (int) ((pindex->nHeight - nForkHeight) * 100.0 / (pindexNew->nHeight - nForkHeight)) , false);
+        CBlock block;
+        std::string replay_error;
+        if (!replay.Take(i, block, replay_error)) {
+            return error("ReplayBlock(): %s", replay_error);
+        }
+        const int64_t time_apply_start = GetTimeMicros();
+        if (!RollforwardBlock(pindex, block, cache)) return false;
+        time_apply += GetTimeMicros() - time_apply_start;
     }
+    replay.Stop();
+    LogPrintf("Rolled forward %u blocks in %.2fs (read %.2fs, check %.2fs, wait %.2fs, apply %.2fs)\n", replay.size(),
+        (GetTimeMicros() - time_start) * MICRO, replay.ReadTime() * MICRO, replay.CheckTime() * MICRO, replay.WaitTime() * MICRO, time_apply * MICRO);
 
     cache.SetBestBlock(pindexNew->GetBlockHash());
     cache.Flush();
@@ -4433,7 +5208,8 @@ bool CChainState::RewindBlockIndex(const CChainParams& params)
             // Although SCRIPT_VERIFY_WITNESS is now generally enforced on all
             // blocks in ConnectBlock, we don't need to go back and
             // re-download/re-verify blocks from before segwit actually activated.
-            if (IsWitnessEnabled(m_chain[nHeight - 1], params.GetConsensus()) && !(m_chain[nHeight]->nStatus & BLOCK_OPT_WITNESS)) {
+            // Blocks assumed valid through a UTXO snapshot have no data to re-validate.
+            if (IsWitnessEnabled(m_chain[nHeight - 1], params.GetConsensus()) && !(m_chain[nHeight]->nStatus & (BLOCK_OPT_WITNESS | BLOCK_ASSUMED_VALID))) {
                 break;
             }
             nHeight++;
@@ -4539,6 +5315,7 @@ void UnloadBlockIndex()
     mempool.clear();
     vinfoBlockFile.clear();
     nLastBlockFile = 0;
+    UnmapBlockFile(-1);
     setDirtyBlockIndex.clear();
     setDirtyFileInfo.clear();
     versionbitscache.Clear();
@@ -4554,7 +5331,10 @@ bool LoadBlockIndex(const CChainParams& chainparams)
 {
     // Load block index from databases
     bool needs_init = fReindex;
-    if (!fReindex) {
+    if (fReindex) {
+        // The block index is rebuilt, a snapshot of it must not be loaded later.
+        fs::remove(GetBlockIndexSnapshotPath());
+    } else {
         bool ret = LoadBlockIndexDB(chainparams);
         if (!ret) return false;
         needs_init = g_blockman.m_block_index.empty();
@@ -4602,126 +5382,350 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
     return ::ChainstateActive().LoadGenesisBlock(chainparams);
 }
 
+/** A block found in a block file, with its position in the file when reindexing. */
+struct ExternalBlock {
+    std::shared_ptr<CBlock> block;
+    uint256 hash;
+    FlatFilePos pos;
+    size_t memory_usage{0}; //!< Dynamic memory usage of block, set by the -reindex scan threads
+};
+
+/** Map of disk positions for blocks with unknown parent (only used for reindex) */
+static std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
+
+/**
+ * Find the blocks in a block file and deserialize and hash them. Each block
+ * is passed to process as it is found; scanning stops when it returns false.
+ * This takes over fileIn and calls fclose() on it.
+ */
+static void ScanExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, const FlatFilePos* dbp, const std::function<bool(ExternalBlock&&)>& process)
+{
+    CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
+    uint64_t nRewind = blkdat.GetPos();
+    while (!blkdat.eof()) {
+        boost::this_thread::interruption_point();
+
+        blkdat.SetPos(nRewind);
+        nRewind++; // start one byte further next time, in case of failure
+        blkdat.SetLimit(); // remove former limit
+        unsigned int nSize = 0;
+        try {
+            // locate a header
+            unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+            blkdat.FindByte(chainparams.MessageStart()[0]);
+            nRewind = blkdat.GetPos()+1;
+            blkdat >> buf;
+            if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+                continue;
+            // read size
+            blkdat >> nSize;
+            if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                continue;
+        } catch (const std::exception&) {
+            // no valid block header found; don't complain
+            break;
+        }
+        try {
+            // read block
+            uint64_t nBlockPos = blkdat.GetPos();
+            blkdat.SetLimit(nBlockPos + nSize);
+            blkdat.SetPos(nBlockPos);
+            ExternalBlock external;
+            external.block = std::make_shared<CBlock>();
+            blkdat >> *external.block;
+            nRewind = blkdat.GetPos();
+            external.hash = external.block->GetHash();
+            if (dbp) {
+                external.pos = FlatFilePos(dbp->nFile, nBlockPos);
+            }
+            if (!process(std::move(external))) break;
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+        }
+    }
+}
+
+/** Accept a block found in a block file into the block index. Returns false if importing should stop. */
+static bool AcceptExternalBlock(const CChainParams& chainparams, const ExternalBlock& external, bool reindex, int& nLoaded)
+{
+    const CBlock& block = *external.block;
+    const uint256& hash = external.hash;
+    FlatFilePos pos = external.pos;
+    FlatFilePos* dbp = reindex ? &pos : nullptr;
+    {
+        LOCK(cs_main);
+        // detect out of order blocks, and store them for later
+        if (hash != chainparams.GetConsensus().hashGenesisBlock && !LookupBlockIndex(block.hashPrevBlock)) {
+            LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                    block.hashPrevBlock.ToString());
+            if (dbp)
+                mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+            return true;
+        }
+
+        // process in case the block isn't known yet
+        CBlockIndex* pindex = LookupBlockIndex(hash);
+        if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
+          BlockValidationState state;
+          if (::ChainstateActive().AcceptBlock(external.block, state, chainparams, nullptr, true, dbp, nullptr)) {
+              nLoaded++;
+          }
+          if (state.IsError()) {
+              return false;
+          }
+        } else if (hash != chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
+          LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+        }
+    }
+
+    // Activate the genesis block so normal node progress can continue
+    if (hash == chainparams.GetConsensus().hashGenesisBlock) {
+        BlockValidationState state;
+        if (!ActivateBestChain(state, chainparams)) {
+            return false;
+        }
+    }
+
+    NotifyHeaderTip();
+
+    // Recursively process earlier encountered successors of this block
+    std::deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        uint256 head = queue.front();
+        queue.pop_front();
+        std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+        while (range.first != range.second) {
+            std::multimap<uint256, FlatFilePos>::iterator it = range.first;
+            std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+            if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
+            {
+                LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
+                        head.ToString());
+                LOCK(cs_main);
+                BlockValidationState dummy;
+                if (::ChainstateActive().AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr))
+                {
+                    nLoaded++;
+                    queue.push_back(pblockrecursive->GetHash());
+                }
+            }
+            range.first++;
+            mapBlocksUnknownParent.erase(it);
+            NotifyHeaderTip();
+        }
+    }
+    return true;
+}
+
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFilePos *dbp)
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
     int64_t nStart = GetTimeMillis();
 
     int nLoaded = 0;
     try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
+        ScanExternalBlockFile(chainparams, fileIn, dbp, [&](ExternalBlock&& external) {
+            if (dbp) *dbp = external.pos;
+            return AcceptExternalBlock(chainparams, external, dbp != nullptr, nLoaded);
+        });
+    } catch (const std::runtime_error& e) {
+        AbortNode(std::string("System error: ") + e.what());
+    }
+    if (nLoaded > 0)
+        LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
+    return nLoaded > 0;
+}
 
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> buf;
-                if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                uint256 hash = block.GetHash();
-                {
-                    LOCK(cs_main);
-                    // detect out of order blocks, and store them for later
-                    if (hash != chainparams.GetConsensus().hashGenesisBlock && !LookupBlockIndex(block.hashPrevBlock)) {
-                        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                                block.hashPrevBlock.ToString());
-                        if (dbp)
-                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                        continue;
-                    }
+/**
+ * Scans the block files of the block directory on worker threads, each
+ * claiming the next file number, while the import thread accepts the blocks
+ * file by file in order. Workers hand over blocks as they find them, and wait
+ * while the memory used by the blocks in flight exceeds the budget. The
+ * worker of the file being imported may always add a block when the import
+ * thread has run out, so the scan of later files cannot hold up the import.
+ */
+class BlockFileScanner
+{
+public:
+    struct ScanResult {
+        std::string error;
+        int64_t scan_time{0};
+    };
 
-                    // process in case the block isn't known yet
-                    CBlockIndex* pindex = LookupBlockIndex(hash);
-                    if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
-                      BlockValidationState state;
-                      if (::ChainstateActive().AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr)) {
-                          nLoaded++;
-                      }
-                      if (state.IsError()) {
-                          break;
-                      }
-                    } else if (hash != chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
-                      LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
-                    }
+    BlockFileScanner(const CChainParams& chainparams, int threads) : m_chainparams(chainparams), m_files(threads), m_max_bytes(threads * REINDEX_SCAN_BYTES_PER_THREAD)
+    {
+        for (int i = 0; i < threads; ++i) {
+            m_threads.emplace_back([this] { Run(); });
+        }
+    }
+
+    ~BlockFileScanner()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    /** Wait for the scan of block file nFile to start. Files must be taken in order. Returns false if there is no such file. */
+    bool BeginFile(int nFile)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        assert(nFile == m_consumed);
+        const Slot& slot = m_files[nFile % m_files.size()];
+        m_cv.wait(lock, [&] { return slot.active || nFile >= m_end; });
+        return slot.active;
+    }
+
+    /** Wait for the next block of the current file. Returns false once all of its blocks have been taken. */
+    bool NextBlock(ExternalBlock& external)
+    {
+        {
+            WAIT_LOCK(m_mutex, lock);
+            Slot& slot = m_files[m_consumed % m_files.size()];
+            m_cv.wait(lock, [&] { return !slot.blocks.empty() || slot.done; });
+            if (slot.blocks.empty()) return false;
+            external = std::move(slot.blocks.front());
+            slot.blocks.pop_front();
+            m_bytes_in_flight -= external.memory_usage;
+        }
+        m_cv.notify_all();
+        return true;
+    }
+
+    /** Finish the current file, after all of its blocks have been taken. */
+    ScanResult EndFile()
+    {
+        ScanResult result;
+        {
+            LOCK(m_mutex);
+            Slot& slot = m_files[m_consumed % m_files.size()];
+            assert(slot.done && slot.blocks.empty());
+            result = std::move(slot.result);
+            slot = Slot{};
+            ++m_consumed;
+        }
+        m_cv.notify_all();
+        return result;
+    }
+
+private:
+    struct Slot {
+        std::deque<ExternalBlock> blocks;
+        ScanResult result;
+        bool active{false};
+        bool done{false};
+    };
+
+    void Run()
+    {
+        while (true) {
+            int nFile;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cv.wait(lock, [&] { return m_stop || m_next >= m_end || m_next < m_consumed + (int)m_files.size(); });
+                if (m_stop || m_next >= m_end) return;
+                nFile = m_next++;
+            }
+            Slot& slot = m_files[nFile % m_files.size()];
+            FlatFilePos pos(nFile, 0);
+            FILE* fileIn = fs::exists(GetBlockPosFilename(pos)) ? OpenBlockFile(pos, true) : nullptr;
+            {
+                LOCK(m_mutex);
+                if (fileIn) {
+                    slot.active = true;
+                } else {
+                    // No block files left to reindex, or an error logged in OpenBlockFile
+                    m_end = std::min(m_end, nFile);
                 }
+            }
+            m_cv.notify_all();
+            if (!fileIn) return;
 
-                // Activate the genesis block so normal node progress can continue
-                if (hash == chainparams.GetConsensus().hashGenesisBlock) {
+            ScanResult result;
+            const int64_t time_start = GetTimeMillis();
+            try {
+                ScanExternalBlockFile(m_chainparams, fileIn, &pos, [&](ExternalBlock&& external) {
+                    // Check the block here, so that AcceptBlock does not need to.
                     BlockValidationState state;
-                    if (!ActivateBestChain(state, chainparams)) {
-                        break;
+                    CheckBlock(*external.block, state, m_chainparams.GetConsensus());
+                    external.memory_usage = RecursiveDynamicUsage(*external.block);
+                    {
+                        WAIT_LOCK(m_mutex, lock);
+                        m_cv.wait(lock, [&] {
+                            return m_stop || m_bytes_in_flight == 0 || m_bytes_in_flight + external.memory_usage <= m_max_bytes ||
+                                (nFile == m_consumed && slot.blocks.empty());
+                        });
+                        if (m_stop) return false;
+                        m_bytes_in_flight += external.memory_usage;
+                        slot.blocks.push_back(std::move(external));
                     }
-                }
+                    m_cv.notify_all();
+                    return true;
+                });
+            } catch (const std::runtime_error& e) {
+                result.error = e.what();
+            }
+            result.scan_time = GetTimeMillis() - time_start;
+            {
+                LOCK(m_mutex);
+                slot.result = std::move(result);
+                slot.done = true;
+            }
+            m_cv.notify_all();
+        }
+    }
 
-                NotifyHeaderTip();
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, FlatFilePos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus()))
-                        {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            BlockValidationState dummy;
-                            if (::ChainstateActive().AcceptBlock(pblockrecursive, dummy, chainparams, nullptr, true, &it->second, nullptr))
-                            {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip();
-                    }
-                }
-            } catch (const std::exception& e) {
-                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+    const CChainParams& m_chainparams;
+    std::vector<Slot> m_files;
+    std::vector<std::thread> m_threads;
+    const size_t m_max_bytes;
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    int m_next GUARDED_BY(m_mutex){0};
+    int m_consumed GUARDED_BY(m_mutex){0};
+    int m_end GUARDED_BY(m_mutex){std::numeric_limits<int>::max()};
+    size_t m_bytes_in_flight GUARDED_BY(m_mutex){0};
+    bool m_stop GUARDED_BY(m_mutex){false};
+};
+
+void ReindexBlockFiles(const CChainParams& chainparams)
+{
+    int threads = gArgs.GetArg("-reindexthreads", DEFAULT_REINDEX_THREADS);
+    if (threads <= 0) threads = GetNumCores();
+    threads = std::max(1, std::min(threads, MAX_REINDEX_THREADS));
+    LogPrintf("Reindexing block files using %d threads\n", threads);
+    BlockFileScanner scanner(chainparams, threads);
+    for (int nFile = 0; scanner.BeginFile(nFile); ++nFile) {
+        boost::this_thread::interruption_point();
+        LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
+        int64_t nStart = GetTimeMillis();
+        int nLoaded = 0;
+        bool accept = true;
+        ExternalBlock external;
+        try {
+            while (scanner.NextBlock(external)) {
+                // Interrupting unwinds through ~BlockFileScanner, which stops the workers.
+                boost::this_thread::interruption_point();
+                // The rest of the file has to be taken even if importing stops.
+                if (accept) accept = AcceptExternalBlock(chainparams, external, true, nLoaded);
             }
+        } catch (const std::runtime_error& e) {
+            AbortNode(std::string("System error: ") + e.what());
+            return;
         }
-    } catch (const std::runtime_error& e) {
-        AbortNode(std::string("System error: ") + e.what());
+        const BlockFileScanner::ScanResult result = scanner.EndFile();
+        if (!result.error.empty()) {
+            AbortNode(std::string("System error: ") + result.error);
+            return;
+        }
+        if (nLoaded > 0)
+            LogPrintf("Loaded %i blocks from external file in %dms (scanned in %dms)\n", nLoaded, GetTimeMillis() - nStart, result.scan_time);
     }
-    if (nLoaded > 0)
-        LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
-    return nLoaded > 0;
 }
 
 void CChainState::CheckBlockIndex(const Consensus::Params& consensusParams)
@@ -4732,6 +5736,12 @@ void CChainState::CheckBlockIndex(const Consensus::Params& consensusParams)
 
     LOCK(cs_main);
 
+    // The placeholder nTx/nChainTx values of blocks below a snapshot base
+    // (see BLOCK_ASSUMED_VALID) break the invariants checked here.
+    if (!m_from_snapshot_blockhash.IsNull()) {
+        return;
+    }
+
     // During a reindex, we read the genesis block and call CheckBlockIndex before ActivateBestChain,
     // so we have the genesis block in m_blockman.m_block_index but no active chain. (A few of the
     // tests when iterating the block tree require that m_chain has been initialized.)
@@ -5070,6 +6080,519 @@ bool DumpMempool(const CTxMemPool& pool)
     return true;
 }
 
+//! File in SNAPSHOT_CHAINSTATE_DIR holding the snapshot base blockhash. It is
+//! written last, so a snapshot chainstate without it was never activated.
+static const char* const SNAPSHOT_BLOCKHASH_FILENAME = "base_blockhash";
+
+//! File in SNAPSHOT_CHAINSTATE_DIR written once background validation has
+//! confirmed the snapshot. The snapshot chainstate then replaces "chainstate".
+static const char* const SNAPSHOT_VALIDATED_FILENAME = "validated";
+
+//! Held while a snapshot is being loaded, so that loads do not race on SNAPSHOT_CHAINSTATE_DIR.
+static Mutex g_snapshot_load_mutex;
+
+bool DetectSnapshotChainstate(uint256& base_blockhash)
+{
+    const fs::path snapshot_dir = GetDataDir() / SNAPSHOT_CHAINSTATE_DIR;
+    if (!fs::exists(snapshot_dir)) {
+        return false;
+    }
+
+    if (fs::exists(snapshot_dir / SNAPSHOT_VALIDATED_FILENAME)) {
+        // The marker files are left behind by the rename, so that an
+        // interruption at any point leaves a datadir this can handle.
+        const fs::path chainstate_dir = GetDataDir() / "chainstate";
+        LogPrintf("Replacing %s with the validated snapshot chainstate\n", chainstate_dir.string());
+        fs::remove_all(chainstate_dir);
+        fs::rename(snapshot_dir, chainstate_dir);
+        fs::remove(chainstate_dir / SNAPSHOT_BLOCKHASH_FILENAME);
+        fs::remove(chainstate_dir / SNAPSHOT_VALIDATED_FILENAME);
+        return false;
+    }
+
+    CAutoFile file(fsbridge::fopen(snapshot_dir / SNAPSHOT_BLOCKHASH_FILENAME, "rb"), SER_DISK, CLIENT_VERSION);
+    if (!file.IsNull()) {
+        try {
+            file >> base_blockhash;
+            return true;
+        } catch (const std::exception& e) {
+            LogPrintf("%s: failed to read snapshot base blockhash: %s\n", __func__, e.what());
+        }
+    }
+    LogPrintf("Removing incomplete snapshot chainstate in %s\n", snapshot_dir.string());
+    RemoveSnapshotChainstate();
+    return false;
+}
+
+void RemoveSnapshotChainstate()
+{
+    fs::remove_all(GetDataDir() / SNAPSHOT_CHAINSTATE_DIR);
+}
+
+/**
+ * Read the coins of a UTXO snapshot into the (not yet active) snapshot
+ * chainstate, flush them to its coins database and check the result against
+ * the expected assumeutxo data.
+ */
+static bool PopulateSnapshotChainstate(
+    CChainState& snapshot_chainstate,
+    CAutoFile& coins_file,
+    const SnapshotMetadata& metadata,
+    const CBlockIndex* base,
+    const AssumeutxoData& au_data,
+    std::string& error)
+{
+    // The snapshot chainstate is not visible to any other thread before it is
+    // activated, so its views can be used without holding cs_main.
+    CCoinsViewCache& coins_cache = *WITH_LOCK(::cs_main, return &snapshot_chainstate.CoinsTip());
+    CCoinsViewDB& coins_db = *WITH_LOCK(::cs_main, return &snapshot_chainstate.CoinsDB());
+
+    RollingCoinStats rolling_stats;
+
+    // Intermediate flushes need a best block. Should the load be interrupted,
+    // the chainstate is discarded on restart (see DetectSnapshotChainstate).
+    coins_cache.SetBestBlock(base->GetBlockHash());
+
+    const int64_t start = GetTimeMillis();
+    LogPrintf("[snapshot] loading %d coins from snapshot %s\n", metadata.m_coins_count, base->GetBlockHash().ToString());
+
+    COutPoint outpoint;
+    Coin coin;
+    uint64_t coins_processed = 0;
+    while (coins_processed < metadata.m_coins_count) {
+        try {
+            coins_file >> outpoint;
+            coins_file >> coin;
+        } catch (const std::ios_base::failure&) {
+            error = strprintf("Bad snapshot format or truncated snapshot after deserializing %d coins", coins_processed);
+            return false;
+        }
+        if (coin.nHeight > static_cast<uint32_t>(base->nHeight)) {
+            error = strprintf("Bad snapshot data after deserializing %d coins: coin height %d above snapshot base", coins_processed, coin.nHeight);
+            return false;
+        }
+        rolling_stats.Add(outpoint, coin);
+        try {
+            coins_cache.AddCoin(outpoint, std::move(coin), /* possible_overwrite */ false);
+        } catch (const std::logic_error&) {
+            error = strprintf("Bad snapshot data after deserializing %d coins: duplicate coin %s", coins_processed, outpoint.ToString());
+            return false;
+        }
+        ++coins_processed;
+
+        if (coins_processed % 120000 == 0) {
+            if (ShutdownRequested()) {
+                error = "Shutdown requested while loading snapshot";
+                return false;
+            }
+            if (coins_cache.DynamicMemoryUsage() > nCoinCacheUsage) {
+                LogPrintf("[snapshot] flushing coins cache (%.2f MiB) after %d coins\n",
+                    coins_cache.DynamicMemoryUsage() * (1.0 / (1 << 20)), coins_processed);
+                if (!coins_cache.Flush()) {
+                    error = "Failed to write snapshot coins to disk";
+                    return false;
+                }
+            }
+        }
+    }
+
+    // A snapshot with more coins than announced in its metadata is malformed.
+    bool out_of_coins = false;
+    try {
+        coins_file >> outpoint;
+    } catch (const std::ios_base::failure&) {
+        out_of_coins = true;
+    }
+    if (!out_of_coins) {
+        error = strprintf("Bad snapshot - coins left over after deserializing %d coins", coins_processed);
+        return false;
+    }
+
+    if (!coins_cache.Flush()) {
+        error = "Failed to write snapshot coins to disk";
+        return false;
+    }
+
+    CCoinsStats stats;
+    if (!GetUTXOStats(&coins_db, stats)) {
+        error = "Unable to compute the UTXO set statistics of the snapshot";
+        return false;
+    }
+    if (stats.hashSerialized != au_data.hash_serialized) {
+        error = strprintf("Bad snapshot content hash: expected %s, got %s",
+            au_data.hash_serialized.ToString(), stats.hashSerialized.ToString());
+        return false;
+    }
+    if (stats.coins_count != au_data.coins_count) {
+        error = strprintf("Bad snapshot coins count: expected %d, got %d", au_data.coins_count, stats.coins_count);
+        return false;
+    }
+
+    LOCK(::cs_main);
+    snapshot_chainstate.m_rolling_coin_stats = std::move(rolling_stats);
+    // Store the statistics with the coins, see LoadRollingCoinStats().
+    if (!coins_db.WriteRollingCoinStats(base->GetBlockHash(), snapshot_chainstate.m_rolling_coin_stats)) {
+        error = "Failed to write snapshot coins to disk";
+        return false;
+    }
+
+    LogPrintf("[snapshot] loaded and validated %d coins in %.2fs\n", coins_processed, (GetTimeMillis() - start) * 0.001);
+    return true;
+}
+
+/**
+ * Give the blocks up to the snapshot base the nTx/nChainTx values they would
+ * have had after being connected, so that the snapshot chainstate can build on
+ * its tip. Blocks that were not connected yet are flagged BLOCK_ASSUMED_VALID
+ * until the background chainstate connects them. Those whose transactions were
+ * never received are counted as one transaction each; the base block makes up
+ * for the difference so that its nChainTx matches the assumeutxo data.
+ */
+static void MarkSnapshotAncestorsAssumedValid(CBlockIndex* base, const AssumeutxoData& au_data) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    std::deque<CBlockIndex*> linked;
+    for (int height = 0; height <= base->nHeight; ++height) {
+        CBlockIndex* index = base->GetAncestor(height);
+        const unsigned int prev_chain_tx = index->pprev ? index->pprev->nChainTx : 0;
+        if (!::ChainActive().Contains(index)) {
+            index->nStatus |= BLOCK_ASSUMED_VALID;
+            setDirtyBlockIndex.insert(index);
+        }
+        if (index->nTx == 0) {
+            index->nTx = 1;
+            if (index == base && au_data.nChainTx > prev_chain_tx) {
+                index->nTx = au_data.nChainTx - prev_chain_tx;
+            }
+            index->RaiseValidity(BLOCK_VALID_TRANSACTIONS);
+        }
+        index->nChainTx = prev_chain_tx + index->nTx;
+        linked.push_back(index);
+    }
+
+    // Blocks that were received before one of their ancestors can now be
+    // linked, as in CChainState::ReceivedBlockTransactions.
+    while (!linked.empty()) {
+        CBlockIndex* index = linked.front();
+        linked.pop_front();
+        auto range = g_blockman.m_blocks_unlinked.equal_range(index);
+        while (range.first != range.second) {
+            CBlockIndex* child = range.first->second;
+            child->nChainTx = index->nChainTx + child->nTx;
+            linked.push_back(child);
+            range.first = g_blockman.m_blocks_unlinked.erase(range.first);
+        }
+    }
+}
+
+bool ActivateSnapshot(CAutoFile& coins_file, const SnapshotMetadata& metadata, std::string& error)
+{
+    TRY_LOCK(g_snapshot_load_mutex, snapshot_lock);
+    if (!snapshot_lock) {
+        error = "A snapshot is already being loaded";
+        return false;
+    }
+
+    const CChainParams& chainparams = Params();
+    if (chainparams.Assumeutxo().empty()) {
+        error = "No assumeutxo data for this network";
+        return false;
+    }
+    const uint256& base_blockhash = metadata.m_base_blockhash;
+
+    // Check that the snapshot can extend the active chain. These are checked
+    // again before activation since cs_main is released while loading coins.
+    auto check_base = [&](const CBlockIndex* base) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+        if (!::ChainstateActive().m_from_snapshot_blockhash.IsNull()) {
+            error = "The active chainstate was already loaded from a snapshot";
+            return false;
+        }
+        if (base->nStatus & BLOCK_FAILED_MASK) {
+            error = strprintf("The base block %s of the snapshot is invalid", base_blockhash.ToString());
+            return false;
+        }
+        const CBlockIndex* tip = ::ChainActive().Tip();
+        if (tip && (tip->nHeight >= base->nHeight || base->GetAncestor(tip->nHeight) != tip)) {
+            error = strprintf("The snapshot base block (height %d) does not extend the active chain (height %d)", base->nHeight, tip->nHeight);
+            return false;
+        }
+        return true;
+    };
+
+    CBlockIndex* base;
+    AssumeutxoData au_data;
+    size_t coinsdb_cache_size;
+    {
+        LOCK(cs_main);
+        base = LookupBlockIndex(base_blockhash);
+        if (!base) {
+            error = strprintf("The base block header (%s) must appear in the headers chain. Make sure all headers are syncing, and try again.", base_blockhash.ToString());
+            return false;
+        }
+        if (!check_base(base)) return false;
+
+        const auto it = chainparams.Assumeutxo().find(base->nHeight);
+        if (it == chainparams.Assumeutxo().end()) {
+            error = strprintf("Assumeutxo height in snapshot metadata not recognized (%d) - refusing to load snapshot", base->nHeight);
+            return false;
+        }
+        au_data = it->second;
+        if (metadata.m_coins_count != au_data.coins_count || metadata.m_nchaintx != au_data.nChainTx) {
+            error = strprintf("Snapshot metadata (%d coins, %d transactions) does not match the expected values (%d coins, %d transactions)",
+                metadata.m_coins_count, metadata.m_nchaintx, au_data.coins_count, au_data.nChainTx);
+            return false;
+        }
+        coinsdb_cache_size = ::ChainstateActive().CoinsDBCacheSize();
+    }
+
+    std::unique_ptr<CChainState> snapshot_chainstate = MakeUnique<CChainState>(base_blockhash);
+    {
+        LOCK(cs_main);
+        snapshot_chainstate->InitCoinsDB(coinsdb_cache_size, /* in_memory */ false, /* should_wipe */ true, SNAPSHOT_CHAINSTATE_DIR);
+        snapshot_chainstate->InitCoinsCache();
+    }
+
+    auto discard = [&]() {
+        snapshot_chainstate->ResetCoinsViews();
+        RemoveSnapshotChainstate();
+        return false;
+    };
+
+    if (!PopulateSnapshotChainstate(*snapshot_chainstate, coins_file, metadata, base, au_data, error)) {
+        return discard();
+    }
+
+    const CBlockIndex* old_tip;
+    {
+        LOCK2(cs_main, ::mempool.cs);
+        if (!check_base(base)) return discard();
+        old_tip = ::ChainActive().Tip();
+
+        MarkSnapshotAncestorsAssumedValid(base, au_data);
+
+        snapshot_chainstate->m_chain.SetTip(base);
+        for (const BlockMap::value_type& entry : g_blockman.m_block_index) {
+            CBlockIndex* index = entry.second;
+            if (index->IsValid(BLOCK_VALID_TRANSACTIONS) && index->HaveTxsDownloaded() &&
+                    !snapshot_chainstate->setBlockIndexCandidates.value_comp()(index, base)) {
+                snapshot_chainstate->setBlockIndexCandidates.insert(index);
+            }
+        }
+        snapshot_chainstate->setBlockIndexCandidates.insert(base);
+
+        // The mempool was validated against the old tip.
+        ::mempool.clear();
+
+        ::ChainstateActive().ForceFlushStateToDisk();
+        g_ibd_chainstate = std::move(g_chainstate);
+        g_chainstate = std::move(snapshot_chainstate);
+        ::ChainstateActive().ForceFlushStateToDisk();
+        UpdateTip(base, chainparams);
+
+        CAutoFile file(fsbridge::fopen(GetDataDir() / SNAPSHOT_CHAINSTATE_DIR / SNAPSHOT_BLOCKHASH_FILENAME, "wb"), SER_DISK, CLIENT_VERSION);
+        if (file.IsNull()) {
+            error = "Failed to open snapshot base blockhash file";
+            return AbortNode(error);
+        }
+        file << base_blockhash;
+        if (!FileCommit(file.Get())) {
+            error = "Failed to write snapshot base blockhash file";
+            return AbortNode(error);
+        }
+    }
+    LogPrintf("[snapshot] activated snapshot chainstate at %s\n", base_blockhash.ToString());
+
+    const bool initial_download = ::ChainstateActive().IsInitialBlockDownload();
+    GetMainSignals().UpdatedBlockTip(base, old_tip, initial_download);
+    uiInterface.NotifyBlockTip(initial_download, base);
+
+    // Connect any blocks beyond the base that were already received.
+    BlockValidationState state;
+    if (!::ChainstateActive().ActivateBestChain(state, chainparams, nullptr)) {
+        LogPrintf("%s: failed to connect blocks after the snapshot base (%s)\n", __func__, FormatStateMessage(state));
+    }
+
+    StartBackgroundValidation();
+    return true;
+}
+
+static constexpr int64_t BACKGROUND_VALIDATION_LOG_INTERVAL = 30; // seconds
+
+//! Connects the blocks below the snapshot base to g_ibd_chainstate.
+static std::thread g_background_validation_thread;
+static CThreadInterrupt g_background_validation_interrupt;
+
+const CBlockIndex* GetBackgroundValidationTarget()
+{
+    AssertLockHeld(cs_main);
+    if (!g_ibd_chainstate || !g_chainstate) return nullptr;
+    return LookupBlockIndex(g_chainstate->m_from_snapshot_blockhash);
+}
+
+/**
+ * The blocks below the snapshot base do not lead to the snapshot. Undo the
+ * effects of MarkSnapshotAncestorsAssumedValid and discard the snapshot
+ * chainstate, so that the node continues from g_ibd_chainstate after a
+ * restart, and shut down.
+ */
+static void InvalidateSnapshotChainstate(const std::string& reason) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    for (const BlockMap::value_type& entry : g_blockman.m_block_index) {
+        CBlockIndex* index = entry.second;
+        if (!(index->nStatus & BLOCK_ASSUMED_VALID)) continue;
+        index->nStatus &= ~BLOCK_ASSUMED_VALID;
+        if (!(index->nStatus & BLOCK_HAVE_DATA)) {
+            index->nTx = 0;
+            index->nChainTx = 0;
+            index->nStatus = (index->nStatus & ~BLOCK_VALID_MASK) | BLOCK_VALID_TREE;
+        }
+        setDirtyBlockIndex.insert(index);
+    }
+    g_ibd_chainstate->ForceFlushStateToDisk();
+
+    // Without its base blockhash the snapshot chainstate is deleted at startup.
+    fs::remove(GetDataDir() / SNAPSHOT_CHAINSTATE_DIR / SNAPSHOT_BLOCKHASH_FILENAME);
+    AbortNode(strprintf("The UTXO snapshot is invalid: %s", reason),
+        _("The UTXO snapshot the chainstate was loaded from is invalid. Restart to continue validating the blocks from before the snapshot.").translated);
+}
+
+/**
+ * Check the UTXO set of g_ibd_chainstate, which has reached the snapshot base,
+ * against the assumeutxo data. If it matches, the background chainstate is no
+ * longer needed and is discarded.
+ */
+static void CompleteBackgroundValidation(const CChainParams& chainparams)
+{
+    const CBlockIndex* base;
+    CCoinsViewDB* coins_db;
+    {
+        LOCK(cs_main);
+        g_ibd_chainstate->ForceFlushStateToDisk();
+        base = g_ibd_chainstate->m_chain.Tip();
+        coins_db = &g_ibd_chainstate->CoinsDB();
+    }
+    LogPrintf("[snapshot] background validation reached the snapshot base %s, checking its UTXO set\n", base->GetBlockHash().ToString());
+
+    // The background chainstate is no longer written to, so its coins can be
+    // hashed without holding cs_main.
+    CCoinsStats stats;
+    const bool have_stats = GetUTXOStats(coins_db, stats);
+
+    LOCK(cs_main);
+    if (!have_stats) {
+        AbortNode("Unable to compute the UTXO set statistics of the background chainstate");
+        return;
+    }
+    const auto it = chainparams.Assumeutxo().find(base->nHeight);
+    if (it == chainparams.Assumeutxo().end()) {
+        InvalidateSnapshotChainstate(strprintf("no assumeutxo data for height %d", base->nHeight));
+        return;
+    }
+    if (stats.hashSerialized != it->second.hash_serialized) {
+        InvalidateSnapshotChainstate(strprintf("expected UTXO set hash %s, got %s",
+            it->second.hash_serialized.ToString(), stats.hashSerialized.ToString()));
+        return;
+    }
+
+    // Mark the snapshot chainstate as validated before deleting the background
+    // chainstate, see DetectSnapshotChainstate.
+    CAutoFile file(fsbridge::fopen(GetDataDir() / SNAPSHOT_CHAINSTATE_DIR / SNAPSHOT_VALIDATED_FILENAME, "wb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        AbortNode("Failed to open snapshot validation file");
+        return;
+    }
+    file << base->GetBlockHash();
+    if (!FileCommit(file.Get())) {
+        AbortNode("Failed to write snapshot validation file");
+        return;
+    }
+    file.fclose();
+
+    g_ibd_chainstate->ResetCoinsViews();
+    g_ibd_chainstate.reset();
+    fs::remove_all(GetDataDir() / "chainstate");
+    ::ChainstateActive().ResizeCoinsCache(nCoinCacheUsage);
+    LogPrintf("[snapshot] snapshot validated, it will replace the chainstate built from genesis at the next startup\n");
+}
+
+static void ThreadBackgroundValidation()
+{
+    ScheduleBatchPriority();
+    const CChainParams& chainparams = Params();
+    int64_t last_log_time = 0;
+
+    while (!g_background_validation_interrupt) {
+        const CBlockIndex* tip;
+        bool connected = false;
+        {
+            LOCK(cs_main);
+            CBlockIndex* target = LookupBlockIndex(::ChainstateActive().m_from_snapshot_blockhash);
+            CChainState& chainstate = *g_ibd_chainstate;
+            if (chainstate.m_chain.Tip() == target) break;
+
+            CBlockIndex* pindex = target->GetAncestor(chainstate.m_chain.Height() + 1);
+            if (pindex->nStatus & BLOCK_HAVE_DATA) {
+                BlockValidationState state;
+                if (!chainstate.ConnectBackgroundTip(state, chainparams, pindex)) {
+                    if (state.IsInvalid()) {
+                        InvalidateSnapshotChainstate(strprintf("block %s is invalid (%s)",
+                            pindex->GetBlockHash().ToString(), FormatStateMessage(state)));
+                    }
+                    // Any other failure has already aborted the node.
+                    return;
+                }
+                chainstate.FlushStateToDisk(chainparams, state, FlushStateMode::PERIODIC);
+                connected = true;
+            }
+            tip = chainstate.m_chain.Tip();
+        }
+
+        if (!connected) {
+            // Wait for the next block to be downloaded.
+            g_background_validation_interrupt.sleep_for(std::chrono::milliseconds(500));
+            continue;
+        }
+
+        int64_t current_time = GetTime();
+        if (last_log_time + BACKGROUND_VALIDATION_LOG_INTERVAL < current_time) {
+            LogPrintf("[snapshot] background validation at height %d\n", tip->nHeight);
+            last_log_time = current_time;
+        }
+    }
+
+    if (!g_background_validation_interrupt) {
+        CompleteBackgroundValidation(chainparams);
+    }
+}
+
+void StartBackgroundValidation()
+{
+    LOCK(cs_main);
+    const CBlockIndex* target = GetBackgroundValidationTarget();
+    if (!target || g_background_validation_thread.joinable()) return;
+
+    const size_t background_cache_size = nCoinCacheUsage * BACKGROUND_VALIDATION_CACHE_PERCENT / 100;
+    g_ibd_chainstate->ResizeCoinsCache(background_cache_size);
+    ::ChainstateActive().ResizeCoinsCache(nCoinCacheUsage - background_cache_size);
+
+    LogPrintf("[snapshot] validating the blocks up to the snapshot base (height %d) in the background, from height %d\n",
+        target->nHeight, g_ibd_chainstate->m_chain.Height());
+    g_background_validation_interrupt.reset();
+    g_background_validation_thread = std::thread(&TraceThread<std::function<void()>>, "bgvalidation", ThreadBackgroundValidation);
+}
+
+void InterruptBackgroundValidation()
+{
+    g_background_validation_interrupt();
+}
+
+void StopBackgroundValidation()
+{
+    InterruptBackgroundValidation();
+    if (g_background_validation_thread.joinable()) {
+        g_background_validation_thread.join();
+    }
+}
+
 //! Guess how far we are in the verification process at the given block index
 //! require cs_main if pindex has not been validated yet (because nChainTx might be unset)
 double GuessVerificationProgress(const ChainTxData& data, const CBlockIndex *pindex) {
@@ -5095,10 +6618,8 @@ public:
     CMainCleanup() {}
     ~CMainCleanup() {
         // block headers
-        BlockMap::iterator it1 = g_blockman.m_block_index.begin();
-        for (; it1 != g_blockman.m_block_index.end(); it1++)
-            delete (*it1).second;
         g_blockman.m_block_index.clear();
+        g_blockman.m_block_index_arena.Clear();
     }
 };
 static CMainCleanup instance_of_cmaincleanup;
@@ -14,6 +14,7 @@
 #include <coins.h>
 #include <crypto/common.h> // for ReadLE64
 #include <fs.h>
+#include <node/rollingcoinstats.h>
 #include <policy/feerate.h>
 #include <protocol.h> // For CMessageHeader::MessageStartChars
 #include <script/script_error.h>
@@ -31,6 +32,7 @@
 #include <utility>
 #include <vector>
 
+class CAutoFile;
 class CChainState;
 class BlockValidationState;
 class CBlockIndex;
@@ -44,6 +46,7 @@ class CBlockPolicyEstimator;
 class CTxMemPool;
 class TxValidationState;
 struct ChainTxData;
+class SnapshotMetadata;
 
 struct DisconnectedBlockTransactions;
 struct PrecomputedTransactionData;
@@ -80,6 +83,18 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x1400000; // 20 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 15;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of dedicated input-prefetching threads allowed */
+static const int MAX_PREFETCH_THREADS = 32;
+/** -prefetchthreads default (number of threads reading block inputs ahead of ConnectBlock, 0 = disabled) */
+static const int DEFAULT_PREFETCH_THREADS = 4;
+/** Maximum number of threads scanning block files during -reindex */
+static const int MAX_REINDEX_THREADS = 16;
+/** -reindexthreads default (number of threads scanning block files during -reindex, 0 = one per core) */
+static const int DEFAULT_REINDEX_THREADS = 0;
+/** Memory usage of the decoded blocks a -reindex scan thread may have handed over but not yet imported */
+static const size_t REINDEX_SCAN_BYTES_PER_THREAD = 8 << 20;
+/** -backgroundflush default (write the coins cache to disk without stalling validation) */
+static const bool DEFAULT_BACKGROUND_FLUSH = false;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -113,9 +128,18 @@ static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = false;
 static const char* const DEFAULT_BLOCKFILTERINDEX = "0";
+static const bool DEFAULT_COINSTATSINDEX = false;
+static const bool DEFAULT_ADDRINDEX = false;
+static const bool DEFAULT_TXOSPENDERINDEX = false;
+/** Name of the leveldb directory holding a chainstate loaded from a UTXO snapshot */
+static const char* const SNAPSHOT_CHAINSTATE_DIR = "chainstate_snapshot";
+/** Share of the coins cache given to the background validation chainstate */
+static const int BACKGROUND_VALIDATION_CACHE_PERCENT = 10;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
 static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Default for -blockindexsnapshot */
+static const bool DEFAULT_BLOCKINDEX_SNAPSHOT = false;
 /** Default for using fee filter */
 static const bool DEFAULT_FEEFILTER = true;
 
@@ -149,6 +173,10 @@ extern std::atomic_bool fReindex;
  * False indicates all script checking is done on the main threadMessageHandler thread.
  */
 extern bool g_parallel_script_checks;
+/** Whether there are dedicated threads warming the coins cache with a block's inputs before it is connected. */
+extern bool g_parallel_coin_prefetch;
+/** Whether routine flushes of the coins cache are written to disk by a background thread (-backgroundflush). */
+extern bool g_background_coins_flush;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
@@ -233,15 +261,26 @@ FILE* OpenBlockFile(const FlatFilePos &pos, bool fReadOnly = false);
 fs::path GetBlockPosFilename(const FlatFilePos &pos);
 /** Import blocks from an external file */
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFilePos *dbp = nullptr);
+/** Rebuild the block index from the block files, scanning several files at once */
+void ReindexBlockFiles(const CChainParams& chainparams);
 /** Ensures we have a genesis block in the block tree, possibly writing one to disk. */
 bool LoadGenesisBlock(const CChainParams& chainparams);
 /** Load the block tree and coins database from disk,
  * initializing state if we're running with -reindex. */
 bool LoadBlockIndex(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+/**
+ * Write the block index to a flat file, which the next start loads in bulk
+ * instead of iterating the block tree database. Call after the last flush at
+ * shutdown. The snapshot is only loaded if the block tree database was not
+ * changed since, and is removed once read.
+ */
+bool WriteBlockIndexSnapshot(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 /** Unload database information */
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck(int worker_num);
+/** Run an instance of the coin prefetch thread */
+void ThreadCoinPrefetch(int worker_num);
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
 bool GetTransaction(const uint256& hash, CTransactionRef& tx, const Consensus::Params& params, uint256& hashBlock, const CBlockIndex* const blockIndex = nullptr);
 /**
@@ -411,6 +450,7 @@ enum DisconnectResult
     DISCONNECT_FAILED   // Something else went wrong.
 };
 
+class BlockReadAhead;
 class ConnectTrace;
 
 /** @see CChainState::FlushStateToDisk */
@@ -426,6 +466,36 @@ struct CBlockIndexWorkComparator
     bool operator()(const CBlockIndex *pa, const CBlockIndex *pb) const;
 };
 
+/**
+ * Storage of the CBlockIndex objects of a BlockManager. They are allocated in
+ * chunks, never move, and are only freed all together, so that loading the
+ * block index does not allocate each of them separately.
+ */
+class BlockIndexArena
+{
+    static constexpr size_t CHUNK_SIZE = 4096;
+    std::vector<std::unique_ptr<CBlockIndex[]>> m_chunks;
+    size_t m_last_chunk_used{CHUNK_SIZE};
+
+public:
+    /** Get a new, default constructed, CBlockIndex. */
+    CBlockIndex* Allocate()
+    {
+        if (m_last_chunk_used == CHUNK_SIZE) {
+            m_chunks.emplace_back(new CBlockIndex[CHUNK_SIZE]);
+            m_last_chunk_used = 0;
+        }
+        return &m_chunks.back()[m_last_chunk_used++];
+    }
+
+    /** Free all CBlockIndex objects. */
+    void Clear()
+    {
+        m_chunks.clear();
+        m_last_chunk_used = CHUNK_SIZE;
+    }
+};
+
 /**
  * Maintains a tree of blocks (stored in `m_block_index`) which is consulted
  * to determine where the most-work tip is.
@@ -436,6 +506,8 @@ struct CBlockIndexWorkComparator
 class BlockManager {
 public:
     BlockMap m_block_index GUARDED_BY(cs_main);
+    /** The CBlockIndex objects pointed to by m_block_index */
+    BlockIndexArena m_block_index_arena GUARDED_BY(cs_main);
 
     /** In order to efficiently track invalidity of headers, we keep the set of
       * blocks which we tried to connect and found to be invalid here (ie which
@@ -470,11 +542,14 @@ public:
      *
      * @param[out] block_index_candidates  Fill this set with any valid blocks for
      *                                     which we've downloaded all transactions.
+     * @param[in]  entries_loaded  Whether the index entries were already loaded from
+     *                             a block index snapshot, and are not read from blocktree.
      */
     bool LoadBlockIndex(
         const Consensus::Params& consensus_params,
         CBlockTreeDB& blocktree,
-        std::set<CBlockIndex*, CBlockIndexWorkComparator>& block_index_candidates)
+        std::set<CBlockIndex*, CBlockIndexWorkComparator>& block_index_candidates,
+        bool entries_loaded = false)
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     /** Clear all data members. */
@@ -495,6 +570,20 @@ public:
         CBlockIndex** ppindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 };
 
+/** Time the coins cache took to write to disk, reported by getblockchaininfo. All durations in microseconds. */
+struct CoinsFlushStats {
+    //! Number of full flushes of the coins cache.
+    uint64_t count{0};
+    //! How many of them were written by a background thread.
+    uint64_t background_count{0};
+    //! Duration of the last completed database write.
+    int64_t last_write_time{0};
+    //! How long validation was held up by the last flush.
+    int64_t last_pause_time{0};
+    int64_t max_pause_time{0};
+    int64_t total_pause_time{0};
+};
+
 /**
  * A convenience class for constructing the CCoinsView* hierarchy used
  * to facilitate access to the UTXO set.
@@ -511,6 +600,10 @@ public:
     //! All unspent coins reside in this store.
     CCoinsViewDB m_dbview GUARDED_BY(cs_main);
 
+    //! Holds the coins of a flush that is written to m_dbview in the background
+    //! (see -backgroundflush); otherwise reads go straight to m_dbview.
+    CCoinsViewFlushBuffer m_flushbuffer GUARDED_BY(cs_main);
+
     //! This view wraps access to the leveldb instance and handles read errors gracefully.
     CCoinsViewErrorCatcher m_catcherview GUARDED_BY(cs_main);
 
@@ -581,9 +674,28 @@ private:
     //! Manages the UTXO set, which is a reflection of the contents of `m_chain`.
     std::unique_ptr<CoinsViews> m_coins_views;
 
+    //! Size of the leveldb cache passed to InitCoinsDB().
+    size_t m_coinsdb_cache_size_bytes{0};
+
+    //! Memory the in-memory coins cache may use before it is flushed (see
+    //! ResizeCoinsCache()).
+    size_t m_coinstip_cache_size_bytes{0};
+
+    //! Time of the last full flush of the coins cache, in microseconds.
+    int64_t m_last_flush{0};
+
+    //! See GetCoinsFlushStats().
+    CoinsFlushStats m_coins_flush_stats GUARDED_BY(::cs_main);
+
 public:
-    CChainState(BlockManager& blockman) : m_blockman(blockman) {}
-    CChainState();
+    CChainState(BlockManager& blockman, const uint256& from_snapshot_blockhash = uint256())
+        : m_blockman(blockman), m_from_snapshot_blockhash(from_snapshot_blockhash) {}
+    explicit CChainState(const uint256& from_snapshot_blockhash = uint256());
+
+    //! The blockhash of the base of the UTXO snapshot this chainstate was
+    //! loaded from (see ActivateSnapshot()), or null if the chainstate was
+    //! built by connecting every block since genesis.
+    const uint256 m_from_snapshot_blockhash;
 
     /**
      * Initialize the CoinsViews UTXO set database management data structures. The in-memory
@@ -597,10 +709,22 @@ public:
         bool should_wipe,
         std::string leveldb_name = "chainstate");
 
+    //! @returns the leveldb cache size the coins database was initialized with.
+    size_t CoinsDBCacheSize() const { return m_coinsdb_cache_size_bytes; }
+
     //! Initialize the in-memory coins cache (to be done after the health of the on-disk database
-    //! is verified).
+    //! is verified). Its size is bounded by nCoinCacheUsage.
     void InitCoinsCache() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
+    //! Load m_rolling_coin_stats for the best block of the coins database, or
+    //! compute them from all coins if they were not stored for it. To be done
+    //! before the coins cache is modified.
+    bool LoadRollingCoinStats() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    //! Bound the in-memory coins cache to coinstip_size bytes, flushing it if
+    //! it is already larger.
+    void ResizeCoinsCache(size_t coinstip_size) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
     //! @returns whether or not the CoinsViews object has been fully initialized and we can
     //!          safely flush this object to disk.
     bool CanFlushToDisk() EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
@@ -618,6 +742,10 @@ public:
      */
     std::set<CBlockIndex*, CBlockIndexWorkComparator> setBlockIndexCandidates;
 
+    //! Statistics of the UTXO set as of the best block of CoinsTip(), kept up
+    //! to date as blocks are connected and disconnected.
+    RollingCoinStats m_rolling_coin_stats GUARDED_BY(::cs_main);
+
     //! @returns A reference to the in-memory cache of the UTXO set.
     CCoinsViewCache& CoinsTip() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     {
@@ -625,7 +753,8 @@ public:
         return *m_coins_views->m_cacheview.get();
     }
 
-    //! @returns A reference to the on-disk UTXO set database.
+    //! @returns A reference to the on-disk UTXO set database. It may lag behind
+    //!     a background flush; use ForceFlushStateToDisk() before reading it.
     CCoinsViewDB& CoinsDB() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     {
         return m_coins_views->m_dbview;
@@ -641,6 +770,8 @@ public:
     //! Destructs all objects related to accessing the UTXO set.
     void ResetCoinsViews() { m_coins_views.reset(); }
 
+    CoinsFlushStats GetCoinsFlushStats() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main) { return m_coins_flush_stats; }
+
     /**
      * Update the on-disk chain state.
      * The caches and indexes are flushed depending on the mode we're called with
@@ -721,15 +852,30 @@ public:
     /** Update the chain tip based on database information, i.e. CoinsTip()'s best block. */
     bool LoadChainTip(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /**
+     * Connect pindexNew, whose data must be on disk, to m_chain. Unlike
+     * ConnectTip this leaves the mempool alone and notifies no one, as it is
+     * only used by the background validation chainstate (see
+     * StartBackgroundValidation()).
+     */
+    bool ConnectBackgroundTip(BlockValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 private:
-    bool ActivateBestChainStep(BlockValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
+    bool ActivateBestChainStep(BlockValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace, BlockReadAhead& read_ahead) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
     bool ConnectTip(BlockValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
 
+    /**
+     * Read the inputs of a block that are missing from CoinsTip() from the
+     * coins database in parallel and add them to the cache, so that
+     * ConnectBlock does not have to fetch them one at a time.
+     */
+    void PrefetchBlockInputs(const CBlock& block) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
     void InvalidBlockFound(CBlockIndex *pindex, const BlockValidationState &state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     CBlockIndex* FindMostWorkChain() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     void ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pindexNew, const FlatFilePos& pos, const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
-    bool RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs, const CChainParams& params) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    bool RollforwardBlock(const CBlockIndex* pindex, const CBlock& block, CCoinsViewCache& inputs) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     //! Mark a block as not having block data
     void EraseBlockData(CBlockIndex* index) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -762,6 +908,57 @@ BlockMap& BlockIndex();
 // directly, e.g. init.cpp.
 extern std::unique_ptr<CChainState> g_chainstate;
 
+/**
+ * The chainstate that was active before ActivateSnapshot() replaced it. It
+ * validates the blocks up to the snapshot base in the background, and is
+ * discarded once it has reached the base (protected by cs_main).
+ */
+extern std::unique_ptr<CChainState> g_ibd_chainstate;
+
+/**
+ * Build a chainstate from a UTXO snapshot written by dumptxoutset and make it
+ * the active chainstate. The snapshot is only accepted if its base block header
+ * is known and extends the active chain, and if its contents match the
+ * assumeutxo data hardcoded for the base height (see CChainParams::Assumeutxo()).
+ *
+ * @returns false and sets error if the snapshot was rejected, in which case the
+ *          active chainstate is left unchanged.
+ */
+bool ActivateSnapshot(CAutoFile& coins_file, const SnapshotMetadata& metadata, std::string& error) LOCKS_EXCLUDED(cs_main);
+
+/**
+ * Look for a chainstate created by ActivateSnapshot() in the data directory.
+ * A snapshot chainstate whose load was interrupted is deleted.
+ *
+ * @returns true and sets base_blockhash if a snapshot chainstate was found.
+ */
+bool DetectSnapshotChainstate(uint256& base_blockhash);
+
+/** Delete the snapshot chainstate from the data directory, if any. */
+void RemoveSnapshotChainstate();
+
+/**
+ * Start connecting the blocks below the snapshot base to g_ibd_chainstate on a
+ * low-priority thread, if the active chainstate was loaded from a snapshot that
+ * has not been validated yet. While it runs, BACKGROUND_VALIDATION_CACHE_PERCENT
+ * of the coins cache is given to the background chainstate.
+ *
+ * Once the background chainstate reaches the snapshot base, its UTXO set hash
+ * is compared to the assumeutxo data. On a match it is discarded, and the
+ * snapshot chainstate replaces it on disk at the next startup. On a mismatch,
+ * or if one of the blocks is invalid, the snapshot chainstate is discarded and
+ * the node shuts down.
+ */
+void StartBackgroundValidation();
+void InterruptBackgroundValidation();
+void StopBackgroundValidation();
+
+/**
+ * @returns the base of the snapshot the background chainstate is validating
+ *          towards, or nullptr if no background validation is in progress.
+ */
+const CBlockIndex* GetBackgroundValidationTarget() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern std::unique_ptr<CBlockTreeDB> pblocktree;
 
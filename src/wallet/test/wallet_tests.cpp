@@ -4,6 +4,7 @@
 
 #include <wallet/wallet.h>
 
+#include <deque>
 #include <memory>
 #include <stdint.h>
 #include <vector>
@@ -299,7 +300,10 @@ static int64_t AddTx(CWallet& wallet, uint32_t lockTime, int64_t mockTime, int64
     if (blockTime > 0) {
         auto locked_chain = wallet.chain().lock();
         LockAssertion lock(::cs_main);
-        auto inserted = ::BlockIndex().emplace(GetRandHash(), new CBlockIndex);
+        // The block index does not own its entries, keep them here.
+        static std::deque<CBlockIndex> block_index_entries;
+        block_index_entries.emplace_back();
+        auto inserted = ::BlockIndex().emplace(GetRandHash(), &block_index_entries.back());
         assert(inserted.second);
         const uint256& hash = inserted.first->first;
         block = inserted.first->second;
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the addrindex and the getaddresshistory RPC and REST interface.
+
+Test that the history of an address follows funding and spending
+transactions, pagination, reorgs and restarts.
+"""
+
+from decimal import Decimal
+import http.client
+import json
+import urllib.parse
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_raises_rpc_error,
+    wait_until,
+)
+
+
+class AddrIndexTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [["-addrindex", "-rest"], []]
+
+    def wait_for_history(self, node, address, length):
+        wait_until(lambda: len(node.getaddresshistory(address, 0, 1000)) == length)
+
+    def rest_history(self, node, address, count, skip, status=200):
+        url = urllib.parse.urlparse(node.url)
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        conn.request('GET', '/rest/addresshistory/{}/{}/{}.json'.format(count, skip, address))
+        resp = conn.getresponse()
+        assert_equal(resp.status, status)
+        if status == 200:
+            return json.loads(resp.read().decode('utf-8'), parse_float=Decimal)
+
+    def run_test(self):
+        node = self.nodes[0]
+        address = node.get_deterministic_priv_key().address
+        other_address = self.nodes[1].get_deterministic_priv_key().address
+
+        self.log.info("Test that the index has the coinbase outputs of every block")
+        node.generatetoaddress(110, address)
+        self.wait_for_history(node, address, 110)
+        history = node.getaddresshistory(address, 0, 1000)
+        for height, entry in enumerate(history, start=1):
+            assert_equal(entry['type'], 'funding')
+            assert_equal(entry['height'], height)
+            assert_equal(entry['txid'], node.getblock(node.getblockhash(height))['tx'][0])
+            assert_equal(entry['vout'], 0)
+            assert_equal(entry['amount'], Decimal("50"))
+
+        self.log.info("Test pagination")
+        assert_equal(len(node.getaddresshistory(address)), 100)
+        assert_equal(node.getaddresshistory(address, 10, 5), history[10:15])
+        assert_equal(node.getaddresshistory(address, 108, 5), history[108:])
+        assert_equal(node.getaddresshistory(address, 1000), [])
+
+        self.log.info("Test that spends are recorded in the history of the address spent from")
+        coinbase_txid = history[0]['txid']
+        raw_tx = node.createrawtransaction([{"txid": coinbase_txid, "vout": 0}], {other_address: Decimal("49.99")})
+        signed_tx = node.signrawtransactionwithkey(raw_tx, [node.get_deterministic_priv_key().key])['hex']
+        txid = node.sendrawtransaction(signed_tx)
+        node.generatetoaddress(1, address)
+        self.wait_for_history(node, other_address, 1)
+        spend = node.getaddresshistory(address, 110)
+        assert_equal(len(spend), 2)
+        assert_equal(spend[0]['type'], 'funding')
+        assert_equal(spend[1], {
+            'type': 'spending',
+            'height': 111,
+            'txid': txid,
+            'vin': 0,
+            'spent_txid': coinbase_txid,
+            'spent_vout': 0,
+            'amount': Decimal("50"),
+        })
+        assert_equal(node.getaddresshistory(other_address), [{
+            'type': 'funding',
+            'height': 111,
+            'txid': txid,
+            'vout': 0,
+            'amount': Decimal("49.99"),
+        }])
+        script_pub_key = node.getblock(node.getblockhash(111), 2)['tx'][1]['vout'][0]['scriptPubKey']['hex']
+        assert_equal(node.getaddresshistory(script_pub_key), node.getaddresshistory(other_address))
+
+        self.log.info("Test that the index follows reorgs")
+        node.invalidateblock(node.getblockhash(111))
+        # Keep the spend, which returned to the mempool, out of the replacement blocks.
+        node.prioritisetransaction(txid, 0, -100000000)
+        node.generatetoaddress(2, address)
+        self.wait_for_history(node, other_address, 0)
+        assert_equal(node.getaddresshistory(address, 0, 110), history)
+        assert_equal([entry['type'] for entry in node.getaddresshistory(address, 110)], ['funding', 'funding'])
+
+        self.log.info("Test that the index resumes after a restart")
+        self.restart_node(0, ["-addrindex", "-rest"])
+        node.generatetoaddress(2, address)
+        self.wait_for_history(node, address, 114)
+        assert_equal(node.getaddresshistory(address, 0, 110), history)
+
+        self.log.info("Test the REST interface")
+        assert_equal(self.rest_history(node, address, 5, 10), history[10:15])
+        assert_equal(self.rest_history(node, other_address, 100, 0), node.getaddresshistory(other_address))
+        self.rest_history(node, "notanaddress", 100, 0, status=400)
+        self.rest_history(node, address, 0, 0, status=400)
+
+        self.log.info("Test getaddresshistory errors")
+        assert_raises_rpc_error(-1, "Address index is not enabled", self.nodes[1].getaddresshistory, address)
+        assert_raises_rpc_error(-5, "Invalid address or scriptPubKey", node.getaddresshistory, "notanaddress")
+        assert_raises_rpc_error(-8, "skip must be non-negative", node.getaddresshistory, address, -1)
+        assert_raises_rpc_error(-8, "count must be between 1 and 10000", node.getaddresshistory, address, 0, 0)
+        assert_raises_rpc_error(-8, "count must be between 1 and 10000", node.getaddresshistory, address, 0, 10001)
+
+
+if __name__ == '__main__':
+    AddrIndexTest().main()
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test loading a UTXO snapshot written by `dumptxoutset` with `loadtxoutset`.
+
+The snapshot base (height 100 with mocked time) must match the assumeutxo data
+hardcoded in the regtest chainparams.
+"""
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_raises_rpc_error,
+    connect_nodes,
+    wait_until,
+)
+
+from pathlib import Path
+
+SNAPSHOT_BASE_HEIGHT = 100
+
+
+class AssumeutxoTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+
+    def setup_network(self):
+        self.setup_nodes()
+
+    def run_test(self):
+        n0, n1 = self.nodes
+        mocktime = n0.getblockheader(n0.getblockhash(0))['time'] + 1
+        n0.setmocktime(mocktime)
+        n0.generate(SNAPSHOT_BASE_HEIGHT)
+
+        self.log.info("Dump a snapshot at the assumeutxo height")
+        dump = n0.dumptxoutset('utxos.dat')
+        snapshot_path = str(Path(n0.datadir) / 'regtest' / 'utxos.dat')
+        n0.generate(10)
+
+        self.log.info("Reject a snapshot whose base header is unknown")
+        assert_raises_rpc_error(-1, "must appear in the headers chain", n1.loadtxoutset, snapshot_path)
+
+        for height in range(1, SNAPSHOT_BASE_HEIGHT + 1):
+            n1.submitheader(n0.getblockheader(n0.getblockhash(height), False))
+
+        self.log.info("Reject a truncated snapshot")
+        bad_snapshot_path = str(Path(n1.datadir) / 'regtest' / 'bad_utxos.dat')
+        with open(snapshot_path, 'rb') as f:
+            contents = f.read()
+        with open(bad_snapshot_path, 'wb') as f:
+            f.write(contents[:-10])
+        assert_raises_rpc_error(-1, "truncated snapshot", n1.loadtxoutset, bad_snapshot_path)
+        assert_equal(n1.getblockcount(), 0)
+
+        self.log.info("Reject a snapshot while an index that has to sync from genesis is enabled")
+        for index_arg in ['-coinstatsindex', '-addrindex', '-txospenderindex']:
+            self.restart_node(1, extra_args=[index_arg])
+            assert_raises_rpc_error(-1, "loadtxoutset is incompatible with", n1.loadtxoutset, snapshot_path)
+        self.restart_node(1)
+
+        self.log.info("Load the snapshot and sync the blocks after its base")
+        loaded = n1.loadtxoutset(snapshot_path)
+        assert_equal(loaded['coins_loaded'], dump['coins_written'])
+        assert_equal(loaded['base_height'], SNAPSHOT_BASE_HEIGHT)
+        assert_equal(loaded['base_hash'], dump['base_hash'])
+        assert_equal(n1.getbestblockhash(), dump['base_hash'])
+        assert_raises_rpc_error(-1, "already loaded from a snapshot", n1.loadtxoutset, snapshot_path)
+        assert_equal(n1.getblockchaininfo()['background_validation'], {'height': 0, 'snapshot_height': SNAPSHOT_BASE_HEIGHT})
+
+        self.log.info("The snapshot chainstate is used after a restart")
+        self.restart_node(1)
+        assert_equal(n1.getbestblockhash(), dump['base_hash'])
+
+        self.log.info("Sync the blocks after the snapshot base and validate those below it in the background")
+        with n1.assert_debug_log(['[snapshot] snapshot validated']):
+            connect_nodes(n1, 0)
+            wait_until(lambda: n1.getbestblockhash() == n0.getbestblockhash())
+            wait_until(lambda: 'background_validation' not in n1.getblockchaininfo())
+        assert_equal(n1.gettxoutsetinfo()['hash_serialized_2'], n0.gettxoutsetinfo()['hash_serialized_2'])
+
+        self.log.info("The validated snapshot chainstate replaces the one built from genesis after a restart")
+        self.restart_node(1)
+        assert_equal(n1.getbestblockhash(), n0.getbestblockhash())
+        assert not (Path(n1.datadir) / 'regtest' / 'chainstate_snapshot').exists()
+        assert_equal(n1.gettxoutsetinfo()['hash_serialized_2'], n0.gettxoutsetinfo()['hash_serialized_2'])
+        for height in range(SNAPSHOT_BASE_HEIGHT + 1):
+            n1.getblock(n1.getblockhash(height))
+
+
+if __name__ == '__main__':
+    AssumeutxoTest().main()
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test loading the block index from a snapshot written on shutdown (-blockindexsnapshot).
+
+- A snapshot is written on shutdown, loaded by the next start and removed.
+- Corrupt snapshots and snapshots older than the block tree database are ignored.
+- -reindex removes the snapshot.
+"""
+
+import os
+
+from test_framework.address import ADDRESS_BCRT1_UNSPENDABLE
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+
+
+class BlockIndexSnapshotTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.extra_args = [["-blockindexsnapshot"]]
+
+    def snapshot_path(self):
+        return os.path.join(self.nodes[0].datadir, self.chain, 'blocks', 'index.snapshot')
+
+    def restart_and_check(self, expected_msgs, extra_args=None):
+        node = self.nodes[0]
+        tips = node.getchaintips()
+        best_block = node.getbestblockhash()
+        self.stop_node(0)
+        assert os.path.exists(self.snapshot_path())
+        yield
+        with node.assert_debug_log(expected_msgs):
+            self.start_node(0, extra_args)
+        assert_equal(node.getbestblockhash(), best_block)
+        assert_equal(node.getchaintips(), tips)
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(10)
+        # Add a fork, so there are entries off the active chain.
+        node.invalidateblock(node.getblockhash(205))
+        node.generatetoaddress(3, ADDRESS_BCRT1_UNSPENDABLE)
+
+        self.log.info("Test that the snapshot written on shutdown is loaded")
+        for _ in self.restart_and_check(["Loaded 214 block index entries from"]):
+            pass
+        assert not os.path.exists(self.snapshot_path())
+
+        self.log.info("Test that a corrupt snapshot is ignored")
+        for _ in self.restart_and_check(["Ignoring corrupt block index snapshot"]):
+            with open(self.snapshot_path(), 'r+b') as f:
+                f.seek(100)
+                byte = f.read(1)
+                f.seek(100)
+                f.write(bytes([byte[0] ^ 1]))
+
+        self.log.info("Test that a snapshot older than the block tree database is ignored")
+        snapshot = None
+        for _ in self.restart_and_check(["Loaded 214 block index entries from"]):
+            with open(self.snapshot_path(), 'rb') as f:
+                snapshot = f.read()
+        node.generate(1)
+        for _ in self.restart_and_check(["Ignoring block index snapshot older than the block tree database"]):
+            with open(self.snapshot_path(), 'wb') as f:
+                f.write(snapshot)
+
+        self.log.info("Test that -reindex removes the snapshot")
+        self.stop_node(0)
+        assert os.path.exists(self.snapshot_path())
+        self.start_node(0, ["-noblockindexsnapshot", "-reindex"])
+        assert not os.path.exists(self.snapshot_path())
+        self.stop_node(0)
+        assert not os.path.exists(self.snapshot_path())
+
+if __name__ == '__main__':
+    BlockIndexSnapshotTest().main()
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the coinstatsindex and gettxoutsetinfo for a specific block.
+
+Test that the statistics looked up in the coinstatsindex match the rolling
+statistics the node reported at each height, across spends, reorgs and
+restarts.
+"""
+
+from decimal import Decimal
+
+from test_framework.authproxy import JSONRPCException
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_raises_rpc_error,
+    wait_until,
+)
+
+
+class CoinStatsIndexTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [["-coinstatsindex"], []]
+
+    def sync_index(self, node):
+        def index_synced():
+            try:
+                node.gettxoutsetinfo("muhash", node.getblockcount())
+                return True
+            except JSONRPCException:
+                return False
+        wait_until(index_synced)
+
+    def generate_and_record(self, node, count):
+        address = node.get_deterministic_priv_key().address
+        for _ in range(count):
+            node.generatetoaddress(1, address)
+            stats = node.gettxoutsetinfo("muhash")
+            del stats['disk_size']
+            self.stats[stats['height']] = stats
+
+    def check_recorded_stats(self, node):
+        for height, stats in self.stats.items():
+            assert_equal(node.gettxoutsetinfo("muhash", height), stats)
+            assert_equal(node.gettxoutsetinfo("muhash", stats['bestblock']), stats)
+
+    def run_test(self):
+        node = self.nodes[0]
+        self.stats = {}
+
+        self.log.info("Test that the index matches the rolling statistics at every height")
+        self.generate_and_record(node, 110)
+        self.sync_index(node)
+        self.check_recorded_stats(node)
+        assert_equal(node.gettxoutsetinfo("muhash", 0)['txouts'], 0)
+
+        self.log.info("Test that spent outputs are removed from the statistics")
+        coinbase_txid = node.getblock(node.getblockhash(1))['tx'][0]
+        raw_tx = node.createrawtransaction([{"txid": coinbase_txid, "vout": 0}], {node.get_deterministic_priv_key().address: Decimal("49.99")})
+        signed_tx = node.signrawtransactionwithkey(raw_tx, [node.get_deterministic_priv_key().key])['hex']
+        node.sendrawtransaction(signed_tx)
+        self.generate_and_record(node, 1)
+        self.sync_index(node)
+        self.check_recorded_stats(node)
+        # Block 111 added a coinbase output and replaced one coin with another, paying a 0.01 fee.
+        assert_equal(self.stats[111]['txouts'], self.stats[110]['txouts'] + 1)
+        assert_equal(self.stats[111]['total_amount'], self.stats[110]['total_amount'] + Decimal("50"))
+
+        self.log.info("Test that the index follows reorgs")
+        node.invalidateblock(node.getblockhash(109))
+        for height in (109, 110, 111):
+            del self.stats[height]
+        self.generate_and_record(node, 4)
+        self.sync_index(node)
+        self.check_recorded_stats(node)
+
+        self.log.info("Test that the index resumes after a restart")
+        self.restart_node(0, ["-coinstatsindex"])
+        self.generate_and_record(node, 2)
+        self.sync_index(node)
+        self.check_recorded_stats(node)
+
+        self.log.info("Test that the index is rebuilt on reindex")
+        self.restart_node(0, ["-coinstatsindex", "-reindex"])
+        wait_until(lambda: node.getblockcount() == max(self.stats))
+        self.sync_index(node)
+        self.check_recorded_stats(node)
+
+        self.log.info("Test gettxoutsetinfo errors for a specific block")
+        assert_raises_rpc_error(-8, "Querying specific block heights requires -coinstatsindex", self.nodes[1].gettxoutsetinfo, "muhash", 0)
+        assert_raises_rpc_error(-8, "Statistics for a specific block are only available with hash_type muhash", node.gettxoutsetinfo, "hash_serialized_2", 0)
+        assert_raises_rpc_error(-8, "Target block height 1000 after current tip", node.gettxoutsetinfo, "muhash", 1000)
+        assert_raises_rpc_error(-5, "Block not found", node.gettxoutsetinfo, "muhash", "00" * 32)
+
+
+if __name__ == '__main__':
+    CoinStatsIndexTest().main()
@@ -6,7 +6,9 @@
 
 - Start a single node and generate 3 blocks.
 - Stop the node and restart it with -reindex. Verify that the node has reindexed up to block 3.
-- Stop the node and restart it with -reindex-chainstate. Verify that the node has reindexed up to block 3.
+- Stop the node and restart it with -reindex-chainstate. Verify that the node has reindexed up to block 3,
+  reading the blocks ahead of connecting them.
+- Reindex again with a single scan thread set by -reindexthreads.
 """
 
 from test_framework.test_framework import BitcoinTestFramework
@@ -18,13 +20,20 @@ class ReindexTest(BitcoinTestFramework):
         self.setup_clean_chain = True
         self.num_nodes = 1
 
-    def reindex(self, justchainstate=False):
+    def reindex(self, justchainstate=False, threads=None):
         self.nodes[0].generatetoaddress(3, self.nodes[0].get_deterministic_priv_key().address)
         blockcount = self.nodes[0].getblockcount()
         self.stop_nodes()
         extra_args = [["-reindex-chainstate" if justchainstate else "-reindex"]]
-        self.start_nodes(extra_args)
-        wait_until(lambda: self.nodes[0].getblockcount() == blockcount)
+        # With -reindex, block files are scanned on worker threads. With
+        # -reindex-chainstate, blocks are read from disk ahead of connecting them.
+        expected_msgs = ["- Read ahead"] if justchainstate else ["Reindexing block files using", "Reindexing block file blk00000.dat"]
+        if threads is not None:
+            extra_args[0].append("-reindexthreads={}".format(threads))
+            expected_msgs = ["Reindexing block files using {} threads".format(threads)]
+        with self.nodes[0].assert_debug_log(expected_msgs):
+            self.start_nodes(extra_args)
+            wait_until(lambda: self.nodes[0].getblockcount() == blockcount)
         self.log.info("Success")
 
     def run_test(self):
@@ -32,6 +41,7 @@ class ReindexTest(BitcoinTestFramework):
         self.reindex(True)
         self.reindex(False)
         self.reindex(True)
+        self.reindex(False, threads=1)
 
 if __name__ == '__main__':
     ReindexTest().main()
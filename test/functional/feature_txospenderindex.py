@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the txospenderindex and the gettxspendingprevout RPC.
+
+Test that the spender of an output is found in the mempool and, with
+-txospenderindex, in the active chain, across reorgs and restarts.
+"""
+
+from decimal import Decimal
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_raises_rpc_error,
+    connect_nodes,
+    disconnect_nodes,
+    wait_until,
+)
+
+
+class TxoSpenderIndexTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [["-txospenderindex"], []]
+
+    def spend(self, node, txid):
+        address = node.get_deterministic_priv_key().address
+        raw_tx = node.createrawtransaction([{"txid": txid, "vout": 0}], {address: Decimal("49.99")})
+        signed_tx = node.signrawtransactionwithkey(raw_tx, [node.get_deterministic_priv_key().key])['hex']
+        return node.sendrawtransaction(signed_tx)
+
+    def run_test(self):
+        node = self.nodes[0]
+        address = node.get_deterministic_priv_key().address
+        node.generatetoaddress(110, address)
+        self.sync_all()
+        coinbase_txids = [node.getblock(node.getblockhash(height))['tx'][0] for height in range(1, 4)]
+        outputs = [{"txid": txid, "vout": 0} for txid in coinbase_txids]
+
+        self.log.info("Test that unspent outputs have no spender")
+        assert_equal(node.gettxspendingprevout(outputs), outputs)
+
+        self.log.info("Test that spenders are found in the mempool")
+        spend_txids = [self.spend(node, txid) for txid in coinbase_txids[:2]]
+        self.sync_all()
+        expected = [
+            {"txid": coinbase_txids[0], "vout": 0, "spendingtxid": spend_txids[0]},
+            {"txid": coinbase_txids[1], "vout": 0, "spendingtxid": spend_txids[1]},
+            outputs[2],
+        ]
+        for n in self.nodes:
+            assert_equal(n.gettxspendingprevout(outputs), expected)
+
+        self.log.info("Test that spenders are found in the chain with -txospenderindex")
+        node.generatetoaddress(1, address)
+        self.sync_all()
+        expected[0]["height"] = 111
+        expected[1]["height"] = 111
+        wait_until(lambda: node.gettxspendingprevout(outputs) == expected)
+        # Without the index, confirmed spenders are not found.
+        assert_equal(self.nodes[1].gettxspendingprevout(outputs), outputs)
+
+        self.log.info("Test that the index follows reorgs")
+        disconnect_nodes(node, 1)
+        node.invalidateblock(node.getblockhash(111))
+        # Keep the spends, which returned to the mempool, out of the replacement blocks.
+        for txid in spend_txids:
+            node.prioritisetransaction(txid, 0, -100000000)
+        node.generatetoaddress(2, address)
+        for output in expected[:2]:
+            del output["height"]
+        wait_until(lambda: node.gettxspendingprevout(outputs) == expected)
+        node.reconsiderblock(node.getblockhash(111))
+        connect_nodes(node, 1)
+
+        self.log.info("Test that the index resumes after a restart")
+        self.restart_node(0, ["-txospenderindex"])
+        spend_txids.append(self.spend(node, coinbase_txids[2]))
+        node.generatetoaddress(1, address)
+        expected[2] = {"txid": coinbase_txids[2], "vout": 0, "spendingtxid": spend_txids[2], "height": 113}
+        wait_until(lambda: node.gettxspendingprevout(outputs)[2] == expected[2])
+
+        self.log.info("Test gettxspendingprevout errors")
+        assert_raises_rpc_error(-8, "Invalid parameter, outputs are missing", node.gettxspendingprevout, [])
+        assert_raises_rpc_error(-8, "Invalid parameter, vout cannot be negative", node.gettxspendingprevout, [{"txid": coinbase_txids[0], "vout": -1}])
+        assert_raises_rpc_error(-3, "Unexpected key", node.gettxspendingprevout, [{"txid": coinbase_txids[0], "vout": 0, "sequence": 0}])
+        assert_raises_rpc_error(-8, "txid must be of length 64", node.gettxspendingprevout, [{"txid": "00", "vout": 0}])
+
+
+if __name__ == '__main__':
+    TxoSpenderIndexTest().main()
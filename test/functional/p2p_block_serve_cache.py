@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test that blocks served from disk to several peers are read once.
+
+Request the same historical blocks from several peers, and check that they
+are served correctly and the blockservecache statistics of getnettotals.
+"""
+
+from test_framework.messages import (
+    CInv,
+    MSG_BLOCK,
+    MSG_WITNESS_FLAG,
+    msg_getdata,
+)
+from test_framework.mininode import mininode_lock, P2PInterface
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+
+NUM_PEERS = 3
+
+
+class BlockCollector(P2PInterface):
+    def __init__(self):
+        super().__init__()
+        self.blocks = []
+
+    def on_block(self, message):
+        message.block.calc_sha256()
+        self.blocks.append(message.block.sha256)
+
+
+class BlockServeCacheTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+
+    def run_test(self):
+        node = self.nodes[0]
+        peers = [node.add_p2p_connection(BlockCollector()) for _ in range(NUM_PEERS)]
+        block_hashes = [int(node.getblockhash(height), 16) for height in range(1, 11)]
+        assert_equal(node.getnettotals()['blockservecache'], {'hits': 0, 'misses': 0, 'entries': 0, 'bytes': 0})
+
+        self.log.info("Request the same blocks with witness from all peers")
+        for peer in peers:
+            peer.send_and_ping(msg_getdata([CInv(t=MSG_BLOCK | MSG_WITNESS_FLAG, h=h) for h in block_hashes]))
+            with mininode_lock:
+                assert_equal(peer.blocks, block_hashes)
+        cache = node.getnettotals()['blockservecache']
+        assert_equal(cache['misses'], len(block_hashes))
+        assert_equal(cache['hits'], (NUM_PEERS - 1) * len(block_hashes))
+        assert_equal(cache['entries'], len(block_hashes))
+        assert_equal(cache['bytes'], sum(node.getblock(node.getblockhash(height))['size'] for height in range(1, 11)))
+
+        self.log.info("Blocks requested without witness are not served from the cache")
+        peers[0].send_and_ping(msg_getdata([CInv(t=MSG_BLOCK, h=block_hashes[0])]))
+        with mininode_lock:
+            assert_equal(peers[0].blocks[-1], block_hashes[0])
+        assert_equal(node.getnettotals()['blockservecache'], cache)
+
+
+if __name__ == '__main__':
+    BlockServeCacheTest().main()
@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test processing of messages by message worker threads (-msgworkers).
+
+Test that messages processed out of the message handler thread are answered
+in order, and that getmessagehandlerinfo reports the utilization of every
+message processing thread.
+"""
+
+from decimal import Decimal
+
+from test_framework.messages import msg_feefilter, msg_ping
+from test_framework.mininode import mininode_lock, P2PInterface
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, wait_until
+
+NUM_PINGS = 500
+
+
+class PongCollector(P2PInterface):
+    def __init__(self):
+        super().__init__()
+        self.pongs = []
+
+    def on_pong(self, message):
+        self.pongs.append(message.nonce)
+
+
+class MsgWorkersTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [["-msgworkers=2"], []]
+
+    def run_test(self):
+        node = self.nodes[0]
+
+        self.log.info("Test that pings are answered in order")
+        peer = node.add_p2p_connection(PongCollector())
+        for nonce in range(1, NUM_PINGS + 1):
+            peer.send_message(msg_ping(nonce))
+        wait_until(lambda: len(peer.pongs) == NUM_PINGS, lock=mininode_lock)
+        with mininode_lock:
+            assert_equal(peer.pongs, list(range(1, NUM_PINGS + 1)))
+
+        self.log.info("Test that other messages are processed after concurrent ones")
+        peer.send_message(msg_feefilter(12345))
+        peer.sync_with_ping()
+        assert_equal(node.getpeerinfo()[-1]['minfeefilter'], Decimal("0.00012345"))
+
+        self.log.info("Test getmessagehandlerinfo")
+        info = node.getmessagehandlerinfo()
+        assert_equal([thread['thread'] for thread in info], ['msghand', 'msgworker.0', 'msgworker.1'])
+        for thread in info:
+            assert thread['busy_time'] >= 0
+            assert 0 <= thread['utilization'] <= 1
+        assert_equal(info[0]['messages'], 0)
+        assert_equal([thread['thread'] for thread in self.nodes[1].getmessagehandlerinfo()], ['msghand'])
+
+        self.log.info("Test that the number of message workers is capped")
+        self.restart_node(0, ["-msgworkers=100"])
+        assert_equal(len(self.nodes[0].getmessagehandlerinfo()), 17)
+
+
+if __name__ == '__main__':
+    MsgWorkersTest().main()
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test that relayed transactions are serialized once for all peers requesting them.
+
+Announce a transaction to several peers, request it from all of them with and
+without witness, and check the relaytxcache statistics of getnettotals.
+"""
+
+from test_framework.address import ADDRESS_BCRT1_UNSPENDABLE
+from test_framework.messages import (
+    CInv,
+    CTransaction,
+    FromHex,
+    MSG_TX,
+    MSG_WITNESS_FLAG,
+    msg_getdata,
+)
+from test_framework.mininode import mininode_lock, P2PInterface
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, wait_until
+
+NUM_PEERS = 3
+
+
+class TxCollector(P2PInterface):
+    def __init__(self):
+        super().__init__()
+        self.txs = []
+
+    def on_inv(self, message):
+        # Only request the transaction when told to
+        pass
+
+    def on_tx(self, message):
+        self.txs.append(message.tx)
+
+
+class RelayTxCacheTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+
+    def run_test(self):
+        node = self.nodes[0]
+        peers = [node.add_p2p_connection(TxCollector()) for _ in range(NUM_PEERS)]
+
+        self.log.info("Put a transaction in the mempool")
+        tx = node.createrawtransaction(
+            inputs=[{  # coinbase
+                "txid": node.getblock(node.getblockhash(1))['tx'][0],
+                "vout": 0
+            }],
+            outputs={ADDRESS_BCRT1_UNSPENDABLE: 50 - 0.00025},
+        )
+        tx = node.signrawtransactionwithkey(
+            hexstring=tx,
+            privkeys=[node.get_deterministic_priv_key().key],
+        )['hex']
+        ctx = FromHex(CTransaction(), tx)
+        txid = int(ctx.rehash(), 16)
+        node.sendrawtransaction(tx)
+
+        self.log.info("Wait for the transaction to be announced to all peers")
+        for peer in peers:
+            wait_until(lambda: "inv" in peer.last_message and peer.last_message["inv"].inv[-1].hash == txid, lock=mininode_lock)
+        assert_equal(node.getnettotals()['relaytxcache'], {'hits': 0, 'misses': 0, 'entries': 0, 'bytes': 0})
+
+        self.log.info("Request the transaction with witness from all peers")
+        for peer in peers:
+            peer.send_and_ping(msg_getdata([CInv(t=MSG_TX | MSG_WITNESS_FLAG, h=txid)]))
+            with mininode_lock:
+                assert_equal(peer.txs[-1].serialize_with_witness(), ctx.serialize_with_witness())
+        cache = node.getnettotals()['relaytxcache']
+        assert_equal(cache['misses'], 1)
+        assert_equal(cache['hits'], NUM_PEERS - 1)
+        assert_equal(cache['entries'], 1)
+        assert_equal(cache['bytes'], len(ctx.serialize_with_witness()))
+
+        self.log.info("Request the transaction without witness from all peers")
+        for peer in peers:
+            peer.send_and_ping(msg_getdata([CInv(t=MSG_TX, h=txid)]))
+            with mininode_lock:
+                assert_equal(peer.txs[-1].serialize_without_witness(), ctx.serialize_without_witness())
+        cache = node.getnettotals()['relaytxcache']
+        assert_equal(cache['misses'], 2)
+        assert_equal(cache['hits'], 2 * (NUM_PEERS - 1))
+        assert_equal(cache['entries'], 2)
+        assert_equal(cache['bytes'], len(ctx.serialize_with_witness()) + len(ctx.serialize_without_witness()))
+
+
+if __name__ == '__main__':
+    RelayTxCacheTest().main()
@@ -19,6 +19,7 @@ Tests correspond to code in rpc/blockchain.cpp.
 """
 
 from decimal import Decimal
+import hashlib
 import http.client
 import subprocess
 
@@ -58,6 +59,7 @@ class BlockchainTest(BitcoinTestFramework):
         self._test_getblockchaininfo()
         self._test_getchaintxstats()
         self._test_gettxoutsetinfo()
+        self._test_scantxoutset()
         self._test_getblockheader()
         self._test_getdifficulty()
         self._test_getnetworkhashps()
@@ -82,6 +84,7 @@ class BlockchainTest(BitcoinTestFramework):
             'blocks',
             'chain',
             'chainwork',
+            'coins_flush',
             'difficulty',
             'headers',
             'initialblockdownload',
@@ -100,6 +103,8 @@ class BlockchainTest(BitcoinTestFramework):
         # size_on_disk should be > 0
         assert_greater_than(res['size_on_disk'], 0)
 
+        assert_equal(sorted(res['coins_flush'].keys()), ['background', 'count', 'last_pause_time', 'last_write_time', 'max_pause_time', 'total_pause_time'])
+
         # pruneheight should be greater or equal to 0
         assert_greater_than_or_equal(res['pruneheight'], 0)
 
@@ -241,6 +246,46 @@ class BlockchainTest(BitcoinTestFramework):
         del res['disk_size'], res3['disk_size']
         assert_equal(res, res3)
 
+        self.log.info("Test gettxoutsetinfo with hash_type muhash")
+        muhash = node.gettxoutsetinfo("muhash")
+        assert 'hash_serialized_2' not in muhash
+        assert 'transactions' not in muhash
+        for key in ['height', 'bestblock', 'txouts', 'bogosize', 'total_amount']:
+            assert_equal(muhash[key], res[key])
+        assert_equal(len(muhash['muhash']), 64)
+        assert_raises_rpc_error(-8, "foo is not a valid hash_type", node.gettxoutsetinfo, "foo")
+
+        node.invalidateblock(b1hash)
+        muhash2 = node.gettxoutsetinfo("muhash")
+        assert_equal(muhash2['txouts'], 0)
+        # The empty set hashes to SHA256 of the number one in 384 little-endian bytes
+        assert_equal(muhash2['muhash'], hashlib.sha256(b'\x01' + b'\x00' * 383).digest()[::-1].hex())
+        node.reconsiderblock(b1hash)
+        muhash3 = node.gettxoutsetinfo("muhash")
+        del muhash['disk_size'], muhash3['disk_size']
+        assert_equal(muhash, muhash3)
+
+        self.log.info("Test that the rolling UTXO set hash is stored across restarts")
+        self.restart_node(0, ['-stopatheight=207', '-prune=1'])
+        muhash4 = node.gettxoutsetinfo("muhash")
+        del muhash4['disk_size']
+        assert_equal(muhash, muhash4)
+
+    def _test_scantxoutset(self):
+        node = self.nodes[0]
+
+        self.log.info("Test that scantxoutset reads every partition of the UTXO set")
+        res = node.gettxoutsetinfo()
+        scan = node.scantxoutset("start", ["addr({})".format(node.get_deterministic_priv_key().address)])
+        assert scan['success']
+        assert_equal(scan['txouts'], res['txouts'])
+        assert_equal(scan['height'], res['height'])
+        # Every coin was mined to the same address.
+        assert_equal(len(scan['unspents']), res['txouts'])
+        assert_equal(scan['total_amount'], res['total_amount'])
+        assert_equal(node.scantxoutset("status", []), None)
+        assert_equal(node.scantxoutset("abort", []), False)
+
     def _test_getblockheader(self):
         node = self.nodes[0]
 
@@ -57,6 +57,7 @@ class NetTest(BitcoinTestFramework):
         self._test_getnetworkinfo()
         self._test_getaddednodeinfo()
         self._test_getpeerinfo()
+        self._test_getmessagelatencies()
         self._test_getnodeaddresses()
 
     def _test_connection_count(self):
@@ -93,6 +94,15 @@ class NetTest(BitcoinTestFramework):
             assert_greater_than_or_equal(after['bytesrecv_per_msg'].get('pong', 0), before['bytesrecv_per_msg'].get('pong', 0) + 32)
             assert_greater_than_or_equal(after['bytessent_per_msg'].get('ping', 0), before['bytessent_per_msg'].get('ping', 0) + 32)
 
+        pool = self.nodes[0].getnettotals()['recvbufferpool']
+        assert_equal(sorted(pool.keys()), ['idle_buffers', 'idle_bytes', 'reused', 'taken'])
+        assert_greater_than_or_equal(pool['taken'], pool['reused'])
+
+        cache = self.nodes[0].getnettotals()['relaytxcache']
+        assert_equal(sorted(cache.keys()), ['bytes', 'entries', 'hits', 'misses'])
+        cache = self.nodes[0].getnettotals()['blockservecache']
+        assert_equal(sorted(cache.keys()), ['bytes', 'entries', 'hits', 'misses'])
+
     def _test_getnetworkinfo(self):
         assert_equal(self.nodes[0].getnetworkinfo()['networkactive'], True)
         assert_equal(self.nodes[0].getnetworkinfo()['connections'], 2)
@@ -138,6 +148,25 @@ class NetTest(BitcoinTestFramework):
         # check the `servicesnames` field
         for info in peer_info:
             assert_net_servicesnames(int(info[0]["services"], 0x10), info[0]["servicesnames"])
+        # every peer sent a version and a verack, which both were processed
+        for info in peer_info[0]:
+            assert_greater_than_or_equal(len(info['processtime_per_msg']), 1)
+            assert_equal(set(info['processtime_per_msg']).issubset(info['bytesrecv_per_msg']), True)
+            assert_equal(set(info['waittime_per_msg']).issubset(info['bytesrecv_per_msg']), True)
+
+    def _test_getmessagelatencies(self):
+        # connect_nodes opens manual outbound connections, the other side of which is inbound
+        latencies = self.nodes[0].getmessagelatencies()
+        entries = {(entry['peer_class'], entry['msg']): entry for entry in latencies}
+        for peer_class in ['inbound', 'manual']:
+            for msg in ['version', 'verack']:
+                entry = entries[(peer_class, msg)]
+                assert_greater_than_or_equal(entry['count'], 1)
+                for histogram in [entry['wait'], entry['process']]:
+                    assert_equal(len(histogram['buckets']), 28)
+                    assert_equal(sum(histogram['buckets']), entry['count'])
+                    assert_greater_than_or_equal(histogram['p99'], histogram['p50'])
+                    assert_greater_than_or_equal(histogram['total'], 0)
 
     def _test_getnodeaddresses(self):
         self.nodes[0].add_p2p_connection(P2PInterface())
@@ -106,6 +106,9 @@ BASE_SCRIPTS = [
     'wallet_address_types.py',
     'feature_bip68_sequence.py',
     'p2p_feefilter.py',
+    'p2p_msgworkers.py',
+    'p2p_relay_tx_cache.py',
+    'p2p_block_serve_cache.py',
     'feature_reindex.py',
     'feature_abortnode.py',
     # vv Tests less than 30s vv
@@ -160,6 +163,9 @@ BASE_SCRIPTS = [
     'wallet_txn_clone.py --mineblock',
     'feature_notifications.py',
     'rpc_getblockfilter.py',
+    'feature_coinstatsindex.py',
+    'feature_addrindex.py',
+    'feature_txospenderindex.py',
     'rpc_invalidateblock.py',
     'feature_rbf.py',
     'mempool_packages.py',
@@ -192,6 +198,7 @@ BASE_SCRIPTS = [
     'wallet_resendwallettransactions.py',
     'wallet_fallbackfee.py',
     'rpc_dumptxoutset.py',
+    'feature_assumeutxo.py',
     'feature_minchainwork.py',
     'rpc_getblockstats.py',
     'wallet_create_tx.py',
@@ -210,6 +217,7 @@ BASE_SCRIPTS = [
     'p2p_node_network_limited.py',
     'p2p_permissions.py',
     'feature_blocksdir.py',
+    'feature_blockindex_snapshot.py',
     'feature_config_args.py',
     'rpc_help.py',
     'feature_help.py',